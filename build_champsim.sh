@@ -155,14 +155,7 @@ else
 fi
 echo
 
-# Change prefetchers and replacement policy
-cp branch/${BRANCH}.bpred branch/branch_predictor.cc
-cp prefetcher/${L1I_PREFETCHER}.l1i_pref prefetcher/l1i_prefetcher.cc
-cp prefetcher/${L1D_PREFETCHER}.l1d_pref prefetcher/l1d_prefetcher.cc
-cp prefetcher/${L2C_PREFETCHER}.l2c_pref prefetcher/l2c_prefetcher.cc
-cp prefetcher/${LLC_PREFETCHER}.llc_pref prefetcher/llc_prefetcher.cc
-cp replacement/${LLC_REPLACEMENT}.llc_repl replacement/llc_replacement.cc
-
+# Every branch predictor, prefetcher, and replacement policy is compiled in and selected at runtime (see inc/policy.h)
 # Build
 mkdir -p bin
 rm -f bin/champsim
@@ -188,4 +181,13 @@ echo "Cores: ${NUM_CORE}"
 BINARY_NAME="${BRANCH}-${L1I_PREFETCHER}-${L1D_PREFETCHER}-${L2C_PREFETCHER}-${LLC_PREFETCHER}-${LLC_REPLACEMENT}-${NUM_CORE}core"
 echo "Binary: bin/${BINARY_NAME}"
 echo ""
-mv bin/champsim bin/${BINARY_NAME}
+
+# bin/${BINARY_NAME} is a wrapper that selects the policies, so run_champsim.sh keeps working
+CORE_BINARY=champsim-${NUM_CORE}core
+mv bin/champsim bin/${CORE_BINARY}
+cat > bin/${BINARY_NAME} << WRAPPER
+#!/bin/bash
+exec "\$(dirname "\$0")/${CORE_BINARY}" -branch_predictor ${BRANCH} -l1i_prefetcher ${L1I_PREFETCHER} -l1d_prefetcher ${L1D_PREFETCHER} \\
+    -l2c_prefetcher ${L2C_PREFETCHER} -llc_prefetcher ${LLC_PREFETCHER} -llc_replacement ${LLC_REPLACEMENT} "\$@"
+WRAPPER
+chmod +x bin/${BINARY_NAME}
@@ -132,6 +132,7 @@ class PACKET {
         type = 0;
 
         fill_level = -1; 
+        pf_origin_level = 0;
         rob_signal = -1;
         rob_index = -1;
         producer = -1;
@@ -140,6 +141,8 @@ class PACKET {
         signature = 0;
         confidence = 0;
 
+        pf_metadata = 0;
+
 #if 0
         for (uint32_t i=0; i<ROB_SIZE; i++) {
             rob_index_depend_on_me[i] = 0;
@@ -160,6 +163,7 @@ class PACKET {
         address = 0;
         full_addr = 0;
         instruction_pa = 0;
+        data_pa = 0;
         data = 0;
         instr_id = 0;
         ip = 0;
@@ -269,6 +273,16 @@ class PACKET_QUEUE {
          remove_queue(PACKET* packet);
 };
 
+// the entries of a CORE_BUFFER, each one the slot of an instruction in the instruction pool of the core,
+// so that an instruction moves from one buffer to the next by its slot, see O3_CPU::INSTR_POOL
+class CORE_BUFFER_ENTRIES {
+  public:
+    ooo_model_instr *pool;
+    uint32_t *slot;
+
+    ooo_model_instr &operator[](uint32_t index) { return pool[slot[index]]; };
+};
+
 // reorder buffer
 class CORE_BUFFER {
   public:
@@ -289,7 +303,8 @@ class CORE_BUFFER {
              lsq_event_cycle,
              retire_event_cycle;
 
-    ooo_model_instr *entry;
+    // an empty entry has slot 0, the empty instruction that is never written
+    CORE_BUFFER_ENTRIES entry;
 
     // constructor
     CORE_BUFFER(string v1, uint32_t v2) : NAME(v1), SIZE(v2) {
@@ -314,12 +329,15 @@ class CORE_BUFFER {
         lsq_event_cycle = UINT64_MAX;
         retire_event_cycle = UINT64_MAX;
 
-        entry = new ooo_model_instr[SIZE];
+        entry.pool = NULL;
+        entry.slot = new uint32_t[SIZE];
+        for (uint32_t i=0; i<SIZE; i++)
+            entry.slot[i] = 0;
     };
 
     // destructor
     ~CORE_BUFFER() {
-        delete[] entry;
+        delete[] entry.slot;
     };
 };
 
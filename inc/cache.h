@@ -2,6 +2,7 @@
 #define CACHE_H
 
 #include "memory_class.h"
+#include "policy.h"
 
 // PAGE
 extern uint32_t PAGE_TABLE_LATENCY, SWAP_LATENCY;
@@ -16,67 +17,67 @@ extern uint32_t PAGE_TABLE_LATENCY, SWAP_LATENCY;
 #define IS_LLC  6
 
 // INSTRUCTION TLB
-#define ITLB_SET 16
-#define ITLB_WAY 4
-#define ITLB_RQ_SIZE 16
-#define ITLB_WQ_SIZE 16
-#define ITLB_PQ_SIZE 0
-#define ITLB_MSHR_SIZE 8
-#define ITLB_LATENCY 1
+CONFIG_PARAMETER(ITLB_SET, 16);
+CONFIG_PARAMETER(ITLB_WAY, 4);
+CONFIG_PARAMETER(ITLB_RQ_SIZE, 16);
+CONFIG_PARAMETER(ITLB_WQ_SIZE, 16);
+CONFIG_PARAMETER(ITLB_PQ_SIZE, 0);
+CONFIG_PARAMETER(ITLB_MSHR_SIZE, 8);
+CONFIG_PARAMETER(ITLB_LATENCY, 1);
 
 // DATA TLB
-#define DTLB_SET 16
-#define DTLB_WAY 4
-#define DTLB_RQ_SIZE 16
-#define DTLB_WQ_SIZE 16
-#define DTLB_PQ_SIZE 0
-#define DTLB_MSHR_SIZE 8
-#define DTLB_LATENCY 1
+CONFIG_PARAMETER(DTLB_SET, 16);
+CONFIG_PARAMETER(DTLB_WAY, 4);
+CONFIG_PARAMETER(DTLB_RQ_SIZE, 16);
+CONFIG_PARAMETER(DTLB_WQ_SIZE, 16);
+CONFIG_PARAMETER(DTLB_PQ_SIZE, 0);
+CONFIG_PARAMETER(DTLB_MSHR_SIZE, 8);
+CONFIG_PARAMETER(DTLB_LATENCY, 1);
 
 // SECOND LEVEL TLB
-#define STLB_SET 128
-#define STLB_WAY 12
-#define STLB_RQ_SIZE 32
-#define STLB_WQ_SIZE 32
-#define STLB_PQ_SIZE 0
-#define STLB_MSHR_SIZE 16
-#define STLB_LATENCY 8
+CONFIG_PARAMETER(STLB_SET, 128);
+CONFIG_PARAMETER(STLB_WAY, 12);
+CONFIG_PARAMETER(STLB_RQ_SIZE, 32);
+CONFIG_PARAMETER(STLB_WQ_SIZE, 32);
+CONFIG_PARAMETER(STLB_PQ_SIZE, 0);
+CONFIG_PARAMETER(STLB_MSHR_SIZE, 16);
+CONFIG_PARAMETER(STLB_LATENCY, 8);
 
 // L1 INSTRUCTION CACHE
-#define L1I_SET 64
-#define L1I_WAY 8
-#define L1I_RQ_SIZE 64
-#define L1I_WQ_SIZE 64 
-#define L1I_PQ_SIZE 32
-#define L1I_MSHR_SIZE 8
-#define L1I_LATENCY 4
+CONFIG_PARAMETER(L1I_SET, 64);
+CONFIG_PARAMETER(L1I_WAY, 8);
+CONFIG_PARAMETER(L1I_RQ_SIZE, 64);
+CONFIG_PARAMETER(L1I_WQ_SIZE, 64);
+CONFIG_PARAMETER(L1I_PQ_SIZE, 32);
+CONFIG_PARAMETER(L1I_MSHR_SIZE, 8);
+CONFIG_PARAMETER(L1I_LATENCY, 4);
 
 // L1 DATA CACHE
-#define L1D_SET 64
-#define L1D_WAY 12
-#define L1D_RQ_SIZE 64
-#define L1D_WQ_SIZE 64 
-#define L1D_PQ_SIZE 8
-#define L1D_MSHR_SIZE 16
-#define L1D_LATENCY 5 
+CONFIG_PARAMETER(L1D_SET, 64);
+CONFIG_PARAMETER(L1D_WAY, 12);
+CONFIG_PARAMETER(L1D_RQ_SIZE, 64);
+CONFIG_PARAMETER(L1D_WQ_SIZE, 64);
+CONFIG_PARAMETER(L1D_PQ_SIZE, 8);
+CONFIG_PARAMETER(L1D_MSHR_SIZE, 16);
+CONFIG_PARAMETER(L1D_LATENCY, 5);
 
 // L2 CACHE
-#define L2C_SET 1024
-#define L2C_WAY 8
-#define L2C_RQ_SIZE 32
-#define L2C_WQ_SIZE 32
-#define L2C_PQ_SIZE 16
-#define L2C_MSHR_SIZE 32
-#define L2C_LATENCY 10  // 4/5 (L1I or L1D) + 10 = 14/15 cycles
+CONFIG_PARAMETER(L2C_SET, 1024);
+CONFIG_PARAMETER(L2C_WAY, 8);
+CONFIG_PARAMETER(L2C_RQ_SIZE, 32);
+CONFIG_PARAMETER(L2C_WQ_SIZE, 32);
+CONFIG_PARAMETER(L2C_PQ_SIZE, 16);
+CONFIG_PARAMETER(L2C_MSHR_SIZE, 32);
+CONFIG_PARAMETER(L2C_LATENCY, 10); // 4/5 (L1I or L1D) + 10 = 14/15 cycles
 
 // LAST LEVEL CACHE
-#define LLC_SET NUM_CPUS*2048
-#define LLC_WAY 16
-#define LLC_RQ_SIZE NUM_CPUS*L2C_MSHR_SIZE //48
-#define LLC_WQ_SIZE NUM_CPUS*L2C_MSHR_SIZE //48
-#define LLC_PQ_SIZE NUM_CPUS*32
-#define LLC_MSHR_SIZE NUM_CPUS*64
-#define LLC_LATENCY 20  // 4/5 (L1I or L1D) + 10 + 20 = 34/35 cycles
+CONFIG_PARAMETER(LLC_SET, NUM_CPUS*2048);
+CONFIG_PARAMETER(LLC_WAY, 16);
+CONFIG_PARAMETER(LLC_RQ_SIZE, NUM_CPUS*L2C_MSHR_SIZE); //48
+CONFIG_PARAMETER(LLC_WQ_SIZE, NUM_CPUS*L2C_MSHR_SIZE); //48
+CONFIG_PARAMETER(LLC_PQ_SIZE, NUM_CPUS*32);
+CONFIG_PARAMETER(LLC_MSHR_SIZE, NUM_CPUS*64);
+CONFIG_PARAMETER(LLC_LATENCY, 20); // 4/5 (L1I or L1D) + 10 + 20 = 34/35 cycles
 
 class CACHE : public MEMORY {
   public:
@@ -97,6 +98,10 @@ class CACHE : public MEMORY {
              pf_useless,
              pf_fill;
 
+    // L1D/L2C/LLC prefetcher and LLC replacement policy, see inc/policy.h
+    CACHE_PREFETCHER *prefetcher;
+    LLC_REPLACEMENT *replacement;
+
     // queues
     PACKET_QUEUE WQ{NAME + "_WQ", WQ_SIZE}, // write queue
                  RQ{NAME + "_RQ", RQ_SIZE}, // read queue
@@ -114,7 +119,7 @@ class CACHE : public MEMORY {
     uint64_t total_miss_latency;
     
     // constructor
-    CACHE(string v1, uint32_t v2, int v3, uint32_t v4, uint32_t v5, uint32_t v6, uint32_t v7, uint32_t v8) 
+    CACHE(string v1, uint32_t v2, uint32_t v3, uint32_t v4, uint32_t v5, uint32_t v6, uint32_t v7, uint32_t v8) 
         : NAME(v1), NUM_SET(v2), NUM_WAY(v3), NUM_LINE(v4), WQ_SIZE(v5), RQ_SIZE(v6), PQ_SIZE(v7), MSHR_SIZE(v8) {
 
         LATENCY = 0;
@@ -156,10 +161,16 @@ class CACHE : public MEMORY {
         pf_useful = 0;
         pf_useless = 0;
         pf_fill = 0;
+
+        prefetcher = NULL;
+        replacement = NULL;
     };
 
     // destructor
     ~CACHE() {
+        delete prefetcher;
+        delete replacement;
+
         for (uint32_t i=0; i<NUM_SET; i++)
             delete[] block[i];
         delete[] block;
@@ -188,38 +199,22 @@ class CACHE : public MEMORY {
          handle_read(),
          handle_prefetch();
 
+    void functional_access(PACKET *packet),
+         functional_prefetch();
+
     void add_mshr(PACKET *packet),
          update_fill_cycle(),
-         llc_initialize_replacement(),
          update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit),
-         llc_update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit),
          lru_update(uint32_t set, uint32_t way),
          fill_cache(uint32_t set, uint32_t way, PACKET *packet),
-         replacement_final_stats(),
-         llc_replacement_final_stats(),
-         //prefetcher_initialize(),
-         l1d_prefetcher_initialize(),
-         l2c_prefetcher_initialize(),
-         llc_prefetcher_initialize(),
-         prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type),
-         l1d_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type),
-         prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr),
-         l1d_prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in),
-         //prefetcher_final_stats(),
-         l1d_prefetcher_final_stats(),
-         l2c_prefetcher_final_stats(),
-         llc_prefetcher_final_stats();
-
-    uint32_t l2c_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in),
-         llc_prefetcher_operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in),
-         l2c_prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in),
-         llc_prefetcher_cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in);
-    
+         replacement_final_stats();
+
     uint32_t get_set(uint64_t address),
              get_way(uint64_t address, uint32_t set),
              find_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type),
-             llc_find_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type),
              lru_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type);
+
+    uint64_t next_event_cycle();
 };
 
 #endif
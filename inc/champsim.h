@@ -15,10 +15,13 @@
 #include <iostream>
 #include <queue>
 #include <map>
+#include <vector>
 #include <random>
 #include <string>
 #include <iomanip>
 
+#include "config.h"
+
 // USEFUL MACROS
 //#define DEBUG_PRINT
 #define SANITY_CHECK
@@ -55,16 +58,16 @@
 #define FILL_DRAM 16
 
 // DRAM
-#define DRAM_CHANNELS 1      // default: assuming one DIMM per one channel 4GB * 1 => 4GB off-chip memory
-#define LOG2_DRAM_CHANNELS 0
-#define DRAM_RANKS 1         // 512MB * 8 ranks => 4GB per DIMM
-#define LOG2_DRAM_RANKS 0
-#define DRAM_BANKS 8         // 64MB * 8 banks => 512MB per rank
-#define LOG2_DRAM_BANKS 3
-#define DRAM_ROWS 65536      // 2KB * 32K rows => 64MB per bank
-#define LOG2_DRAM_ROWS 16
-#define DRAM_COLUMNS 128      // 64B * 32 column chunks (Assuming 1B DRAM cell * 8 chips * 8 transactions = 64B size of column chunks) => 2KB per row
-#define LOG2_DRAM_COLUMNS 7
+CONFIG_PARAMETER(DRAM_CHANNELS, 1); // default: assuming one DIMM per one channel 4GB * 1 => 4GB off-chip memory
+CONFIG_PARAMETER(LOG2_DRAM_CHANNELS, 0);
+CONFIG_PARAMETER(DRAM_RANKS, 1); // 512MB * 8 ranks => 4GB per DIMM
+CONFIG_PARAMETER(LOG2_DRAM_RANKS, 0);
+CONFIG_PARAMETER(DRAM_BANKS, 8); // 64MB * 8 banks => 512MB per rank
+CONFIG_PARAMETER(LOG2_DRAM_BANKS, 3);
+CONFIG_PARAMETER(DRAM_ROWS, 65536); // 2KB * 32K rows => 64MB per bank
+CONFIG_PARAMETER(LOG2_DRAM_ROWS, 16);
+CONFIG_PARAMETER(DRAM_COLUMNS, 128); // 64B * 32 column chunks (Assuming 1B DRAM cell * 8 chips * 8 transactions = 64B size of column chunks) => 2KB per row
+CONFIG_PARAMETER(LOG2_DRAM_COLUMNS, 7);
 #define DRAM_ROW_SIZE (BLOCK_SIZE*DRAM_COLUMNS/1024)
 
 #define DRAM_SIZE (DRAM_CHANNELS*DRAM_RANKS*DRAM_BANKS*DRAM_ROWS*DRAM_ROW_SIZE/1024) 
@@ -79,7 +82,15 @@ extern uint8_t warmup_complete[NUM_CPUS],
                all_simulation_complete,
                MAX_INSTR_DESTINATIONS,
                knob_cloudsuite,
-               knob_low_bandwidth;
+               knob_trace_v2,
+               knob_multithreaded,
+               knob_low_bandwidth,
+               knob_cycle_skip,
+               knob_functional_warmup,
+               knob_ready_list_scheduler;
+
+extern uint64_t warmup_instructions,
+                simulation_instructions;
 
 extern uint64_t current_core_cycle[NUM_CPUS], 
                 stall_cycle[NUM_CPUS], 
@@ -96,6 +107,23 @@ uint64_t rotl64 (uint64_t n, unsigned int c),
          rotr64 (uint64_t n, unsigned int c),
   va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_vpage, uint8_t is_code);
 
+// -multithreaded: whether a synchronization marker may retire, and tell that it did
+uint8_t sync_marker_ready(uint64_t sequence);
+void    sync_marker_retired(uint64_t sequence);
+void    sync_marker_timeout(uint32_t cpu, uint64_t sequence);
+
+// the main simulation loop (src/main.cc), also run by the sampling, SimPoint, and lockstep drivers
+extern time_t start_time;
+void    operate_cpu(uint32_t i),
+        skip_idle_cycles(),
+        skip_detailed_warmup(),
+        print_deadlock(uint32_t i),
+        print_finished(uint32_t i, uint64_t elapsed_hour, uint64_t elapsed_minute, uint64_t elapsed_second);
+uint8_t deadlocked(uint32_t i);
+
+// DRAM_MTPS and DRAM_DBUS_RETURN_TIME for -low_bandwidth
+void set_dram_bandwidth();
+
 // log base 2 function from efectiu
 int lg2(int n);
 
@@ -114,5 +142,6 @@ class RANDOM {
         return dist(engine);
     };
 };
+extern RANDOM champsim_rand;
 extern uint64_t champsim_seed;
 #endif
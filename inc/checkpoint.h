@@ -0,0 +1,25 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "champsim.h"
+
+// MICROARCHITECTURAL CHECKPOINT
+// holds the warmed-up caches, TLBs, page table, branch predictors, prefetchers, and
+// replacement policies, and how far each trace has been read
+// each structure is stored as a named section, so a run with a different branch predictor,
+// prefetcher, replacement policy, or cache geometry skips the state it cannot use
+#define CHECKPOINT_MAGIC "CSCHKPT"
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_NAME_SIZE 32
+
+extern char *knob_save_checkpoint, *knob_load_checkpoint;
+
+void save_checkpoint(const char *file_name),
+     load_checkpoint(const char *file_name);
+
+// called once by every branch predictor, prefetcher, and replacement policy checkpoint function
+// returns 1 if the data of this section should be saved or restored with checkpoint_data()
+uint8_t checkpoint_section(const char *name, uint64_t size);
+void    checkpoint_data(void *data, uint64_t size);
+
+#endif
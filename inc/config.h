@@ -0,0 +1,24 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stdint.h>
+
+// RUNTIME CONFIGURATION
+// the core, cache, and DRAM parameters are declared with CONFIG_PARAMETER(NAME, default value)
+// next to where they are used, and can be changed at startup with -config FILE
+// each line of FILE sets one parameter, e.g., "L2C_SET = 2048" ('#' starts a comment)
+// building with -DSTATIC_CONFIG compiles the default values in as constants, which is faster but ignores -config
+#ifdef STATIC_CONFIG
+#define CONFIG_PARAMETER(name, value) const uint32_t name = value
+#elif defined(CONFIG_DEFINE)
+#define CONFIG_PARAMETER(name, value) uint32_t name = value
+#else
+#define CONFIG_PARAMETER(name, value) extern uint32_t name
+#endif
+
+extern char *knob_config;
+
+// must run before ooo_cpu, uncore, and llc_port are allocated
+void load_config(const char *file_name);
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef DECODE_CACHE_H
+#define DECODE_CACHE_H
+
+#include "champsim.h"
+#include "instruction.h"
+
+// DECODE CACHE
+// what read_instr() derives from the registers of a trace record (the branch type and the number of
+// register operands) only changes with the static instruction, so each core keeps it per IP in a
+// direct-mapped table; an entry is used only if the registers and is_branch of the record match it,
+// so a stale or conflicting entry is decoded again instead of giving a wrong answer
+// with -decode_sidecar, the table is loaded from and saved to TRACE.decoded next to the trace
+#define DECODE_CACHE_SIZE (1 << 16)
+#define DECODE_SIDECAR_MAGIC "CSDECODE"
+#define DECODE_SIDECAR_VERSION 1
+
+class DECODED_INSTR {
+  public:
+    uint64_t ip;
+
+    // the key besides ip
+    uint8_t trace_is_branch,
+            registers[NUM_INSTR_DESTINATIONS + NUM_INSTR_SOURCES];
+
+    // what the registers tell
+    uint8_t valid,
+            is_branch,
+            always_taken, // branch_taken is 1 whatever the trace says
+            branch_type,
+            num_reg_ops;
+};
+
+// the one place that tells branches apart by the registers they read and write
+void decode_instr(const input_instr *instr, DECODED_INSTR *decoded);
+
+class DECODE_CACHE {
+  public:
+    vector<DECODED_INSTR> entry;
+    uint64_t hit, miss;
+
+    DECODE_CACHE() {
+        hit = 0;
+        miss = 0;
+    };
+
+    DECODED_INSTR *lookup(const input_instr *instr) {
+        if (entry.empty())
+            entry.resize(DECODE_CACHE_SIZE);
+
+        DECODED_INSTR *decoded = &entry[(instr->ip ^ (instr->ip >> 16)) & (DECODE_CACHE_SIZE - 1)];
+        if (decoded->valid && (decoded->ip == instr->ip) && (decoded->trace_is_branch == instr->is_branch)
+            && !memcmp(decoded->registers, instr->destination_registers, sizeof(decoded->registers))) {
+            hit++;
+            return decoded;
+        }
+
+        miss++;
+        decode_instr(instr, decoded);
+        return decoded;
+    };
+
+    // return 0 if the sidecar file cannot be read or written
+    uint8_t load(const char *file_name),
+            save(const char *file_name);
+};
+
+#endif
@@ -5,8 +5,8 @@
 
 // DRAM configuration
 #define DRAM_CHANNEL_WIDTH 8 // 8B
-#define DRAM_WQ_SIZE 64
-#define DRAM_RQ_SIZE 64
+CONFIG_PARAMETER(DRAM_WQ_SIZE, 64);
+CONFIG_PARAMETER(DRAM_RQ_SIZE, 64);
 
 #define tRP_DRAM_NANOSECONDS  12.5
 #define tRCD_DRAM_NANOSECONDS 12.5
@@ -26,17 +26,21 @@ class MEMORY_CONTROLLER : public MEMORY {
   public:
     const string NAME;
 
-    DRAM_ARRAY dram_array[DRAM_CHANNELS][DRAM_RANKS][DRAM_BANKS];
-    uint64_t dbus_cycle_available[DRAM_CHANNELS], dbus_cycle_congested[DRAM_CHANNELS], dbus_congested[NUM_TYPES+1][NUM_TYPES+1];
-    uint64_t bank_cycle_available[DRAM_CHANNELS][DRAM_RANKS][DRAM_BANKS];
-    uint8_t  do_write, write_mode[DRAM_CHANNELS]; 
-    uint32_t processed_writes, scheduled_reads[DRAM_CHANNELS], scheduled_writes[DRAM_CHANNELS];
+    // per channel, or per channel, rank, and bank, as set by the runtime configuration
+    vector<vector<vector<DRAM_ARRAY> > > dram_array;
+    vector<uint64_t> dbus_cycle_available, dbus_cycle_congested;
+    uint64_t dbus_congested[NUM_TYPES+1][NUM_TYPES+1];
+    vector<vector<vector<uint64_t> > > bank_cycle_available;
+    uint8_t  do_write;
+    vector<uint8_t> write_mode; 
+    uint32_t processed_writes;
+    vector<uint32_t> scheduled_reads, scheduled_writes;
     int fill_level;
 
-    BANK_REQUEST bank_request[DRAM_CHANNELS][DRAM_RANKS][DRAM_BANKS];
+    vector<vector<vector<BANK_REQUEST> > > bank_request;
 
     // queues
-    PACKET_QUEUE WQ[DRAM_CHANNELS], RQ[DRAM_CHANNELS];
+    PACKET_QUEUE *WQ, *RQ;
 
     // constructor
     MEMORY_CONTROLLER(string v1) : NAME (v1) {
@@ -47,18 +51,19 @@ class MEMORY_CONTROLLER : public MEMORY {
         }
         do_write = 0;
         processed_writes = 0;
-        for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
-            dbus_cycle_available[i] = 0;
-            dbus_cycle_congested[i] = 0;
-            write_mode[i] = 0;
-            scheduled_reads[i] = 0;
-            scheduled_writes[i] = 0;
-
-            for (uint32_t j=0; j<DRAM_RANKS; j++) {
-                for (uint32_t k=0; k<DRAM_BANKS; k++)
-                    bank_cycle_available[i][j][k] = 0;
-            }
 
+        dram_array.assign(DRAM_CHANNELS, vector<vector<DRAM_ARRAY> >(DRAM_RANKS, vector<DRAM_ARRAY>(DRAM_BANKS)));
+        dbus_cycle_available.assign(DRAM_CHANNELS, 0);
+        dbus_cycle_congested.assign(DRAM_CHANNELS, 0);
+        bank_cycle_available.assign(DRAM_CHANNELS, vector<vector<uint64_t> >(DRAM_RANKS, vector<uint64_t>(DRAM_BANKS, 0)));
+        write_mode.assign(DRAM_CHANNELS, 0);
+        scheduled_reads.assign(DRAM_CHANNELS, 0);
+        scheduled_writes.assign(DRAM_CHANNELS, 0);
+        bank_request.assign(DRAM_CHANNELS, vector<vector<BANK_REQUEST> >(DRAM_RANKS, vector<BANK_REQUEST>(DRAM_BANKS)));
+
+        WQ = new PACKET_QUEUE[DRAM_CHANNELS];
+        RQ = new PACKET_QUEUE[DRAM_CHANNELS];
+        for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
             WQ[i].NAME = "DRAM_WQ" + to_string(i);
             WQ[i].SIZE = DRAM_WQ_SIZE;
             WQ[i].entry = new PACKET [DRAM_WQ_SIZE];
@@ -83,7 +88,8 @@ class MEMORY_CONTROLLER : public MEMORY {
 
     void return_data(PACKET *packet),
          operate(),
-         increment_WQ_FULL(uint64_t address);
+         increment_WQ_FULL(uint64_t address),
+         functional_access(PACKET *packet);
 
     uint32_t get_occupancy(uint8_t queue_type, uint64_t address),
              get_size(uint8_t queue_type, uint64_t address);
@@ -100,7 +106,8 @@ class MEMORY_CONTROLLER : public MEMORY {
              dram_get_column (uint64_t address),
              drc_check_hit (uint64_t address, uint32_t cpu, uint32_t channel, uint32_t rank, uint32_t bank, uint32_t row);
 
-    uint64_t get_bank_earliest_cycle();
+    uint64_t get_bank_earliest_cycle(),
+             next_event_cycle();
 
     int check_dram_queue(PACKET_QUEUE *queue, PACKET *packet);
 };
@@ -1,11 +1,12 @@
 #ifndef INSTRUCTION_H
 #define INSTRUCTION_H
 
+#include "config.h"
 
 // instruction format
-#define ROB_SIZE 352
-#define LQ_SIZE 128
-#define SQ_SIZE 72
+CONFIG_PARAMETER(ROB_SIZE, 352);
+CONFIG_PARAMETER(LQ_SIZE, 128);
+CONFIG_PARAMETER(SQ_SIZE, 72);
 #define NUM_INSTR_DESTINATIONS_SPARC 4
 #define NUM_INSTR_DESTINATIONS 2
 #define NUM_INSTR_SOURCES 4
@@ -25,6 +26,33 @@
 #define BRANCH_RETURN        6
 #define BRANCH_OTHER         7
 
+// instruction classes of version 2 traces (-trace_v2), which set their execution latency
+#define INSTR_CLASS_UNKNOWN  0 // version 1 traces
+#define INSTR_CLASS_INT_ALU  1
+#define INSTR_CLASS_INT_MUL  2
+#define INSTR_CLASS_INT_DIV  3
+#define INSTR_CLASS_FP       4 // scalar floating point, x87 or SSE/AVX
+#define INSTR_CLASS_FP_DIV   5 // including square root
+#define INSTR_CLASS_SIMD     6
+#define INSTR_CLASS_LOAD     7 // moves from memory
+#define INSTR_CLASS_STORE    8 // moves to memory
+#define INSTR_CLASS_BRANCH   9
+#define INSTR_CLASS_SYNC    10 // a synchronization marker of a multithreaded trace, see below
+#define NUM_INSTR_CLASSES   11
+
+// a synchronization marker is a record with no registers that the tracer puts in the trace of a thread in
+// front of the instruction where the thread synchronized; destination_memory[0] holds the order of the marker
+// among the markers of all threads (from 1), destination_memory[1] the address of the lock, barrier, etc.,
+// and source_registers[0] one of the kinds below
+#define SYNC_ACQUIRE         1 // e.g., pthread_mutex_lock() returned
+#define SYNC_RELEASE         2 // e.g., pthread_mutex_unlock() was called
+#define SYNC_BARRIER_ARRIVE  3
+#define SYNC_BARRIER_LEAVE   4
+#define SYNC_THREAD_CREATE   5
+#define SYNC_THREAD_START    6
+#define SYNC_THREAD_EXIT     7
+#define SYNC_THREAD_JOIN     8
+
 #include "set.h"
 
 class input_instr {
@@ -60,6 +88,35 @@ class input_instr {
     };
 };
 
+// what a version 2 trace record adds to input_instr, see tracer/champsim_tracer.cpp
+class instr_info {
+  public:
+    uint8_t instr_class,
+            branch_type, // as told by the decoder of the tracer, instead of guessed from the registers
+            instr_size,  // bytes
+            load_size,   // bytes read from memory by each source_memory operand
+            store_size,  // bytes written to memory by each destination_memory operand
+            reserved[3];
+
+    instr_info() {
+        instr_class = INSTR_CLASS_UNKNOWN;
+        branch_type = NOT_BRANCH;
+        instr_size = 0;
+        load_size = 0;
+        store_size = 0;
+        reserved[0] = reserved[1] = reserved[2] = 0;
+    };
+};
+
+class input_instr_v2 {
+  public:
+    input_instr instr;
+    instr_info info;
+};
+
+// the tracer writes the same layout
+static_assert(sizeof(input_instr_v2) == sizeof(input_instr) + 8, "a version 2 record is a version 1 record and 8 bytes");
+
 class cloudsuite_instr {
   public:
 
@@ -98,6 +155,18 @@ class cloudsuite_instr {
     };
 };
 
+// an instruction in the ROB that writes a register; instr_id tells whether rob_index still holds it
+class REG_PRODUCER {
+  public:
+    uint64_t instr_id;
+    uint32_t rob_index;
+
+    REG_PRODUCER() {
+        instr_id = 0;
+        rob_index = UINT32_MAX;
+    };
+};
+
 class ooo_model_instr {
   public:
     uint64_t instr_id,
@@ -130,6 +199,10 @@ class ooo_model_instr {
     uint8_t branch_type;
     uint64_t branch_target;
 
+    // from version 2 traces
+    uint8_t instr_class, instr_size;
+    uint64_t sync_sequence; // of a synchronization marker, 0 for the other instructions
+
     uint32_t fetched, scheduled;
     int num_reg_ops, num_mem_ops, num_reg_dependent;
 
@@ -140,12 +213,10 @@ class ooo_model_instr {
 
     uint8_t source_registers[NUM_INSTR_SOURCES]; // input registers 
 
-    // these are instruction ids of other instructions in the window
-    //int64_t registers_instrs_i_depend_on[NUM_INSTR_SOURCES];
-    // these are indices of instructions in the window that depend on me
-    //uint8_t registers_instrs_depend_on_me[ROB_SIZE], registers_index_depend_on_me[ROB_SIZE][NUM_INSTR_SOURCES];
-    fastset
-	registers_instrs_depend_on_me, registers_index_depend_on_me[NUM_INSTR_SOURCES];
+    // the last writers of the source registers, and the writers of the destination registers before
+    // this one, when it entered the ROB, see O3_CPU::reg_dependency
+    REG_PRODUCER source_producer[NUM_INSTR_SOURCES],
+                 prior_producer[NUM_INSTR_DESTINATIONS_SPARC];
 
 
     // memory addresses that may cause dependencies between instructions
@@ -154,16 +225,8 @@ class ooo_model_instr {
     uint64_t source_memory[NUM_INSTR_SOURCES]; // input memory
     //int source_memory_outstanding[NUM_INSTR_SOURCES];  // a value of 2 here means the load hasn't been issued yet, 1 means it has been issued, but not returned yet, and 0 means it has returned
 
-    // keep around a record of what the original virtual addresses were
-    uint64_t destination_virtual_address[NUM_INSTR_DESTINATIONS_SPARC];
-    uint64_t source_virtual_address[NUM_INSTR_SOURCES];
-
-    // these are instruction ids of other instructions in the window
-    //uint32_t memory_instrs_i_depend_on[NUM_INSTR_SOURCES];
-
-    // these are indices of instructions in the ROB that depend on me
-    //uint8_t memory_instrs_depend_on_me[ROB_SIZE];
-    fastset memory_instrs_depend_on_me;
+    // the writers of the destination addresses before this one when it entered the ROB, see O3_CPU::add_load_queue
+    REG_PRODUCER prior_store[NUM_INSTR_DESTINATIONS_SPARC];
 
     uint32_t lq_index[NUM_INSTR_SOURCES],
              sq_index[NUM_INSTR_DESTINATIONS_SPARC],
@@ -200,6 +263,9 @@ class ooo_model_instr {
 
 	branch_type = NOT_BRANCH;
 	branch_target = 0;
+        instr_class = INSTR_CLASS_UNKNOWN;
+        instr_size = 0;
+        sync_sequence = 0;
 
         instruction_pa = 0;
         data_pa = 0;
@@ -213,7 +279,6 @@ class ooo_model_instr {
         for (uint32_t i=0; i<NUM_INSTR_SOURCES; i++) {
             source_registers[i] = 0;
             source_memory[i] = 0;
-            source_virtual_address[i] = 0;
             source_added[i] = 0;
             lq_index[i] = UINT32_MAX;
             reg_RAW_checked[i] = 0;
@@ -222,21 +287,10 @@ class ooo_model_instr {
         for (uint32_t i=0; i<NUM_INSTR_DESTINATIONS_SPARC; i++) {
             destination_memory[i] = 0;
             destination_registers[i] = 0;
-            destination_virtual_address[i] = 0;
             destination_added[i] = 0;
             sq_index[i] = UINT32_MAX;
             forwarding_index[i] = 0;
         }
-
-#if 0
-        for (uint32_t i=0; i<ROB_SIZE; i++) {
-            registers_instrs_depend_on_me[i] = 0;
-            memory_instrs_depend_on_me[i] = 0;
-
-            for (uint32_t j=0; j<NUM_INSTR_SOURCES; j++)
-                registers_index_depend_on_me[i][j] = 0;
-        }
-#endif
     };
 
   void print_instr()
@@ -269,4 +323,43 @@ class ooo_model_instr {
   }
 };
 
+// the fields of an instruction that are seldom used, kept in a side array of the instruction pool of a core
+// so that the ooo_model_instr stay small, see O3_CPU::INSTR_COLD
+class ooo_model_instr_cold {
+  public:
+    // these are instruction ids of other instructions in the window
+    //int64_t registers_instrs_i_depend_on[NUM_INSTR_SOURCES];
+    // these are indices of instructions in the window that depend on me
+    //uint8_t registers_instrs_depend_on_me[ROB_SIZE], registers_index_depend_on_me[ROB_SIZE][NUM_INSTR_SOURCES];
+    fastset
+	registers_instrs_depend_on_me, registers_index_depend_on_me[NUM_INSTR_SOURCES];
+
+    // these are instruction ids of other instructions in the window
+    //uint32_t memory_instrs_i_depend_on[NUM_INSTR_SOURCES];
+
+    // these are indices of instructions in the ROB that depend on me
+    //uint8_t memory_instrs_depend_on_me[ROB_SIZE];
+    fastset memory_instrs_depend_on_me;
+
+    // keep around a record of what the original virtual addresses were
+    uint64_t destination_virtual_address[NUM_INSTR_DESTINATIONS_SPARC];
+    uint64_t source_virtual_address[NUM_INSTR_SOURCES];
+
+    ooo_model_instr_cold() {
+        for (uint32_t i=0; i<NUM_INSTR_SOURCES; i++)
+            source_virtual_address[i] = 0;
+
+        for (uint32_t i=0; i<NUM_INSTR_DESTINATIONS_SPARC; i++)
+            destination_virtual_address[i] = 0;
+    };
+
+    // empty the dependency sets for the next instruction in the slot
+    void clear() {
+        registers_instrs_depend_on_me.clear();
+        for (uint32_t i=0; i<NUM_INSTR_SOURCES; i++)
+            registers_index_depend_on_me[i].clear();
+        memory_instrs_depend_on_me.clear();
+    };
+};
+
 #endif
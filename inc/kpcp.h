@@ -27,7 +27,7 @@
 
 #define BAD_MAX 7
 
-class SIGNATURE_TABLE {
+class L2_SIGNATURE_TABLE {
   public:
 
     int valid,
@@ -42,7 +42,7 @@ class SIGNATURE_TABLE {
         dirty[64],
         first_hit;
 
-    SIGNATURE_TABLE() {
+    L2_SIGNATURE_TABLE() {
         valid = 0;
         tag = 0;
         last_block = 0;
@@ -61,13 +61,13 @@ class SIGNATURE_TABLE {
     };
 };
 
-class PATTERN_TABLE {
+class L2_PATTERN_TABLE {
   public:
     int delta,
         c_delta,
         c_sig;
 
-    PATTERN_TABLE() {
+    L2_PATTERN_TABLE() {
         delta = 0;
         c_delta = 0;
         c_sig = 0;
@@ -90,31 +90,56 @@ class GLOBAL_HISTORY_REGISTER {
     };
 };
 
-extern SIGNATURE_TABLE L2_ST[NUM_CPUS][L2_ST_SET][L2_ST_WAY];
-extern PATTERN_TABLE L2_PT[NUM_CPUS][L2_PT_SET][L2_PT_WAY];
-extern GLOBAL_HISTORY_REGISTER L2_GHR[NUM_CPUS][L2_GHR_TRACK];
-extern int L2_ST_access[NUM_CPUS], L2_ST_hit[NUM_CPUS], L2_ST_invalid[NUM_CPUS], L2_ST_miss[NUM_CPUS];
-extern int L2_PT_access[NUM_CPUS], L2_PT_hit[NUM_CPUS], L2_PT_invalid[NUM_CPUS], L2_PT_miss[NUM_CPUS];
-extern int l2_sig_dist[NUM_CPUS][1<<SIG_LENGTH];
-
-unsigned int get_new_signature(unsigned int old_signature, int curr_delta);
-int L2_ST_update(uint32_t cpu, uint64_t addr);
-int L2_ST_check(uint32_t cpu, uint64_t addr);
-void L2_PT_update(uint32_t cpu, int signature, int delta);
-void notify_sampler(uint32_t cpu, int64_t address, int dirty, int useful);
-
-//#include "cache.h"
-//#include "kpcp.h"
+class PF_buffer {
+  public:
+    int delta,
+        signature,
+        conf,
+        depth;
 
-SIGNATURE_TABLE L2_ST[NUM_CPUS][L2_ST_SET][L2_ST_WAY];
-PATTERN_TABLE L2_PT[NUM_CPUS][L2_PT_SET][L2_PT_WAY];
-GLOBAL_HISTORY_REGISTER L2_GHR[NUM_CPUS][L2_GHR_TRACK];
+    PF_buffer() {
+        delta = 0;
+        signature = 0;
+        conf = 0;
+        depth = 0;
+    };
+};
 
-int L2_ST_access[NUM_CPUS], L2_ST_hit[NUM_CPUS], L2_ST_invalid[NUM_CPUS], L2_ST_miss[NUM_CPUS];
-int L2_PT_access[NUM_CPUS], L2_PT_hit[NUM_CPUS], L2_PT_invalid[NUM_CPUS], L2_PT_miss[NUM_CPUS];
-int l2_sig_dist[NUM_CPUS][1<<SIG_LENGTH];
+class KPCP : public L2C_PREFETCHER {
+  public:
+    L2_SIGNATURE_TABLE L2_ST[L2_ST_SET][L2_ST_WAY];
+    L2_PATTERN_TABLE L2_PT[L2_PT_SET][L2_PT_WAY];
+    GLOBAL_HISTORY_REGISTER L2_GHR[L2_GHR_TRACK];
+
+    int L2_ST_access, L2_ST_hit, L2_ST_invalid, L2_ST_miss;
+    int L2_PT_access, L2_PT_hit, L2_PT_invalid, L2_PT_miss;
+    int l2_sig_dist[1<<SIG_LENGTH];
+
+    int num_pf, curr_conf, curr_delta, MAX_CONF;
+    int out_of_page, not_enough_conf;
+    int PF_inflight;
+    int spp_pf_issued, spp_pf_useful, spp_pf_useless;
+    vector<int> useful_depth, useless_depth; // [L2C_MSHR_SIZE]
+    int conf_counter;
+    vector<PF_buffer> pf_buffer; // [L2C_MSHR_SIZE]
+
+    void     initialize();
+    uint32_t operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in);
+    uint32_t cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in);
+    void     final_stats();
+    void     checkpoint();
+
+    unsigned int get_new_signature(unsigned int old_signature, int curr_delta);
+    int  L2_ST_update(uint32_t cpu, uint64_t addr),
+         L2_ST_check(uint32_t cpu, uint64_t addr),
+         PF_check(uint32_t cpu, int signature, int curr_block),
+         check_same_page(int curr_block, int delta);
+    void L2_PT_update(uint32_t cpu, int signature, int delta),
+         GHR_update(uint32_t cpu, int signature, int path_conf, int last_block, int oop_delta),
+         notify_sampler(uint32_t cpu, int64_t address, int dirty, int useful);
+};
 
-unsigned int get_new_signature(unsigned int old_signature, int curr_delta)
+unsigned int KPCP::get_new_signature(unsigned int old_signature, int curr_delta)
 {
     if (curr_delta == 0)
         return old_signature;
@@ -136,14 +161,14 @@ unsigned int get_new_signature(unsigned int old_signature, int curr_delta)
 }
 
 // Update signature table
-int L2_ST_update(uint32_t cpu, uint64_t addr)
+int KPCP::L2_ST_update(uint32_t cpu, uint64_t addr)
 {
     uint64_t curr_page = addr >> LOG2_PAGE_SIZE;
     int tag = curr_page & 0xFFFF,
         hit = 0, match = -1,
         L2_ST_idx = curr_page % L2_ST_PRIME,
         curr_block = (addr >> LOG2_BLOCK_SIZE) & 0x3F;
-    SIGNATURE_TABLE *table = L2_ST[cpu][L2_ST_idx];
+    L2_SIGNATURE_TABLE *table = L2_ST[L2_ST_idx];
     int delta_buffer = 0, sig_buffer = 0;
 
     for (match=0; match<L2_ST_WAY; match++) {
@@ -162,7 +187,7 @@ int L2_ST_update(uint32_t cpu, uint64_t addr)
                     sig_delta = 64 + (curr_block - table[match].last_block)*(-1);
                 table[match].signature = sig_delta & SIG_MASK; // This is the first signature
                 table[match].first_hit = 1;
-                l2_sig_dist[cpu][table[match].signature]++;
+                l2_sig_dist[table[match].signature]++;
 
                 if (warmup_complete[cpu])
                 L2_PF_DEBUG(printf("ST_hit_first cpu: %d cl_addr: %lx page: %lx block: %d init_sig: %x delta: %d\n", 
@@ -187,12 +212,12 @@ int L2_ST_update(uint32_t cpu, uint64_t addr)
                 // Update signature
                 int new_signature = get_new_signature(sig_buffer, delta_buffer);
                 table[match].signature = new_signature;
-                l2_sig_dist[cpu][table[match].signature]++;
+                l2_sig_dist[table[match].signature]++;
             }
 
             // Update last_block
             table[match].last_block = curr_block;
-            L2_ST_hit[cpu]++; L2_ST_access[cpu]++;
+            L2_ST_hit++; L2_ST_access++;
             break;
         }
     }
@@ -206,7 +231,7 @@ int L2_ST_update(uint32_t cpu, uint64_t addr)
                 table[match].signature = 0;
                 table[match].first_hit = 0;
                 table[match].last_block = curr_block;
-                L2_ST_invalid[cpu]++; L2_ST_access[cpu]++;
+                L2_ST_invalid++; L2_ST_access++;
 
                 if (warmup_complete[cpu])
                 L2_PF_DEBUG(printf("ST_invalid cpu: %d cl_addr: %lx page: %lx block: %d\n", cpu, addr >> LOG2_BLOCK_SIZE, curr_page, curr_block));
@@ -236,43 +261,43 @@ int L2_ST_update(uint32_t cpu, uint64_t addr)
 
         if (warmup_complete[cpu])
         L2_PF_DEBUG(printf("ST_miss cpu: %d cl_addr: %lx page: %lx block: %d lru: %d\n", cpu, addr >> LOG2_BLOCK_SIZE, curr_page, curr_block, table[match].lru));
-        L2_ST_miss[cpu]++; L2_ST_access[cpu]++;
+        L2_ST_miss++; L2_ST_access++;
 
         #ifdef L2_GHR_ON
         // Check GHR
         int ghr_max = 0, ghr_idx = -1, spec_block = 0, spec_sig = 0;
         for (int i=0; i<L2_GHR_TRACK; i++) {
-            spec_block = L2_GHR[cpu][i].last_block + L2_GHR[cpu][i].oop_delta;
+            spec_block = L2_GHR[i].last_block + L2_GHR[i].oop_delta;
             if (spec_block >= 64)
                 spec_block -= 64;
             else if (spec_block < 0)
                 spec_block += 64;
-            if ((spec_block == curr_block) && (ghr_max <= L2_GHR[cpu][i].path_conf)) {
-                ghr_max = L2_GHR[cpu][i].path_conf;
+            if ((spec_block == curr_block) && (ghr_max <= L2_GHR[i].path_conf)) {
+                ghr_max = L2_GHR[i].path_conf;
                 ghr_idx = i;
-                spec_sig = get_new_signature(L2_GHR[cpu][i].signature, L2_GHR[cpu][i].oop_delta);
+                spec_sig = get_new_signature(L2_GHR[i].signature, L2_GHR[i].oop_delta);
                 if (warmup_complete[cpu])
                 L2_PF_DEBUG(printf("cpu: %d OOP_match  L2_GHR[%d]  signature: %x  path_conf: %d  last_block: %d  oop_delta: %d  spec_block: %d == curr_block: %d  spec_sig: %x\n",
-                          cpu, i, L2_GHR[cpu][i].signature, L2_GHR[cpu][i].path_conf, L2_GHR[cpu][i].last_block, 
-                          L2_GHR[cpu][i].oop_delta, spec_block, curr_block, spec_sig));
+                          cpu, i, L2_GHR[i].signature, L2_GHR[i].path_conf, L2_GHR[i].last_block, 
+                          L2_GHR[i].oop_delta, spec_block, curr_block, spec_sig));
             }
             else {
                 if (warmup_complete[cpu])
                 L2_PF_DEBUG(printf("cpu: %d OOP_unmatch  L2_GHR[%d]  signature: %x  path_conf: %d  last_block: %d  oop_delta: %d  spec_block: %d != curr_block: %d  spec_sig: %x\n",
-                          cpu, i, L2_GHR[cpu][i].signature, L2_GHR[cpu][i].path_conf, L2_GHR[cpu][i].last_block, 
-                          L2_GHR[cpu][i].oop_delta, spec_block, curr_block, spec_sig));
+                          cpu, i, L2_GHR[i].signature, L2_GHR[i].path_conf, L2_GHR[i].last_block, 
+                          L2_GHR[i].oop_delta, spec_block, curr_block, spec_sig));
             }
         }
 
         if (ghr_idx >= 0) {
             // Speculatively update first page
-            spec_sig = get_new_signature(L2_GHR[cpu][ghr_idx].signature, L2_GHR[cpu][ghr_idx].oop_delta);
+            spec_sig = get_new_signature(L2_GHR[ghr_idx].signature, L2_GHR[ghr_idx].oop_delta);
 
             hit = 1;
             table[match].signature = spec_sig;
             if (warmup_complete[cpu])
             L2_PF_DEBUG(printf("cpu: %d spec_update  page: %x  sig: %3x  delta: %3d  curr_block: %2d  last_block[NA]: %2d\n", 
-                      cpu, tag, spec_sig, L2_GHR[cpu][ghr_idx].oop_delta, curr_block, L2_GHR[cpu][ghr_idx].last_block));
+                      cpu, tag, spec_sig, L2_GHR[ghr_idx].oop_delta, curr_block, L2_GHR[ghr_idx].last_block));
         }
         #endif
     }
@@ -291,14 +316,14 @@ int L2_ST_update(uint32_t cpu, uint64_t addr)
         return -1;
 }
 
-int L2_ST_check(uint32_t cpu, uint64_t addr)
+int KPCP::L2_ST_check(uint32_t cpu, uint64_t addr)
 {
     uint64_t curr_page = addr >> LOG2_PAGE_SIZE;
     int tag = curr_page & 0xFFFF,
         match = -1,
         L2_ST_idx = curr_page % L2_ST_PRIME;
 
-    SIGNATURE_TABLE *table = L2_ST[cpu][L2_ST_idx];
+    L2_SIGNATURE_TABLE *table = L2_ST[L2_ST_idx];
 
     for (match=0; match<L2_ST_WAY; match++) {
         if (table[match].valid && (table[match].tag == tag)) {
@@ -314,10 +339,10 @@ int L2_ST_check(uint32_t cpu, uint64_t addr)
     return -1;
 }
 
-void L2_PT_update(uint32_t cpu, int signature, int delta)
+void KPCP::L2_PT_update(uint32_t cpu, int signature, int delta)
 {
     int L2_PT_idx = signature % L2_PT_PRIME;
-    PATTERN_TABLE *table = L2_PT[cpu][L2_PT_idx];
+    L2_PATTERN_TABLE *table = L2_PT[L2_PT_idx];
 
     // Update L2_PT
     // Update metadata
@@ -342,7 +367,7 @@ void L2_PT_update(uint32_t cpu, int signature, int delta)
             if (warmup_complete[cpu])
             L2_PF_DEBUG(printf("PT_sig: %4x cpu: %d update_hit delta[%d]: %2d (%d / %d)\n", 
                         signature, cpu, match, table[match].delta, table[match].c_delta, table[0].c_sig));
-            L2_PT_hit[cpu]++; L2_PT_access[cpu]++;
+            L2_PT_hit++; L2_PT_access++;
             break;
         }
     }
@@ -360,7 +385,7 @@ void L2_PT_update(uint32_t cpu, int signature, int delta)
                 if (warmup_complete[cpu])
                 L2_PF_DEBUG(printf("PT_sig: %4x cpu: %d update_invalid delta[%d]: %2d (%d / %d)\n", 
                             signature, cpu, match, table[match].delta, table[match].c_delta, table[0].c_sig));
-                L2_PT_invalid[cpu]++; L2_PT_access[cpu]++;
+                L2_PT_invalid++; L2_PT_access++;
                 break;
             }
         }
@@ -388,13 +413,13 @@ void L2_PT_update(uint32_t cpu, int signature, int delta)
         if (warmup_complete[cpu])
         L2_PF_DEBUG(printf("PT_sig: %4x cpu: %d update_miss delta[%d]: %2d (%d / %d)\n", 
                     signature, cpu, match, table[match].delta, table[match].c_delta, table[0].c_sig));
-        L2_PT_miss[cpu]++; L2_PT_access[cpu]++;
+        L2_PT_miss++; L2_PT_access++;
     }
 }
 
 // TODO: this functino should be moved to the replacement policy file
 // Check sampler 
-void notify_sampler(uint32_t cpu, int64_t address, int dirty, int useful)
+void KPCP::notify_sampler(uint32_t cpu, int64_t address, int dirty, int useful)
 {
     /*
     int set = llc_get_set(address);
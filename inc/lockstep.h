@@ -0,0 +1,34 @@
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include "sampling.h"
+
+// LOCKSTEP
+// simulate one system per line of the lockstep file on a single decompression of the trace
+// each system is a forked child that applies the options on its line (e.g., -llc_replacement srrip)
+// and writes its results to <lockstep file>.<n>; the parent reads the trace and copies it into
+// one pipe per system, so the systems run side by side at most LOCKSTEP_BUFFER bytes of trace apart
+// (plus the ring of each system's trace reader)
+extern char *knob_lockstep;
+
+#define LOCKSTEP_BUFFER (1 << 20)
+#define LOCKSTEP_CHUNK (1 << 16)
+
+// filled in by each system in memory shared with the parent
+class LOCKSTEP_RESULT {
+  public:
+    uint8_t finished;
+    uint64_t instr, cycle, branch_mispredictions,
+             miss[NUM_SAMPLED_CACHES];
+};
+
+// the system simulated by this process, -1 in the parent and without -lockstep
+extern int32_t lockstep_system;
+
+// returns in each system; the parent reads the trace until all systems finish and exits
+void fork_lockstep();
+
+// in each system, when its simulation is finished
+void record_lockstep_result();
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef NATIVE_TRACE_H
+#define NATIVE_TRACE_H
+
+#include "trace_reader.h"
+#include "instruction.h"
+
+// NATIVE TRACE FORMAT (.cst)
+// a header, blocks of up to CST_BLOCK_RECORDS instructions that are each compressed on their own
+// (zlib or xz), and an index of the blocks at the end of the file, found through the footer
+// each instruction is encoded as
+//   1 byte: bits 0-5 tell which of the 2 destination and 4 source registers are nonzero,
+//           bit 6 is is_branch, bit 7 is branch_taken
+//   1 byte: bits 0-5 tell which of the 2 destination and 4 source memory operands are nonzero
+//   the IP as a zigzag varint of the difference from the previous IP
+//   the nonzero registers, one byte each
+//   the nonzero memory operands, each as a zigzag varint of the difference from the last operand
+//   of the same IP (in a CST_IP_TABLE_SIZE-entry table indexed by a hash of the IP)
+// the previous IP and the operand table start from 0 in every block, so each block decodes on its own
+// only the standard input_instr format is supported, not -cloudsuite traces
+#define CST_MAGIC "CSTRACE"
+#define CST_INDEX_MAGIC "CSTRIDX"
+#define CST_VERSION 1
+#define CST_BLOCK_RECORDS (1 << 20)
+#define CST_IP_TABLE_SIZE (1 << 14)
+#define CST_MAX_RECORD_BYTES (2 + 10 + NUM_INSTR_DESTINATIONS + NUM_INSTR_SOURCES + 10*(NUM_INSTR_DESTINATIONS + NUM_INSTR_SOURCES))
+
+#define CST_CODEC_ZLIB 1
+#define CST_CODEC_XZ 2
+
+class CST_HEADER {
+  public:
+    char magic[8];
+    uint32_t version, record_size;
+};
+
+class CST_BLOCK_INDEX {
+  public:
+    uint64_t offset, first_instr;
+    uint32_t compressed_size, encoded_size, num_records, codec;
+};
+
+class CST_FOOTER {
+  public:
+    uint64_t num_blocks, num_records, index_offset;
+    char magic[8];
+};
+
+inline uint32_t cst_ip_hash(uint64_t ip)
+{
+    return (ip ^ (ip >> 14) ^ (ip >> 28)) & (CST_IP_TABLE_SIZE - 1);
+}
+
+class CST_WRITER {
+  public:
+    FILE *file;
+    uint32_t codec;
+    uint64_t num_records, last_ip;
+    vector<uint64_t> last_address;
+    vector<uint8_t> encoded;
+    vector<CST_BLOCK_INDEX> index;
+
+    CST_WRITER() {
+        file = NULL;
+        codec = CST_CODEC_XZ;
+        num_records = 0;
+        last_ip = 0;
+    };
+
+    // returns 0 if file_name cannot be created
+    uint8_t open(const char *file_name, uint32_t block_codec);
+    void    write(const input_instr *instr),
+            write_block(),
+            close();
+};
+
+// reads a .cst file, see open_trace_decoder()
+TRACE_DECODER *open_native_decoder(const char *file_name);
+
+// read the whole trace from reader and write it to file_name in the native format
+void convert_trace(TRACE_READER *reader, const char *file_name, uint32_t codec);
+
+#endif
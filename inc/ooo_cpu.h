@@ -1,7 +1,12 @@
 #ifndef OOO_CPU_H
 #define OOO_CPU_H
 
+#include <set>
+#include <unordered_map>
+
 #include "cache.h"
+#include "trace_reader.h"
+#include "decode_cache.h"
 
 #ifdef CRC2_COMPILE
 #define STAT_PRINTING_PERIOD 1000000
@@ -13,19 +18,29 @@
 using namespace std;
 
 // CORE PROCESSOR
-#define FETCH_WIDTH 6
-#define DECODE_WIDTH 6
-#define EXEC_WIDTH 6
-#define LQ_WIDTH 2
-#define SQ_WIDTH 2
-#define RETIRE_WIDTH 4
-#define SCHEDULER_SIZE 128
-#define BRANCH_MISPREDICT_PENALTY 1
+CONFIG_PARAMETER(FETCH_WIDTH, 6);
+CONFIG_PARAMETER(DECODE_WIDTH, 6);
+CONFIG_PARAMETER(EXEC_WIDTH, 6);
+CONFIG_PARAMETER(LQ_WIDTH, 2);
+CONFIG_PARAMETER(SQ_WIDTH, 2);
+CONFIG_PARAMETER(RETIRE_WIDTH, 4);
+CONFIG_PARAMETER(SCHEDULER_SIZE, 128);
+CONFIG_PARAMETER(BRANCH_MISPREDICT_PENALTY, 1);
+
+// cycles added to EXEC_LATENCY for the instruction classes of version 2 traces (-trace_v2);
+// the other classes, and every instruction of a version 1 trace, take EXEC_LATENCY alone
+CONFIG_PARAMETER(INT_MUL_LATENCY, 2);
+CONFIG_PARAMETER(INT_DIV_LATENCY, 20);
+CONFIG_PARAMETER(FP_LATENCY, 3);
+CONFIG_PARAMETER(FP_DIV_LATENCY, 12);
+CONFIG_PARAMETER(SIMD_LATENCY, 2);
 //#define SCHEDULING_LATENCY 0
 //#define EXEC_LATENCY 0
 //#define DECODE_LATENCY 2
 
 #define STA_SIZE (ROB_SIZE*NUM_INSTR_DESTINATIONS_SPARC)
+#define NUM_ARCH_REGISTERS 256 // the register numbers of a trace are uint8_t
+#define COMPLETION_WHEEL_SIZE 256 // cycles, a later completion goes around the wheel
 
 extern uint32_t SCHEDULING_LATENCY, EXEC_LATENCY, DECODE_LATENCY;
 
@@ -35,43 +50,90 @@ class O3_CPU {
     uint32_t cpu;
 
     // trace
-    FILE *trace_file;
+    TRACE_READER trace;
     char trace_string[1024];
-    char gunzip_command[1024];
+    DECODE_CACHE decode_cache;
 
     // instruction
     input_instr next_instr;
     input_instr current_instr;
+    instr_info next_info, current_info; // -trace_v2
     cloudsuite_instr current_cloudsuite_instr;
     uint64_t instr_unique_id, completed_executions, 
              begin_sim_cycle, begin_sim_instr, 
              last_sim_cycle, last_sim_instr,
              finish_sim_cycle, finish_sim_instr,
              warmup_instructions, simulation_instructions, instrs_to_read_this_cycle, instrs_to_fetch_this_cycle,
-             next_print_instruction, num_retired;
+             next_print_instruction, num_retired,
+             trace_start; // the first instruction read from the trace, see -skip_instructions
     uint32_t inflight_reg_executions, inflight_mem_executions, num_searched;
     uint32_t next_ITLB_fetch;
 
+    // functional warmup
+    uint64_t functional_fetch_line;
+
+    // the cycle the synchronization marker at the ROB head began to wait for the markers of other cores
+    // (UINT64_MAX if it does not wait), and the last cycle one waited, see -multithreaded
+    uint64_t sync_wait_begin, sync_wait_cycle;
+
     // reorder buffer, load/store queue, register file
     CORE_BUFFER IFETCH_BUFFER{"IFETCH_BUFFER", FETCH_WIDTH*2};
     CORE_BUFFER DECODE_BUFFER{"DECODE_BUFFER", DECODE_WIDTH*3};
     CORE_BUFFER ROB{"ROB", ROB_SIZE};
     LOAD_STORE_QUEUE LQ{"LQ", LQ_SIZE}, SQ{"SQ", SQ_SIZE};
 
+    // the instructions of IFETCH_BUFFER, DECODE_BUFFER, and ROB, which pass from one to the next by their slot
+    // in the pool instead of being copied; slot 0 is the empty instruction, the fields of an instruction that are
+    // seldom used are in the same slot of INSTR_COLD, and the free slots are a stack, see read_from_trace()
+    ooo_model_instr *INSTR_POOL;
+    ooo_model_instr_cold *INSTR_COLD;
+    vector<uint32_t> INSTR_POOL_free;
+
+    // the last instruction added to the ROB that writes each register
+    REG_PRODUCER rename_table[NUM_ARCH_REGISTERS];
+
+    // the last instruction in the ROB that writes each memory address, see add_load_queue()
+    unordered_map<uint64_t, REG_PRODUCER> store_table;
+
+    // the free LQ entries, a min-heap so the lowest free index is taken as by a search of the LQ
+    vector<uint32_t> LQ_free;
+
+    // the ROB indices of the executing instructions, in the slot of the cycle they complete; a memory
+    // instruction goes into the slot of the current cycle when its last memory operation is done, and
+    // moves to the slot of its event_cycle from there, since its event_cycle is set by the cache return
+    vector<uint32_t> completion_wheel[COMPLETION_WHEEL_SIZE], completing;
+    uint64_t completion_wheel_cycle;
+
     // store array, this structure is required to properly handle store instructions
-    uint64_t STA[STA_SIZE], STA_head, STA_tail; 
+    uint64_t *STA, STA_head, STA_tail; 
 
     // Ready-To-Execute
-    uint32_t RTE0[ROB_SIZE], RTE0_head, RTE0_tail, 
-             RTE1[ROB_SIZE], RTE1_head, RTE1_tail;  
+    uint32_t *RTE0, RTE0_head, RTE0_tail, 
+             *RTE1, RTE1_head, RTE1_tail;  
+
+    // with -ready_list_scheduler, the non-memory instructions whose sources are ready replace RTE0 and RTE1:
+    // a min-heap of (instr_id, rob_index), so the oldest ready instruction is on top
+    vector<pair<uint64_t, uint32_t>> ready_list, ready_later;
+
+    // instructions that went through do_scheduling() but have not issued yet, or for memory instructions,
+    // have not entered the LSQ yet
+    uint32_t scheduler_occupancy;
+
+    // (instr_id, rob_index) of the scheduled non-memory [0] and memory [1] instructions whose event_cycle was
+    // set past the current cycle, oldest first; the in-order scans of schedule_instruction() and
+    // schedule_memory_instruction() stop at such an instruction, see oldest_blocker()
+    set<pair<uint64_t, uint32_t>> schedule_blockers[2];
+
+    // (instr_id, rob_index) of the memory instructions whose registers are ready and that wait to enter the LSQ
+    set<pair<uint64_t, uint32_t>> memory_ready;
 
     // Ready-To-Load
-    uint32_t RTL0[LQ_SIZE], RTL0_head, RTL0_tail, 
-             RTL1[LQ_SIZE], RTL1_head, RTL1_tail;  
+    uint32_t *RTL0, RTL0_head, RTL0_tail, 
+             *RTL1, RTL1_head, RTL1_tail;  
 
     // Ready-To-Store
-    uint32_t RTS0[SQ_SIZE], RTS0_head, RTS0_tail,
-             RTS1[SQ_SIZE], RTS1_head, RTS1_tail;
+    uint32_t *RTS0, RTS0_head, RTS0_tail,
+             *RTS1, RTS1_head, RTS1_tail;
 
     // branch
     int branch_mispredict_stall_fetch; // flag that says that we should stall because a branch prediction was wrong
@@ -82,6 +144,10 @@ class O3_CPU {
     uint64_t total_rob_occupancy_at_branch_mispredict;
   uint64_t total_branch_types[8];
 
+    // branch predictor and L1I prefetcher, see inc/policy.h
+    BRANCH_PREDICTOR *branch_predictor;
+    L1I_PREFETCHER *l1i_prefetcher;
+
     // TLBs and caches
     CACHE ITLB{"ITLB", ITLB_SET, ITLB_WAY, ITLB_SET*ITLB_WAY, ITLB_WQ_SIZE, ITLB_RQ_SIZE, ITLB_PQ_SIZE, ITLB_MSHR_SIZE},
           DTLB{"DTLB", DTLB_SET, DTLB_WAY, DTLB_SET*DTLB_WAY, DTLB_WQ_SIZE, DTLB_RQ_SIZE, DTLB_PQ_SIZE, DTLB_MSHR_SIZE},
@@ -96,9 +162,6 @@ class O3_CPU {
     O3_CPU() {
         cpu = 0;
 
-        // trace
-        trace_file = NULL;
-
         // instruction
         instr_unique_id = 0;
         completed_executions = 0;
@@ -115,6 +178,7 @@ class O3_CPU {
 
         next_print_instruction = STAT_PRINTING_PERIOD;
         num_retired = 0;
+        trace_start = 0;
 
         inflight_reg_executions = 0;
         inflight_mem_executions = 0;
@@ -122,6 +186,12 @@ class O3_CPU {
 
         next_ITLB_fetch = 0;
 
+        functional_fetch_line = 0;
+        sync_wait_begin = UINT64_MAX;
+        sync_wait_cycle = 0;
+        completion_wheel_cycle = 0;
+        scheduler_occupancy = 0;
+
         // branch
         branch_mispredict_stall_fetch = 0;
         mispredicted_branch_iw_index = 0;
@@ -134,6 +204,24 @@ class O3_CPU {
 	    total_branch_types[i] = 0;
 	  }
 	
+        // sized by the runtime configuration
+        STA = new uint64_t[STA_SIZE];
+        RTE0 = new uint32_t[ROB_SIZE];
+        RTE1 = new uint32_t[ROB_SIZE];
+        RTL0 = new uint32_t[LQ_SIZE];
+        RTL1 = new uint32_t[LQ_SIZE];
+        RTS0 = new uint32_t[SQ_SIZE];
+        RTS1 = new uint32_t[SQ_SIZE];
+
+        uint32_t pool_size = 1 + IFETCH_BUFFER.SIZE + DECODE_BUFFER.SIZE + ROB.SIZE;
+        INSTR_POOL = new ooo_model_instr[pool_size];
+        INSTR_COLD = new ooo_model_instr_cold[pool_size];
+        for (uint32_t i=pool_size-1; i>0; i--)
+	  INSTR_POOL_free.push_back(i);
+        IFETCH_BUFFER.entry.pool = INSTR_POOL;
+        DECODE_BUFFER.entry.pool = INSTR_POOL;
+        ROB.entry.pool = INSTR_POOL;
+
         for (uint32_t i=0; i<STA_SIZE; i++)
 	  STA[i] = UINT64_MAX;
         STA_head = 0;
@@ -157,6 +245,9 @@ class O3_CPU {
         RTL0_tail = 0;
         RTL1_tail = 0;
 
+        for (uint32_t i=0; i<LQ_SIZE; i++)
+	  LQ_free.push_back(i);
+
         for (uint32_t i=0; i<SQ_SIZE; i++) {
 	  RTS0[i] = SQ_SIZE;
 	  RTS1[i] = SQ_SIZE;
@@ -165,8 +256,27 @@ class O3_CPU {
         RTS1_head = 0;
         RTS0_tail = 0;
         RTS1_tail = 0;
+
+        branch_predictor = NULL;
+        l1i_prefetcher = NULL;
     }
 
+    // destructor
+    ~O3_CPU() {
+        delete branch_predictor;
+        delete l1i_prefetcher;
+
+        delete[] INSTR_POOL;
+        delete[] INSTR_COLD;
+        delete[] STA;
+        delete[] RTE0;
+        delete[] RTE1;
+        delete[] RTL0;
+        delete[] RTL1;
+        delete[] RTS0;
+        delete[] RTS1;
+    };
+
     // functions
     void read_from_trace(),
          fetch_instruction(),
@@ -183,6 +293,8 @@ class O3_CPU {
          complete_execution(uint32_t rob_index),
          reg_RAW_dependency(uint32_t prior, uint32_t current, uint32_t source_index),
          reg_RAW_release(uint32_t rob_index),
+         add_to_ready_list(uint32_t rob_index),
+         add_schedule_blocker(uint32_t rob_index),
          mem_RAW_dependency(uint32_t prior, uint32_t current, uint32_t data_index, uint32_t lq_index),
          handle_o3_fetch(PACKET *current_packet, uint32_t cache_type),
          handle_merged_translation(PACKET *provider),
@@ -198,31 +310,33 @@ class O3_CPU {
     int  execute_load(uint32_t rob_index, uint32_t sq_index, uint32_t data_index);
     void check_dependency(int prior, int current);
     void operate_cache();
-    void update_rob();
+    void update_rob(),
+         schedule_completion(uint32_t rob_index, uint64_t cycle);
     void retire_rob();
 
-    uint32_t  add_to_rob(ooo_model_instr *arch_instr),
+    uint32_t  add_to_rob(uint32_t slot),
               check_rob(uint64_t instr_id);
 
-    uint32_t add_to_ifetch_buffer(ooo_model_instr *arch_instr);
-    uint32_t add_to_decode_buffer(ooo_model_instr *arch_instr);
+    uint8_t  read_instr(ooo_model_instr *arch_instr);
+    void     seek_trace(uint64_t num_instr),
+             skip_instructions(uint64_t num_instr);
+    void     functional_warmup();
+    uint32_t add_to_ifetch_buffer(uint32_t slot);
+    uint32_t add_to_decode_buffer(uint32_t slot);
+
+    uint64_t oldest_blocker(uint32_t is_memory);
 
     uint32_t check_and_add_lsq(uint32_t rob_index);
+    uint8_t  lsq_available(uint32_t rob_index);
 
-    // branch predictor
-    uint8_t predict_branch(uint64_t ip);
-    void    initialize_branch_predictor(),
-            last_branch_result(uint64_t ip, uint8_t taken);
+    // cycle skipping
+    uint64_t next_event_cycle();
 
   // code prefetching
-  void l1i_prefetcher_initialize();
-  void l1i_prefetcher_branch_operate(uint64_t ip, uint8_t branch_type, uint64_t branch_target);
-  void l1i_prefetcher_cache_operate(uint64_t addr, uint8_t cache_hit, uint8_t prefetch_hit);
-  void l1i_prefetcher_cycle_operate();
-  void l1i_prefetcher_final_stats();
   int prefetch_code_line(uint64_t ip, uint64_t pf_addr); 
 };
 
-extern O3_CPU ooo_cpu[NUM_CPUS];
+// allocated once the runtime configuration is loaded
+extern O3_CPU *ooo_cpu;
 
 #endif
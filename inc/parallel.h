@@ -0,0 +1,144 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "cache.h"
+
+// PARALLEL ENGINE
+// each O3_CPU (with its private TLBs/L1I/L1D/L2C) is advanced by a worker thread for
+// QUANTUM cycles, then the shared LLC/DRAM catch up with the same QUANTUM cycles
+// quantum=1 runs the original serial loop and is cycle-exact
+#define LLC_PORT_SIZE (L2C_MSHR_SIZE + LLC_WQ_SIZE + LLC_PQ_SIZE)
+
+extern uint32_t knob_threads, knob_quantum;
+extern mutex page_table_mutex;
+
+// lock-free single-producer single-consumer queue
+template <class T>
+class SPSC_QUEUE {
+  public:
+    const uint32_t SIZE;
+    T *entry;
+    atomic<uint32_t> head, tail;
+
+    SPSC_QUEUE(uint32_t v1) : SIZE(v1+1) {
+        entry = new T[SIZE];
+        head = 0;
+        tail = 0;
+    };
+
+    ~SPSC_QUEUE() {
+        delete[] entry;
+    };
+
+    // producer side
+    bool push(const T &item) {
+        uint32_t t = tail.load(memory_order_relaxed),
+                 next = (t + 1 == SIZE) ? 0 : t + 1;
+        if (next == head.load(memory_order_acquire))
+            return false;
+
+        entry[t] = item;
+        tail.store(next, memory_order_release);
+        return true;
+    };
+
+    // producer side, fills the next entry in place and publishes it with push_back()
+    T *back() {
+        uint32_t t = tail.load(memory_order_relaxed),
+                 next = (t + 1 == SIZE) ? 0 : t + 1;
+        if (next == head.load(memory_order_acquire))
+            return NULL;
+
+        return &entry[t];
+    };
+
+    void push_back() {
+        uint32_t t = tail.load(memory_order_relaxed);
+        tail.store((t + 1 == SIZE) ? 0 : t + 1, memory_order_release);
+    };
+
+    // consumer side
+    T *front() {
+        uint32_t h = head.load(memory_order_relaxed);
+        if (h == tail.load(memory_order_acquire))
+            return NULL;
+
+        return &entry[h];
+    };
+
+    void pop() {
+        uint32_t h = head.load(memory_order_relaxed);
+        head.store((h + 1 == SIZE) ? 0 : h + 1, memory_order_release);
+    };
+};
+
+class LLC_REQUEST {
+  public:
+    PACKET packet;
+    uint8_t queue_type; // 1: RQ, 2: WQ, 3: PQ
+    uint64_t issue_cycle;
+};
+
+// stands in for the LLC as the lower level of one core's L2C
+// requests are queued by the worker thread and drained into the LLC by the uncore
+class LLC_PORT : public MEMORY {
+  public:
+    uint32_t cpu;
+    CACHE *llc;
+    SPSC_QUEUE<LLC_REQUEST> queue{LLC_PORT_SIZE};
+
+    // requests sitting in the port, per queue type
+    uint32_t pending[4];
+    uint64_t WQ_FULL;
+
+    LLC_PORT() {
+        cpu = 0;
+        llc = NULL;
+        for (uint32_t i=0; i<4; i++)
+            pending[i] = 0;
+        WQ_FULL = 0;
+    };
+
+    int  add_rq(PACKET *packet),
+         add_wq(PACKET *packet),
+         add_pq(PACKET *packet),
+         push(PACKET *packet, uint8_t queue_type);
+
+    void return_data(PACKET *packet),
+         operate(),
+         increment_WQ_FULL(uint64_t address),
+         functional_access(PACKET *packet),
+         drain(uint64_t cycle);
+
+    uint32_t get_occupancy(uint8_t queue_type, uint64_t address),
+             get_size(uint8_t queue_type, uint64_t address);
+};
+
+extern LLC_PORT *llc_port;
+
+// spin barrier between the worker threads and the uncore
+class QUANTUM_BARRIER {
+  public:
+    atomic<uint64_t> generation;
+    atomic<uint32_t> arrived;
+    atomic<uint8_t> done;
+
+    QUANTUM_BARRIER() {
+        generation = 0;
+        arrived = 0;
+        done = 0;
+    };
+
+    void release(),
+         arrive(),
+         wait_workers(uint32_t num_workers);
+
+    uint64_t wait_release(uint64_t last_generation);
+};
+
+#endif
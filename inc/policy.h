@@ -0,0 +1,129 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+#include "champsim.h"
+
+class O3_CPU;
+class CACHE;
+class BLOCK;
+
+// POLICY REGISTRY
+// every branch predictor (branch/*.bpred), prefetcher (prefetcher/*.l1i_pref, *.l1d_pref, *.l2c_pref, *.llc_pref),
+// and LLC replacement policy (replacement/*.llc_repl) is compiled into one binary and registers itself by name
+// with REGISTER_POLICY(); each core and cache creates its own instance at startup, so a policy keeps its tables
+// as class members instead of globals
+// the default checkpoint() saves an empty section for policies without state
+
+class BRANCH_PREDICTOR {
+  public:
+    const char *name;
+    O3_CPU *core;
+
+    virtual ~BRANCH_PREDICTOR() {};
+
+    virtual void    initialize() {};
+    virtual uint8_t predict_branch(uint64_t ip) = 0;
+    virtual void    last_branch_result(uint64_t ip, uint8_t taken) = 0;
+    virtual void    checkpoint();
+};
+
+class L1I_PREFETCHER {
+  public:
+    const char *name;
+    O3_CPU *core;
+
+    virtual ~L1I_PREFETCHER() {};
+
+    virtual void initialize() {};
+    virtual void branch_operate(uint64_t ip, uint8_t branch_type, uint64_t branch_target) {};
+    virtual void cache_operate(uint64_t addr, uint8_t cache_hit, uint8_t prefetch_hit) {};
+    virtual void cycle_operate() {};
+    virtual void final_stats() {};
+    virtual void checkpoint();
+};
+
+// the L1D ignores the metadata returned by operate() and cache_fill()
+class CACHE_PREFETCHER {
+  public:
+    const char *name;
+    CACHE *cache;
+
+    virtual ~CACHE_PREFETCHER() {};
+
+    virtual void     initialize() {};
+    virtual uint32_t operate(uint64_t addr, uint64_t ip, uint8_t cache_hit, uint8_t type, uint32_t metadata_in) { return metadata_in; };
+    virtual uint32_t cache_fill(uint64_t addr, uint32_t set, uint32_t way, uint8_t prefetch, uint64_t evicted_addr, uint32_t metadata_in) { return metadata_in; };
+    virtual void     final_stats() {};
+    virtual void     checkpoint();
+};
+
+// one registry per cache level, so each level can have its own "next_line"
+class L1D_PREFETCHER : public CACHE_PREFETCHER {};
+class L2C_PREFETCHER : public CACHE_PREFETCHER {};
+class LLC_PREFETCHER : public CACHE_PREFETCHER {};
+
+class LLC_REPLACEMENT {
+  public:
+    const char *name;
+    CACHE *cache;
+
+    virtual ~LLC_REPLACEMENT() {};
+
+    virtual void     initialize() {};
+    virtual uint32_t find_victim(uint32_t cpu, uint64_t instr_id, uint32_t set, const BLOCK *current_set, uint64_t ip, uint64_t full_addr, uint32_t type) = 0;
+    virtual void     update_replacement_state(uint32_t cpu, uint32_t set, uint32_t way, uint64_t full_addr, uint64_t ip, uint64_t victim_addr, uint32_t type, uint8_t hit) = 0;
+    virtual void     final_stats() {};
+    virtual void     checkpoint();
+};
+
+template <class POLICY>
+class POLICY_REGISTRY {
+  public:
+    typedef POLICY *(*FACTORY)();
+
+    // a function-local static, so policies can register from static constructors in any file
+    static map<string, FACTORY> &factories() {
+        static map<string, FACTORY> registered;
+        return registered;
+    };
+
+    static POLICY *create(const string &name, const char *kind) {
+        typename map<string, FACTORY>::iterator it = factories().find(name);
+        if (it == factories().end()) {
+            cerr << "*** UNKNOWN " << kind << ": " << name << " ***" << endl;
+            cerr << "Available:";
+            for (it = factories().begin(); it != factories().end(); it++)
+                cerr << " " << it->first;
+            cerr << endl;
+            assert(0);
+        }
+
+        POLICY *policy = it->second();
+        policy->name = it->first.c_str();
+        return policy;
+    };
+};
+
+template <class POLICY, class IMPLEMENTATION>
+class POLICY_REGISTRATION {
+  public:
+    static POLICY *create() { return new IMPLEMENTATION(); };
+
+    POLICY_REGISTRATION(const char *name) {
+        POLICY_REGISTRY<POLICY>::factories()[name] = create;
+    };
+};
+
+// e.g., REGISTER_POLICY(BRANCH_PREDICTOR, bimodal, BIMODAL) makes "-branch_predictor bimodal" create a BIMODAL
+#define REGISTER_POLICY(kind, name, implementation) \
+    POLICY_REGISTRATION<kind, implementation> implementation##_registration(#name)
+
+// NAME for every core, or NAME0,NAME1,... with one name per core
+extern string knob_branch_predictor, knob_l1i_prefetcher, knob_l1d_prefetcher, knob_l2c_prefetcher,
+              knob_llc_prefetcher, knob_llc_replacement;
+
+// must run after ooo_cpu and uncore are allocated; running it again replaces the existing policies
+void create_policies();
+void replace_policies();
+
+#endif
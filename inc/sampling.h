@@ -0,0 +1,49 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include "cache.h"
+
+// STATISTICAL SAMPLING
+// every sampling_period instructions, one sampling unit of sampling_unit instructions is measured
+// after sampling_warming instructions of detailed warming; the rest of the period is functionally warmed
+// SimPoint regions (inc/simpoint.h) are measured as sampling units as well
+#define NUM_SAMPLED_CACHES 4
+
+extern uint64_t knob_sampling_period,
+                knob_sampling_unit,
+                knob_sampling_warming;
+
+// stop reading the trace until the pipeline and the caches are empty
+extern uint8_t sampling_drain;
+
+class SAMPLING_STATS {
+  public:
+    uint8_t measuring;
+    uint64_t num_unit,
+             begin_instr, begin_cycle,
+             total_instr, total_cycle,
+             begin_access[NUM_SAMPLED_CACHES][NUM_TYPES], begin_hit[NUM_SAMPLED_CACHES][NUM_TYPES], begin_miss[NUM_SAMPLED_CACHES][NUM_TYPES],
+             total_access[NUM_SAMPLED_CACHES][NUM_TYPES], total_hit[NUM_SAMPLED_CACHES][NUM_TYPES], total_miss[NUM_SAMPLED_CACHES][NUM_TYPES];
+
+    // the functional warming between units trains the branch predictor, but only the units count
+    uint64_t begin_branch, begin_mispredictions, begin_rob_occupancy, begin_branch_types[8],
+             total_branch, total_mispredictions, total_rob_occupancy, total_branch_types[8];
+
+    // per-unit sums for the confidence intervals
+    double cpi_sum, cpi_square_sum,
+           mpki_sum[NUM_SAMPLED_CACHES], mpki_square_sum[NUM_SAMPLED_CACHES];
+};
+
+extern SAMPLING_STATS sampling_stats[NUM_CPUS];
+
+// L1D, L1I, L2C, and LLC of cpu
+CACHE *sampled_cache(uint32_t cpu, uint32_t n);
+
+void    begin_sampling_unit(SAMPLING_STATS *stats, uint32_t i),
+        end_sampling_unit(SAMPLING_STATS *stats, uint32_t i),
+        operate_sampled_cycle(),
+        finish_sampled_simulation(uint32_t i),
+        run_sampled_simulation();
+uint8_t sampling_drained();
+
+#endif
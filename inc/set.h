@@ -14,8 +14,8 @@
 #define TYPE	unsigned short int
 //#define MAX_SIZE	ROB_SIZE
 // sethpugsley - changed this from ROB_SIZE to allow for non-power-of-2 ROB sizes, like real CPUs have
-// but MAX_SIZE here still requires a power-of-2 number
-#define MAX_SIZE	512
+// the bits of a large set grow with its largest member, so MAX_SIZE only follows from TYPE
+#define MAX_SIZE	65536
 
 // tuned empirically
 
@@ -28,28 +28,61 @@ class fastset {
 		TYPE 
 			values[SMALL_SIZE];
 
-		// the bits representing the set
-		unsigned long long int 
-			bits[MAX_SIZE/64];
+		// the bits representing a large set, as many 64 bit words as its largest member needs
+		struct {
+			unsigned long long int *words;
+			unsigned int size;
+		} bits;
 	} data;
 
 	int
 		card;		// cardinality of small set
 
+	// make room for at least size words of bits
+
+	void grow (unsigned int size) {
+		if (size <= data.bits.size) return;
+		if (size < 2*data.bits.size) size = 2*data.bits.size;
+		unsigned long long int *words = new unsigned long long int[size];
+		memcpy (words, data.bits.words, sizeof (unsigned long long int) * data.bits.size);
+		memset (words + data.bits.size, 0, sizeof (unsigned long long int) * (size - data.bits.size));
+		delete[] data.bits.words;
+		data.bits.words = words;
+		data.bits.size = size;
+	}
+
 	// set a bit in the bits
 
 	void setbit (TYPE x) {
-		int word = x >> 6;
+		unsigned int word = x >> 6;
 		int bit = x & 63;
-		data.bits[word] |= 1ull << bit;
+		grow (word+1);
+		data.bits.words[word] |= 1ull << bit;
 	}
 
 	// get one of the bits
 
 	bool getbit (TYPE x) {
-		int word = x >> 6;
+		unsigned int word = x >> 6;
 		int bit = x & 63;
-		return (data.bits[word] >> bit) & 1;
+		return (word < data.bits.size) && ((data.bits.words[word] >> bit) & 1);
+	}
+
+	// a small set is copied by value, the bits of a large set are duplicated
+
+	void copy (const fastset & other) {
+		card = other.card;
+		if (card < SMALL_SIZE) {
+			memcpy (data.values, other.data.values, sizeof (TYPE) * card);
+			return;
+		}
+		data.bits.size = other.data.bits.size;
+		data.bits.words = new unsigned long long int[data.bits.size];
+		memcpy (data.bits.words, other.data.bits.words, sizeof (unsigned long long int) * data.bits.size);
+	}
+
+	void free_bits (void) {
+		if (card >= SMALL_SIZE) delete[] data.bits.words;
 	}
 
 	// insert an item into a small set
@@ -123,7 +156,8 @@ class fastset {
 	
 		TYPE tmp[SMALL_SIZE];
 		memcpy (tmp, data.values, sizeof (TYPE) * card);
-		memset (data.bits, 0, sizeof (data.bits));
+		data.bits.words = NULL;
+		data.bits.size = 0;
 		for (int i=0; i<card; i++) setbit (tmp[i]);
 	}
 
@@ -133,9 +167,26 @@ public:
 
 	fastset (void) { card = 0; }
 
+	fastset (const fastset & other) { copy (other); }
+
+	fastset & operator= (const fastset & other) {
+		if (this != &other) {
+			free_bits ();
+			copy (other);
+		}
+		return *this;
+	}
+
 	// destructor
 
-	~fastset (void) { }
+	~fastset (void) { free_bits (); }
+
+	// make the set empty
+
+	void clear (void) {
+		free_bits ();
+		card = 0;
+	}
 
 	// insert a value into the set
 
@@ -207,12 +258,10 @@ public:
 			assert (other.card >= SMALL_SIZE);
 		}
 
-		// lim is the next multiple of 64
-
-		int lim = ((n | 63) + 1) / 64;
-
 		// bitwise OR the other bits into this set
-		for (int i=0; i<lim; i++) data.bits[i] |= other.data.bits[i];
+
+		grow (other.data.bits.size);
+		for (unsigned int i=0; i<other.data.bits.size; i++) data.bits.words[i] |= other.data.bits.words[i];
 	}
 
 	// expand the entire set into the array v, returning the cardinality
@@ -227,21 +276,14 @@ public:
 			return card;
 		}
 
-		// go through the bit array looking for elements
+		// go through the words of the bit array, and the set bits of each word
 
 		int k = 0;
-		TYPE i;
-		for (i=0; i<n; i+=64) {
-
-			// if this 64 bit subset is not empty, copy it into v
-
-			if (data.bits[i/64]) {
-				for (TYPE j=0; j<64; j++) {
-					TYPE l = i + j;
-					if (l < n) {
-						if (getbit (l)) v[k++] = l;
-					} else break;
-				}
+		for (unsigned int i=0; (i<data.bits.size) && ((int)(i*64) < n); i++) {
+			for (unsigned long long int word = data.bits.words[i]; word; word &= word-1) {
+				int l = i*64 + __builtin_ctzll (word);
+				if (l >= n) break;
+				v[k++] = l;
 			}
 		}
 		return k;
@@ -0,0 +1,21 @@
+#ifndef SIMPOINT_H
+#define SIMPOINT_H
+
+#include "sampling.h"
+
+// SIMPOINTS
+// simulate only the regions listed in the simpoints file, one (start instruction, weight) pair per line
+// each region is simulation_instructions long and is functionally warmed for warmup_instructions
+extern char *knob_simpoints;
+
+class SIMPOINT {
+  public:
+    uint64_t start;
+    double weight;
+    SAMPLING_STATS stats;
+};
+
+// skip to each region in a single pass over the trace, warm it up, and simulate it
+void run_simpoint_simulation();
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "champsim.h"
+
+// SWEEP
+// when the warmup finishes, fork one child per line of the sweep file
+// the children share the warmed-up state copy-on-write, apply the options on their line,
+// and write their results to <sweep file>.<n>
+extern char *knob_sweep;
+
+// the lines of a sweep or lockstep file, without empty lines and lines starting with #
+void read_point_file(const char *file_name, const char *kind, vector<string> &points);
+void apply_point_options(string line);
+
+// returns in each child; the parent waits for all children and exits
+void fork_sweep();
+
+#endif
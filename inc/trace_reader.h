@@ -0,0 +1,131 @@
+#ifndef TRACE_READER_H
+#define TRACE_READER_H
+
+#include "parallel.h"
+
+// TRACE READER
+// each core decompresses its trace in-process (zlib for .gz, liblzma for .xz, libzstd for .zst
+// when built with -DTRACE_ZSTD, and the native format of inc/native_trace.h for .cst) on its own
+// reader thread, which fills a ring of trace records;
+// the simulation thread copies one record at a time out of the ring
+// an uncompressed .champsimtrace file is instead mapped into memory and read in place, without a
+// reader thread; concurrent runs on the same trace share the page cache copy of it
+#define TRACE_CHUNK_RECORDS 4096
+#define TRACE_RING_CHUNKS 32
+#define TRACE_INPUT_BUFFER (1 << 20)
+
+// a stream of decompressed trace bytes
+class TRACE_DECODER {
+  public:
+    virtual ~TRACE_DECODER() {};
+
+    // fills buffer with size bytes, or fewer at the end of the trace
+    virtual size_t read(void *buffer, size_t size) = 0;
+
+    // the last record at or before record (counting on across repetitions of the trace)
+    // that decoding can start from; without a block index, only the beginning of the trace
+    virtual uint64_t seek_point(uint64_t record) { return 0; };
+
+    // continue decoding from seek_point(record), e.g., seek(0) starts over in-process
+    virtual void seek(uint64_t record) = 0;
+};
+
+// opens the decoder matching the extension of file_name, or returns NULL
+TRACE_DECODER *open_trace_decoder(const char *file_name);
+
+// trace bytes written into a file descriptor by another process, see -lockstep
+TRACE_DECODER *open_fd_decoder(int fd);
+
+// the uncompressed copy of name in broker_dir, keyed on its device and inode, which the first process to ask for it decompresses
+// while the others wait; the copy is made again if the trace is newer, see -trace_broker
+string share_trace(const char *name, const char *broker_dir);
+
+class TRACE_CHUNK {
+  public:
+    uint32_t num_records;
+    uint8_t end_of_trace; // the records after this chunk start over from the beginning of the trace
+    char *data;
+
+    TRACE_CHUNK() {
+        num_records = 0;
+        end_of_trace = 0;
+        data = NULL;
+    };
+
+    ~TRACE_CHUNK() {
+        delete[] data;
+    };
+};
+
+class TRACE_READER {
+  public:
+    char file_name[1024];
+    uint32_t record_size;
+    uint8_t rewindable; // 0 if the trace comes from a file descriptor
+
+    TRACE_DECODER *decoder;
+    SPSC_QUEUE<TRACE_CHUNK> ring{TRACE_RING_CHUNKS};
+    thread *worker;
+    pid_t worker_pid;
+    atomic<uint8_t> stop;
+
+    // next record of the chunk at the front of the ring
+    uint32_t current_record;
+
+    // an uncompressed trace mapped into memory, and the next record in it
+    const char *mapped;
+    uint64_t mapped_size, mapped_records, mapped_record;
+
+    // records read or skipped since the trace was opened, counting on across repetitions
+    uint64_t position;
+
+    TRACE_READER() {
+        file_name[0] = 0;
+        record_size = 0;
+        rewindable = 1;
+        decoder = NULL;
+        worker = NULL;
+        worker_pid = 0;
+        stop = 0;
+        current_record = 0;
+        position = 0;
+        mapped = NULL;
+        mapped_size = 0;
+        mapped_records = 0;
+        mapped_record = 0;
+    };
+
+    ~TRACE_READER() {
+        stop_worker();
+        delete decoder;
+        unmap();
+    };
+
+    // returns 0 if the trace cannot be opened
+    uint8_t open(const char *name, uint32_t size);
+
+    // read from fd instead of the trace file, e.g., in a -lockstep system
+    void open_fd(int fd, uint32_t size);
+
+    // make record the next one read, by decoding forward from the current position
+    // or by jumping to the nearest block before it when the trace has a block index
+    void seek(uint64_t record);
+
+    // read past num_records records without copying them
+    void skip(uint64_t num_records);
+
+    // the next record, which stays valid until the next call; returns NULL at the end of the trace,
+    // and the next call returns the first record again
+    const void *next();
+
+    // copies the next record into record; returns 0 at the end of the trace, like next()
+    uint8_t read(void *record);
+
+    uint8_t map(const char *name);
+    void    unmap(),
+            start_worker(),
+            stop_worker(),
+            fill();
+};
+
+#endif
@@ -21,6 +21,7 @@ class UNCORE {
     UNCORE(); 
 };
 
-extern UNCORE uncore;
+// allocated once the runtime configuration is loaded
+extern UNCORE *uncore;
 
 #endif
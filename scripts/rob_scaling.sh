@@ -0,0 +1,49 @@
+#!/bin/bash
+
+if [ "$#" -lt 4 ]; then
+    echo "Illegal number of parameters"
+    echo "Usage: ./rob_scaling.sh [BINARY] [N_WARM] [N_SIM] [TRACE] [OPTION]"
+    exit 1
+fi
+
+BINARY=${1}
+N_WARM=${2}
+N_SIM=${3}
+TRACE=${4}
+OPTION=${5}
+
+# Sanity check
+if [ ! -f "$BINARY" ] ; then
+    echo "[ERROR] Cannot find a ChampSim binary: $BINARY"
+    exit 1
+fi
+
+re='^[0-9]+$'
+if ! [[ $N_WARM =~ $re ]] || ! [[ $N_SIM =~ $re ]] ; then
+    echo "[ERROR]: Number of instructions is NOT a number" >&2;
+    exit 1
+fi
+
+if [ ! -f "$TRACE" ] ; then
+    echo "[ERROR] Cannot find a trace file: $TRACE"
+    exit 1
+fi
+
+CONFIG=$(mktemp)
+trap "rm -f $CONFIG" EXIT
+
+# The queues grow with the window, roughly in the proportions of the default core (ROB 352, LQ 128, SQ 72, scheduler 128)
+printf "%8s %10s %10s %12s\n" ROB_SIZE IPC seconds "ns/instr"
+for ROB in 256 512 1024 2048 4096
+do
+    cat > $CONFIG << END
+ROB_SIZE = $ROB
+LQ_SIZE = $((ROB * 3 / 8))
+SQ_SIZE = $((ROB / 4))
+SCHEDULER_SIZE = $((ROB * 3 / 8))
+END
+    START=$(date +%s.%N)
+    IPC=$($BINARY -config $CONFIG -warmup_instructions $N_WARM -simulation_instructions $N_SIM $OPTION -traces $TRACE 2>&1 | awk '/CPU 0 cumulative IPC/ { print $5 }')
+    END_TIME=$(date +%s.%N)
+    echo "$ROB $IPC $START $END_TIME $N_WARM $N_SIM" | awk '{ t = $4 - $3; printf "%8d %10s %10.2f %12.1f\n", $1, $2, t, t * 1e9 / ($5 + $6) }'
+done
@@ -1,5 +1,7 @@
 #include "block.h"
 
+// with -multithreaded, requests of different cores are not merged, since a shared queue returns the data to the core
+// of the merged entry; the cores of independent programs never share addresses, so they merge as before
 int PACKET_QUEUE::check_queue(PACKET *packet)
 {
     if ((head == tail) && occupancy == 0)
@@ -17,7 +19,7 @@ int PACKET_QUEUE::check_queue(PACKET *packet)
                 }
             }
             else {
-                if (entry[i].address == packet->address) {
+                if ((entry[i].address == packet->address) && (!knob_multithreaded || (entry[i].cpu == packet->cpu))) {
                     DP (if (warmup_complete[packet->cpu]) {
                     cout << "[" << NAME << "] " << __func__ << " cpu: " << packet->cpu << " instr_id: " << packet->instr_id << " same address: " << hex << packet->address;
                     cout << " full_addr: " << packet->full_addr << dec << " by instr_id: " << entry[i].instr_id << " index: " << i;
@@ -39,7 +41,7 @@ int PACKET_QUEUE::check_queue(PACKET *packet)
                 }
             }
             else {
-                if (entry[i].address == packet->address) {
+                if ((entry[i].address == packet->address) && (!knob_multithreaded || (entry[i].cpu == packet->cpu))) {
                     DP (if (warmup_complete[packet->cpu]) {
                     cout << "[" << NAME << "] " << __func__ << " cpu: " << packet->cpu << " instr_id: " << packet->instr_id << " same address: " << hex << packet->address;
                     cout << " full_addr: " << packet->full_addr << dec << " by instr_id: " << entry[i].instr_id << " index: " << i;
@@ -59,7 +61,7 @@ int PACKET_QUEUE::check_queue(PACKET *packet)
                 }
             }
             else {
-                if (entry[i].address == packet->address) {
+                if ((entry[i].address == packet->address) && (!knob_multithreaded || (entry[i].cpu == packet->cpu))) {
                     DP (if (warmup_complete[packet->cpu]) {
                     cout << "[" << NAME << "] " << __func__ << " cpu: " << packet->cpu << " instr_id: " << packet->instr_id << " same address: " << hex << packet->address;
                     cout << " full_addr: " << packet->full_addr << dec << " by instr_id: " << entry[i].instr_id << " index: " << i;
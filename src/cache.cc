@@ -22,7 +22,7 @@ void CACHE::handle_fill()
         // find victim
         uint32_t set = get_set(MSHR.entry[mshr_index].address), way;
         if (cache_type == IS_LLC) {
-            way = llc_find_victim(fill_cpu, MSHR.entry[mshr_index].instr_id, set, block[set], MSHR.entry[mshr_index].ip, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].type);
+            way = replacement->find_victim(fill_cpu, MSHR.entry[mshr_index].instr_id, set, block[set], MSHR.entry[mshr_index].ip, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].type);
         }
         else
             way = find_victim(fill_cpu, MSHR.entry[mshr_index].instr_id, set, block[set], MSHR.entry[mshr_index].ip, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].type);
@@ -32,7 +32,7 @@ void CACHE::handle_fill()
 
             // update replacement policy
             if (cache_type == IS_LLC) {
-                llc_update_replacement_state(fill_cpu, set, way, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].ip, 0, MSHR.entry[mshr_index].type, 0);
+                replacement->update_replacement_state(fill_cpu, set, way, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].ip, 0, MSHR.entry[mshr_index].type, 0);
 
             }
             else
@@ -127,22 +127,22 @@ void CACHE::handle_fill()
         if (do_fill){
             // update prefetcher
             if (cache_type == IS_L1D)
-	      l1d_prefetcher_cache_fill(MSHR.entry[mshr_index].full_addr, set, way, (MSHR.entry[mshr_index].type == PREFETCH) ? 1 : 0, block[set][way].address<<LOG2_BLOCK_SIZE,
+	      prefetcher->cache_fill(MSHR.entry[mshr_index].full_addr, set, way, (MSHR.entry[mshr_index].type == PREFETCH) ? 1 : 0, block[set][way].address<<LOG2_BLOCK_SIZE,
 					MSHR.entry[mshr_index].pf_metadata);
             if  (cache_type == IS_L2C)
-	      MSHR.entry[mshr_index].pf_metadata = l2c_prefetcher_cache_fill(MSHR.entry[mshr_index].address<<LOG2_BLOCK_SIZE, set, way, (MSHR.entry[mshr_index].type == PREFETCH) ? 1 : 0,
+	      MSHR.entry[mshr_index].pf_metadata = prefetcher->cache_fill(MSHR.entry[mshr_index].address<<LOG2_BLOCK_SIZE, set, way, (MSHR.entry[mshr_index].type == PREFETCH) ? 1 : 0,
 									     block[set][way].address<<LOG2_BLOCK_SIZE, MSHR.entry[mshr_index].pf_metadata);
             if (cache_type == IS_LLC)
 	      {
 		cpu = fill_cpu;
-		MSHR.entry[mshr_index].pf_metadata = llc_prefetcher_cache_fill(MSHR.entry[mshr_index].address<<LOG2_BLOCK_SIZE, set, way, (MSHR.entry[mshr_index].type == PREFETCH) ? 1 : 0,
+		MSHR.entry[mshr_index].pf_metadata = prefetcher->cache_fill(MSHR.entry[mshr_index].address<<LOG2_BLOCK_SIZE, set, way, (MSHR.entry[mshr_index].type == PREFETCH) ? 1 : 0,
 									       block[set][way].address<<LOG2_BLOCK_SIZE, MSHR.entry[mshr_index].pf_metadata);
 		cpu = 0;
 	      }
               
             // update replacement policy
             if (cache_type == IS_LLC) {
-                llc_update_replacement_state(fill_cpu, set, way, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].ip, block[set][way].full_addr, MSHR.entry[mshr_index].type, 0);
+                replacement->update_replacement_state(fill_cpu, set, way, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].ip, block[set][way].full_addr, MSHR.entry[mshr_index].type, 0);
             }
             else
                 update_replacement_state(fill_cpu, set, way, MSHR.entry[mshr_index].full_addr, MSHR.entry[mshr_index].ip, block[set][way].full_addr, MSHR.entry[mshr_index].type, 0);
@@ -241,7 +241,7 @@ void CACHE::handle_writeback()
         if (way >= 0) { // writeback hit (or RFO hit for L1D)
 
             if (cache_type == IS_LLC) {
-                llc_update_replacement_state(writeback_cpu, set, way, block[set][way].full_addr, WQ.entry[index].ip, 0, WQ.entry[index].type, 1);
+                replacement->update_replacement_state(writeback_cpu, set, way, block[set][way].full_addr, WQ.entry[index].ip, 0, WQ.entry[index].type, 1);
 
             }
             else
@@ -396,7 +396,7 @@ void CACHE::handle_writeback()
                 // find victim
                 uint32_t set = get_set(WQ.entry[index].address), way;
                 if (cache_type == IS_LLC) {
-                    way = llc_find_victim(writeback_cpu, WQ.entry[index].instr_id, set, block[set], WQ.entry[index].ip, WQ.entry[index].full_addr, WQ.entry[index].type);
+                    way = replacement->find_victim(writeback_cpu, WQ.entry[index].instr_id, set, block[set], WQ.entry[index].ip, WQ.entry[index].full_addr, WQ.entry[index].type);
                 }
                 else
                     way = find_victim(writeback_cpu, WQ.entry[index].instr_id, set, block[set], WQ.entry[index].ip, WQ.entry[index].full_addr, WQ.entry[index].type);
@@ -455,21 +455,21 @@ void CACHE::handle_writeback()
                 if (do_fill) {
                     // update prefetcher
                     if (cache_type == IS_L1D)
-		      l1d_prefetcher_cache_fill(WQ.entry[index].full_addr, set, way, 0, block[set][way].address<<LOG2_BLOCK_SIZE, WQ.entry[index].pf_metadata);
+		      prefetcher->cache_fill(WQ.entry[index].full_addr, set, way, 0, block[set][way].address<<LOG2_BLOCK_SIZE, WQ.entry[index].pf_metadata);
                     else if (cache_type == IS_L2C)
-		      WQ.entry[index].pf_metadata = l2c_prefetcher_cache_fill(WQ.entry[index].address<<LOG2_BLOCK_SIZE, set, way, 0,
+		      WQ.entry[index].pf_metadata = prefetcher->cache_fill(WQ.entry[index].address<<LOG2_BLOCK_SIZE, set, way, 0,
 									      block[set][way].address<<LOG2_BLOCK_SIZE, WQ.entry[index].pf_metadata);
                     if (cache_type == IS_LLC)
 		      {
 			cpu = writeback_cpu;
-			WQ.entry[index].pf_metadata =llc_prefetcher_cache_fill(WQ.entry[index].address<<LOG2_BLOCK_SIZE, set, way, 0,
+			WQ.entry[index].pf_metadata =prefetcher->cache_fill(WQ.entry[index].address<<LOG2_BLOCK_SIZE, set, way, 0,
 									       block[set][way].address<<LOG2_BLOCK_SIZE, WQ.entry[index].pf_metadata);
 			cpu = 0;
 		      }
 
                     // update replacement policy
                     if (cache_type == IS_LLC) {
-                        llc_update_replacement_state(writeback_cpu, set, way, WQ.entry[index].full_addr, WQ.entry[index].ip, block[set][way].full_addr, WQ.entry[index].type, 0);
+                        replacement->update_replacement_state(writeback_cpu, set, way, WQ.entry[index].full_addr, WQ.entry[index].ip, block[set][way].full_addr, WQ.entry[index].type, 0);
                     }
                     else
                         update_replacement_state(writeback_cpu, set, way, WQ.entry[index].full_addr, WQ.entry[index].ip, block[set][way].full_addr, WQ.entry[index].type, 0);
@@ -561,20 +561,20 @@ void CACHE::handle_read()
                 // update prefetcher on load instruction
 		if (RQ.entry[index].type == LOAD) {
                     if (cache_type == IS_L1D) 
-		      l1d_prefetcher_operate(RQ.entry[index].full_addr, RQ.entry[index].ip, 1, RQ.entry[index].type);
+		      prefetcher->operate(RQ.entry[index].full_addr, RQ.entry[index].ip, 1, RQ.entry[index].type, 0);
                     else if (cache_type == IS_L2C)
-		      l2c_prefetcher_operate(block[set][way].address<<LOG2_BLOCK_SIZE, RQ.entry[index].ip, 1, RQ.entry[index].type, 0);
+		      prefetcher->operate(block[set][way].address<<LOG2_BLOCK_SIZE, RQ.entry[index].ip, 1, RQ.entry[index].type, 0);
                     else if (cache_type == IS_LLC)
 		      {
 			cpu = read_cpu;
-			llc_prefetcher_operate(block[set][way].address<<LOG2_BLOCK_SIZE, RQ.entry[index].ip, 1, RQ.entry[index].type, 0);
+			prefetcher->operate(block[set][way].address<<LOG2_BLOCK_SIZE, RQ.entry[index].ip, 1, RQ.entry[index].type, 0);
 			cpu = 0;
 		      }
                 }
 
                 // update replacement policy
                 if (cache_type == IS_LLC) {
-                    llc_update_replacement_state(read_cpu, set, way, block[set][way].full_addr, RQ.entry[index].ip, 0, RQ.entry[index].type, 1);
+                    replacement->update_replacement_state(read_cpu, set, way, block[set][way].full_addr, RQ.entry[index].ip, 0, RQ.entry[index].type, 1);
 
                 }
                 else
@@ -783,13 +783,13 @@ void CACHE::handle_read()
                     // update prefetcher on load instruction
 		    if (RQ.entry[index].type == LOAD) {
                         if (cache_type == IS_L1D) 
-                            l1d_prefetcher_operate(RQ.entry[index].full_addr, RQ.entry[index].ip, 0, RQ.entry[index].type);
+                            prefetcher->operate(RQ.entry[index].full_addr, RQ.entry[index].ip, 0, RQ.entry[index].type, 0);
                         if (cache_type == IS_L2C)
-			  l2c_prefetcher_operate(RQ.entry[index].address<<LOG2_BLOCK_SIZE, RQ.entry[index].ip, 0, RQ.entry[index].type, 0);
+			  prefetcher->operate(RQ.entry[index].address<<LOG2_BLOCK_SIZE, RQ.entry[index].ip, 0, RQ.entry[index].type, 0);
                         if (cache_type == IS_LLC)
 			  {
 			    cpu = read_cpu;
-			    llc_prefetcher_operate(RQ.entry[index].address<<LOG2_BLOCK_SIZE, RQ.entry[index].ip, 0, RQ.entry[index].type, 0);
+			    prefetcher->operate(RQ.entry[index].address<<LOG2_BLOCK_SIZE, RQ.entry[index].ip, 0, RQ.entry[index].type, 0);
 			    cpu = 0;
 			  }
                     }
@@ -837,7 +837,7 @@ void CACHE::handle_prefetch()
 
                 // update replacement policy
                 if (cache_type == IS_LLC) {
-                    llc_update_replacement_state(prefetch_cpu, set, way, block[set][way].full_addr, PQ.entry[index].ip, 0, PQ.entry[index].type, 1);
+                    replacement->update_replacement_state(prefetch_cpu, set, way, block[set][way].full_addr, PQ.entry[index].ip, 0, PQ.entry[index].type, 1);
 
                 }
                 else
@@ -851,13 +851,13 @@ void CACHE::handle_prefetch()
 		if(PQ.entry[index].pf_origin_level < fill_level)
 		  {
 		    if (cache_type == IS_L1D)
-		      l1d_prefetcher_operate(PQ.entry[index].full_addr, PQ.entry[index].ip, 1, PREFETCH);
+		      prefetcher->operate(PQ.entry[index].full_addr, PQ.entry[index].ip, 1, PREFETCH, 0);
                     else if (cache_type == IS_L2C)
-                      PQ.entry[index].pf_metadata = l2c_prefetcher_operate(block[set][way].address<<LOG2_BLOCK_SIZE, PQ.entry[index].ip, 1, PREFETCH, PQ.entry[index].pf_metadata);
+                      PQ.entry[index].pf_metadata = prefetcher->operate(block[set][way].address<<LOG2_BLOCK_SIZE, PQ.entry[index].ip, 1, PREFETCH, PQ.entry[index].pf_metadata);
                     else if (cache_type == IS_LLC)
 		      {
 			cpu = prefetch_cpu;
-			PQ.entry[index].pf_metadata = llc_prefetcher_operate(block[set][way].address<<LOG2_BLOCK_SIZE, PQ.entry[index].ip, 1, PREFETCH, PQ.entry[index].pf_metadata);
+			PQ.entry[index].pf_metadata = prefetcher->operate(block[set][way].address<<LOG2_BLOCK_SIZE, PQ.entry[index].ip, 1, PREFETCH, PQ.entry[index].pf_metadata);
 			cpu = 0;
 		      }
 		  }
@@ -930,7 +930,7 @@ void CACHE::handle_prefetch()
 			      if (cache_type == IS_LLC)
 				{
 				  cpu = prefetch_cpu;
-				  PQ.entry[index].pf_metadata = llc_prefetcher_operate(PQ.entry[index].address<<LOG2_BLOCK_SIZE, PQ.entry[index].ip, 0, PREFETCH, PQ.entry[index].pf_metadata);
+				  PQ.entry[index].pf_metadata = prefetcher->operate(PQ.entry[index].address<<LOG2_BLOCK_SIZE, PQ.entry[index].ip, 0, PREFETCH, PQ.entry[index].pf_metadata);
 				  cpu = 0;
 				}
 			    }
@@ -951,9 +951,9 @@ void CACHE::handle_prefetch()
 			  if(PQ.entry[index].pf_origin_level < fill_level)
 			    {
 			      if (cache_type == IS_L1D)
-				l1d_prefetcher_operate(PQ.entry[index].full_addr, PQ.entry[index].ip, 0, PREFETCH);
+				prefetcher->operate(PQ.entry[index].full_addr, PQ.entry[index].ip, 0, PREFETCH, 0);
 			      if (cache_type == IS_L2C)
-				PQ.entry[index].pf_metadata = l2c_prefetcher_operate(PQ.entry[index].address<<LOG2_BLOCK_SIZE, PQ.entry[index].ip, 0, PREFETCH, PQ.entry[index].pf_metadata);
+				PQ.entry[index].pf_metadata = prefetcher->operate(PQ.entry[index].address<<LOG2_BLOCK_SIZE, PQ.entry[index].ip, 0, PREFETCH, PQ.entry[index].pf_metadata);
 			    }
 			  
 			  // add it to MSHRs if this prefetch miss will be filled to this cache level
@@ -1045,6 +1045,26 @@ void CACHE::operate()
         handle_prefetch();
 }
 
+uint64_t CACHE::next_event_cycle()
+{
+    // operate() only looks at the next fill and the head of each queue
+    uint64_t next = UINT64_MAX;
+
+    if ((MSHR.next_fill_index != MSHR_SIZE) && (MSHR.next_fill_cycle < next))
+        next = MSHR.next_fill_cycle;
+
+    if (WQ.occupancy && (WQ.entry[WQ.head].event_cycle < next))
+        next = WQ.entry[WQ.head].event_cycle;
+
+    if (RQ.occupancy && (RQ.entry[RQ.head].event_cycle < next))
+        next = RQ.entry[RQ.head].event_cycle;
+
+    if (PQ.occupancy && (PQ.entry[PQ.head].event_cycle < next))
+        next = PQ.entry[PQ.head].event_cycle;
+
+    return next;
+}
+
 uint32_t CACHE::get_set(uint64_t address)
 {
     return (uint32_t) (address & ((1 << lg2(NUM_SET)) - 1)); 
@@ -1377,6 +1397,127 @@ int CACHE::add_wq(PACKET *packet)
     return -1;
 }
 
+void CACHE::functional_access(PACKET *packet)
+{
+    // functional warmup: look up this level, bring the block in from the levels below on a miss,
+    // and train the replacement policy and prefetcher with no queues, MSHRs, or latency
+    uint32_t access_cpu = packet->cpu,
+             set = get_set(packet->address);
+    int way = check_hit(packet);
+
+    // run prefetcher on demand loads and on prefetches from higher caches
+    uint8_t train = (packet->type == LOAD) || ((packet->type == PREFETCH) && (packet->pf_origin_level < fill_level));
+    if (train) {
+        uint64_t pf_addr = (way >= 0) ? (block[set][way].address<<LOG2_BLOCK_SIZE) : (packet->address<<LOG2_BLOCK_SIZE);
+        if (cache_type == IS_L1D)
+            prefetcher->operate(packet->full_addr, packet->ip, (way >= 0), packet->type, 0);
+        else if (cache_type == IS_L2C)
+            packet->pf_metadata = prefetcher->operate(pf_addr, packet->ip, (way >= 0), packet->type, packet->pf_metadata);
+        else if (cache_type == IS_LLC) {
+            cpu = access_cpu;
+            packet->pf_metadata = prefetcher->operate(pf_addr, packet->ip, (way >= 0), packet->type, packet->pf_metadata);
+            cpu = 0;
+        }
+    }
+
+    if (way >= 0) { // hit
+
+        if (cache_type == IS_LLC)
+            replacement->update_replacement_state(access_cpu, set, way, block[set][way].full_addr, packet->ip, 0, packet->type, 1);
+        else
+            update_replacement_state(access_cpu, set, way, block[set][way].full_addr, packet->ip, 0, packet->type, 1);
+
+        // translation is returned to the upper level
+        if ((cache_type == IS_ITLB) || (cache_type == IS_DTLB) || (cache_type == IS_STLB))
+            packet->data = block[set][way].data;
+
+        if (packet->type != PREFETCH) {
+            if (block[set][way].prefetch) {
+                pf_useful++;
+                block[set][way].prefetch = 0;
+            }
+            block[set][way].used = 1;
+        }
+
+        if ((packet->type == WRITEBACK) || ((packet->type == RFO) && (cache_type == IS_L1D)))
+            block[set][way].dirty = 1;
+    }
+    else { // miss
+
+        // writebacks allocate without reading the lower level
+        if (packet->type != WRITEBACK) {
+            if (lower_level)
+                lower_level->functional_access(packet);
+            else if (cache_type == IS_STLB) // emulate page table walk
+                packet->data = va_to_pa(access_cpu, packet->instr_id, packet->full_addr, packet->address, 0) >> LOG2_PAGE_SIZE;
+        }
+
+        // prefetches are filled only up to their fill level
+        if (packet->fill_level <= fill_level) {
+            if (cache_type == IS_LLC)
+                way = replacement->find_victim(access_cpu, packet->instr_id, set, block[set], packet->ip, packet->full_addr, packet->type);
+            else
+                way = find_victim(access_cpu, packet->instr_id, set, block[set], packet->ip, packet->full_addr, packet->type);
+
+#ifdef LLC_BYPASS
+            if ((cache_type == IS_LLC) && (way == (int)LLC_WAY)) {
+                replacement->update_replacement_state(access_cpu, set, way, packet->full_addr, packet->ip, 0, packet->type, 0);
+                functional_prefetch();
+                return;
+            }
+#endif
+
+            if (block[set][way].dirty && lower_level) {
+                PACKET writeback_packet;
+
+                writeback_packet.fill_level = fill_level << 1;
+                writeback_packet.cpu = access_cpu;
+                writeback_packet.address = block[set][way].address;
+                writeback_packet.full_addr = block[set][way].full_addr;
+                writeback_packet.data = block[set][way].data;
+                writeback_packet.instr_id = packet->instr_id;
+                writeback_packet.ip = 0;
+                writeback_packet.type = WRITEBACK;
+
+                lower_level->functional_access(&writeback_packet);
+            }
+
+            if (cache_type == IS_L1D)
+                prefetcher->cache_fill(packet->full_addr, set, way, (packet->type == PREFETCH) ? 1 : 0, block[set][way].address<<LOG2_BLOCK_SIZE, packet->pf_metadata);
+            else if (cache_type == IS_L2C)
+                packet->pf_metadata = prefetcher->cache_fill(packet->address<<LOG2_BLOCK_SIZE, set, way, (packet->type == PREFETCH) ? 1 : 0, block[set][way].address<<LOG2_BLOCK_SIZE, packet->pf_metadata);
+            else if (cache_type == IS_LLC) {
+                cpu = access_cpu;
+                packet->pf_metadata = prefetcher->cache_fill(packet->address<<LOG2_BLOCK_SIZE, set, way, (packet->type == PREFETCH) ? 1 : 0, block[set][way].address<<LOG2_BLOCK_SIZE, packet->pf_metadata);
+                cpu = 0;
+            }
+
+            if (cache_type == IS_LLC)
+                replacement->update_replacement_state(access_cpu, set, way, packet->full_addr, packet->ip, block[set][way].full_addr, packet->type, 0);
+            else
+                update_replacement_state(access_cpu, set, way, packet->full_addr, packet->ip, block[set][way].full_addr, packet->type, 0);
+
+            fill_cache(set, way, packet);
+
+            if ((packet->type == WRITEBACK) || ((packet->type == RFO) && (cache_type == IS_L1D)))
+                block[set][way].dirty = 1;
+        }
+    }
+
+    // prefetches issued by the prefetcher above
+    functional_prefetch();
+}
+
+void CACHE::functional_prefetch()
+{
+    while (PQ.occupancy) {
+        PACKET pf_packet = PQ.entry[PQ.head];
+        PQ.remove_queue(&PQ.entry[PQ.head]);
+
+        functional_access(&pf_packet);
+    }
+}
+
 int CACHE::prefetch_line(uint64_t ip, uint64_t base_addr, uint64_t pf_addr, int pf_fill_level, uint32_t prefetch_metadata)
 {
     pf_requested++;
@@ -1651,6 +1792,10 @@ int CACHE::check_mshr(PACKET *packet)
     {
       if (MSHR.entry[index].address == packet->address)
 	{
+	  // the miss of another core (see -multithreaded) is not merged, the request waits until the block is filled
+	  if (knob_multithreaded && (MSHR.entry[index].cpu != packet->cpu))
+	    return -2;
+
 	  //if(MSHR.entry[index].instruction != packet->instruction)
 	  //  {
 	  //    instruction_and_data_collision = true;
@@ -0,0 +1,250 @@
+#include <sstream>
+
+#include "checkpoint.h"
+#include "ooo_cpu.h"
+#include "uncore.h"
+
+char *knob_save_checkpoint = NULL,
+     *knob_load_checkpoint = NULL;
+
+FILE *checkpoint_file = NULL;
+uint8_t checkpoint_saving = 0;
+
+void checkpoint_data(void *data, uint64_t size)
+{
+    if (size == 0)
+        return;
+
+    size_t done;
+    if (checkpoint_saving)
+        done = fwrite(data, size, 1, checkpoint_file);
+    else
+        done = fread(data, size, 1, checkpoint_file);
+
+    if (done != 1) {
+        cerr << "*** CANNOT " << (checkpoint_saving ? "WRITE" : "READ") << " CHECKPOINT ***" << endl;
+        assert(0);
+    }
+}
+
+uint8_t checkpoint_section(const char *name, uint64_t size)
+{
+    char section_name[CHECKPOINT_NAME_SIZE];
+    uint64_t section_size = size;
+
+    if (checkpoint_saving) {
+        memset(section_name, 0, CHECKPOINT_NAME_SIZE);
+        snprintf(section_name, CHECKPOINT_NAME_SIZE, "%s", name);
+        checkpoint_data(section_name, CHECKPOINT_NAME_SIZE);
+        checkpoint_data(&section_size, sizeof(section_size));
+        return 1;
+    }
+
+    checkpoint_data(section_name, CHECKPOINT_NAME_SIZE);
+    checkpoint_data(&section_size, sizeof(section_size));
+    section_name[CHECKPOINT_NAME_SIZE-1] = 0;
+
+    if ((strncmp(section_name, name, CHECKPOINT_NAME_SIZE-1) == 0) && (section_size == size))
+        return 1;
+    if ((section_size == 0) && (size == 0)) // neither policy keeps any state
+        return 0;
+
+    // saved by a different policy or geometry, keep the initial state
+    cout << "Checkpoint section " << section_name << " (" << section_size << " bytes) does not match ";
+    cout << name << " (" << size << " bytes), starting it from its initial state" << endl;
+    if (fseek(checkpoint_file, section_size, SEEK_CUR)) {
+        cerr << "*** CANNOT READ CHECKPOINT ***" << endl;
+        assert(0);
+    }
+
+    return 0;
+}
+
+void checkpoint_map(map <uint64_t, uint64_t> &table)
+{
+    uint64_t num_entries = table.size();
+    checkpoint_data(&num_entries, sizeof(num_entries));
+
+    if (checkpoint_saving) {
+        for (map <uint64_t, uint64_t>::iterator it = table.begin(); it != table.end(); it++) {
+            uint64_t entry[2] = {it->first, it->second};
+            checkpoint_data(entry, sizeof(entry));
+        }
+    }
+    else {
+        table.clear();
+        for (uint64_t i=0; i<num_entries; i++) {
+            uint64_t entry[2];
+            checkpoint_data(entry, sizeof(entry));
+            table.insert(make_pair(entry[0], entry[1]));
+        }
+    }
+}
+
+void checkpoint_page_table()
+{
+    checkpoint_map(page_table);
+    checkpoint_map(inverse_table);
+    checkpoint_map(recent_page);
+
+    // page_queue is saved from front to back
+    uint64_t num_entries = page_queue.size();
+    checkpoint_data(&num_entries, sizeof(num_entries));
+    if (checkpoint_saving) {
+        queue <uint64_t> copy = page_queue;
+        while (!copy.empty()) {
+            uint64_t vpage = copy.front();
+            checkpoint_data(&vpage, sizeof(vpage));
+            copy.pop();
+        }
+    }
+    else {
+        while (!page_queue.empty())
+            page_queue.pop();
+        for (uint64_t i=0; i<num_entries; i++) {
+            uint64_t vpage;
+            checkpoint_data(&vpage, sizeof(vpage));
+            page_queue.push(vpage);
+        }
+    }
+
+    checkpoint_data(&previous_ppage, sizeof(previous_ppage));
+    checkpoint_data(&num_adjacent_page, sizeof(num_adjacent_page));
+    checkpoint_data(&allocated_pages, sizeof(allocated_pages));
+    checkpoint_data(num_page, sizeof(num_page));
+    checkpoint_data(minor_fault, sizeof(minor_fault));
+    checkpoint_data(major_fault, sizeof(major_fault));
+
+    // random physical page allocator
+    string engine_state;
+    if (checkpoint_saving) {
+        ostringstream out;
+        out << champsim_rand.engine;
+        engine_state = out.str();
+    }
+    uint64_t engine_size = engine_state.size();
+    checkpoint_data(&engine_size, sizeof(engine_size));
+    engine_state.resize(engine_size);
+    checkpoint_data(&engine_state[0], engine_size);
+    if (checkpoint_saving == 0) {
+        istringstream in(engine_state);
+        in >> champsim_rand.engine;
+    }
+
+    // rand() has no portable state, so the saving and the loading runs both restart it here
+    srand(champsim_seed);
+}
+
+void checkpoint_cache(CACHE *cache)
+{
+    if (checkpoint_section(cache->NAME.c_str(), (cache->NUM_SET * cache->NUM_WAY * sizeof(BLOCK)) + (5 * sizeof(uint64_t))) == 0)
+        return;
+
+    for (uint32_t i=0; i<cache->NUM_SET; i++)
+        checkpoint_data(cache->block[i], cache->NUM_WAY * sizeof(BLOCK));
+
+    checkpoint_data(&cache->pf_requested, sizeof(cache->pf_requested));
+    checkpoint_data(&cache->pf_issued, sizeof(cache->pf_issued));
+    checkpoint_data(&cache->pf_useful, sizeof(cache->pf_useful));
+    checkpoint_data(&cache->pf_useless, sizeof(cache->pf_useless));
+    checkpoint_data(&cache->pf_fill, sizeof(cache->pf_fill));
+}
+
+void checkpoint_trace(uint32_t cpu)
+{
+    char trace_name[1024];
+    memset(trace_name, 0, sizeof(trace_name));
+    snprintf(trace_name, sizeof(trace_name), "%s", ooo_cpu[cpu].trace_string);
+    checkpoint_data(trace_name, sizeof(trace_name));
+
+    if ((checkpoint_saving == 0) && strncmp(trace_name, ooo_cpu[cpu].trace_string, sizeof(trace_name)-1))
+        cout << "CPU " << cpu << " checkpoint was taken from " << trace_name << " but runs " << ooo_cpu[cpu].trace_string << endl;
+
+    // the trace continues from the first instruction that was not retired
+    uint64_t trace_offset = ooo_cpu[cpu].trace_start + ooo_cpu[cpu].num_retired;
+    checkpoint_data(&trace_offset, sizeof(trace_offset));
+
+    if (checkpoint_saving == 0) {
+        ooo_cpu[cpu].seek_trace(trace_offset);
+        ooo_cpu[cpu].num_retired = trace_offset;
+        ooo_cpu[cpu].trace_start = 0;
+    }
+}
+
+void checkpoint_all()
+{
+    char magic[8];
+    uint32_t config[6] = {CHECKPOINT_VERSION, NUM_CPUS, LOG2_PAGE_SIZE, LOG2_BLOCK_SIZE, (uint32_t)sizeof(BLOCK), MAX_INSTR_DESTINATIONS},
+             saved_config[6];
+
+    memcpy(magic, CHECKPOINT_MAGIC, sizeof(magic));
+    memcpy(saved_config, config, sizeof(config));
+    checkpoint_data(magic, sizeof(magic));
+    checkpoint_data(saved_config, sizeof(saved_config));
+    if (memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) || (saved_config[0] != CHECKPOINT_VERSION)) {
+        cerr << "*** NOT A VERSION " << CHECKPOINT_VERSION << " CHECKPOINT ***" << endl;
+        assert(0);
+    }
+    if (memcmp(config, saved_config, sizeof(config))) {
+        cerr << "*** CHECKPOINT WAS SAVED WITH A DIFFERENT NUM_CPUS, PAGE SIZE, BLOCK SIZE, OR TRACE FORMAT ***" << endl;
+        assert(0);
+    }
+
+    checkpoint_page_table();
+
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        checkpoint_trace(i);
+
+        ooo_cpu[i].branch_predictor->checkpoint();
+        ooo_cpu[i].l1i_prefetcher->checkpoint();
+
+        checkpoint_cache(&ooo_cpu[i].ITLB);
+        checkpoint_cache(&ooo_cpu[i].DTLB);
+        checkpoint_cache(&ooo_cpu[i].STLB);
+        checkpoint_cache(&ooo_cpu[i].L1I);
+        checkpoint_cache(&ooo_cpu[i].L1D);
+        checkpoint_cache(&ooo_cpu[i].L2C);
+
+        ooo_cpu[i].L1D.prefetcher->checkpoint();
+        ooo_cpu[i].L2C.prefetcher->checkpoint();
+    }
+
+    checkpoint_cache(&uncore->LLC);
+    uncore->LLC.replacement->checkpoint();
+    uncore->LLC.prefetcher->checkpoint();
+}
+
+void save_checkpoint(const char *file_name)
+{
+    checkpoint_file = fopen(file_name, "wb");
+    if (checkpoint_file == NULL) {
+        cerr << "*** CANNOT OPEN CHECKPOINT FILE: " << file_name << " ***" << endl;
+        assert(0);
+    }
+
+    checkpoint_saving = 1;
+    checkpoint_all();
+    fclose(checkpoint_file);
+    checkpoint_file = NULL;
+
+    cout << "Saved checkpoint " << file_name << endl;
+}
+
+void load_checkpoint(const char *file_name)
+{
+    checkpoint_file = fopen(file_name, "rb");
+    if (checkpoint_file == NULL) {
+        cerr << "*** CANNOT OPEN CHECKPOINT FILE: " << file_name << " ***" << endl;
+        assert(0);
+    }
+
+    checkpoint_saving = 0;
+    checkpoint_all();
+    fclose(checkpoint_file);
+    checkpoint_file = NULL;
+
+    cout << "Loaded checkpoint " << file_name;
+    for (uint32_t i=0; i<NUM_CPUS; i++)
+        cout << " CPU " << i << " instructions: " << ooo_cpu[i].num_retired;
+    cout << endl;
+}
@@ -0,0 +1,154 @@
+// every CONFIG_PARAMETER is defined here
+#define CONFIG_DEFINE
+
+#include <fstream>
+#include <sstream>
+
+#include "ooo_cpu.h"
+#include "uncore.h"
+
+char *knob_config = NULL;
+
+#ifdef STATIC_CONFIG
+
+void load_config(const char *file_name)
+{
+    cerr << "*** THIS BINARY WAS BUILT WITH STATIC_CONFIG AND CANNOT LOAD " << file_name << " ***" << endl;
+    assert(0);
+}
+
+#else
+
+class CONFIG_ITEM {
+  public:
+    const char *name;
+    uint32_t *value;
+};
+
+#define CONFIG_VALUE(name) {#name, &name}
+
+CONFIG_ITEM config_items[] = {
+    // core
+    CONFIG_VALUE(FETCH_WIDTH), CONFIG_VALUE(DECODE_WIDTH), CONFIG_VALUE(EXEC_WIDTH), CONFIG_VALUE(LQ_WIDTH), CONFIG_VALUE(SQ_WIDTH),
+    CONFIG_VALUE(RETIRE_WIDTH), CONFIG_VALUE(SCHEDULER_SIZE), CONFIG_VALUE(BRANCH_MISPREDICT_PENALTY),
+    CONFIG_VALUE(INT_MUL_LATENCY), CONFIG_VALUE(INT_DIV_LATENCY), CONFIG_VALUE(FP_LATENCY), CONFIG_VALUE(FP_DIV_LATENCY), CONFIG_VALUE(SIMD_LATENCY),
+    CONFIG_VALUE(ROB_SIZE), CONFIG_VALUE(LQ_SIZE), CONFIG_VALUE(SQ_SIZE),
+
+    // caches
+    CONFIG_VALUE(ITLB_SET), CONFIG_VALUE(ITLB_WAY), CONFIG_VALUE(ITLB_RQ_SIZE), CONFIG_VALUE(ITLB_WQ_SIZE), CONFIG_VALUE(ITLB_PQ_SIZE), CONFIG_VALUE(ITLB_MSHR_SIZE), CONFIG_VALUE(ITLB_LATENCY),
+    CONFIG_VALUE(DTLB_SET), CONFIG_VALUE(DTLB_WAY), CONFIG_VALUE(DTLB_RQ_SIZE), CONFIG_VALUE(DTLB_WQ_SIZE), CONFIG_VALUE(DTLB_PQ_SIZE), CONFIG_VALUE(DTLB_MSHR_SIZE), CONFIG_VALUE(DTLB_LATENCY),
+    CONFIG_VALUE(STLB_SET), CONFIG_VALUE(STLB_WAY), CONFIG_VALUE(STLB_RQ_SIZE), CONFIG_VALUE(STLB_WQ_SIZE), CONFIG_VALUE(STLB_PQ_SIZE), CONFIG_VALUE(STLB_MSHR_SIZE), CONFIG_VALUE(STLB_LATENCY),
+    CONFIG_VALUE(L1I_SET), CONFIG_VALUE(L1I_WAY), CONFIG_VALUE(L1I_RQ_SIZE), CONFIG_VALUE(L1I_WQ_SIZE), CONFIG_VALUE(L1I_PQ_SIZE), CONFIG_VALUE(L1I_MSHR_SIZE), CONFIG_VALUE(L1I_LATENCY),
+    CONFIG_VALUE(L1D_SET), CONFIG_VALUE(L1D_WAY), CONFIG_VALUE(L1D_RQ_SIZE), CONFIG_VALUE(L1D_WQ_SIZE), CONFIG_VALUE(L1D_PQ_SIZE), CONFIG_VALUE(L1D_MSHR_SIZE), CONFIG_VALUE(L1D_LATENCY),
+    CONFIG_VALUE(L2C_SET), CONFIG_VALUE(L2C_WAY), CONFIG_VALUE(L2C_RQ_SIZE), CONFIG_VALUE(L2C_WQ_SIZE), CONFIG_VALUE(L2C_PQ_SIZE), CONFIG_VALUE(L2C_MSHR_SIZE), CONFIG_VALUE(L2C_LATENCY),
+    CONFIG_VALUE(LLC_SET), CONFIG_VALUE(LLC_WAY), CONFIG_VALUE(LLC_RQ_SIZE), CONFIG_VALUE(LLC_WQ_SIZE), CONFIG_VALUE(LLC_PQ_SIZE), CONFIG_VALUE(LLC_MSHR_SIZE), CONFIG_VALUE(LLC_LATENCY),
+
+    // DRAM, the LOG2_ values are derived
+    CONFIG_VALUE(DRAM_CHANNELS), CONFIG_VALUE(DRAM_RANKS), CONFIG_VALUE(DRAM_BANKS), CONFIG_VALUE(DRAM_ROWS), CONFIG_VALUE(DRAM_COLUMNS),
+    CONFIG_VALUE(DRAM_WQ_SIZE), CONFIG_VALUE(DRAM_RQ_SIZE)
+};
+
+#define NUM_CONFIG_ITEMS (sizeof(config_items) / sizeof(config_items[0]))
+
+// policies are selected by name, see inc/policy.h
+class CONFIG_POLICY {
+  public:
+    const char *name;
+    string *value;
+};
+
+CONFIG_POLICY config_policies[] = {
+    {"BRANCH_PREDICTOR", &knob_branch_predictor}, {"L1I_PREFETCHER", &knob_l1i_prefetcher}, {"L1D_PREFETCHER", &knob_l1d_prefetcher},
+    {"L2C_PREFETCHER", &knob_l2c_prefetcher}, {"LLC_PREFETCHER", &knob_llc_prefetcher}, {"LLC_REPLACEMENT", &knob_llc_replacement}
+};
+
+#define NUM_CONFIG_POLICIES (sizeof(config_policies) / sizeof(config_policies[0]))
+
+void check_config(uint8_t valid, const char *message)
+{
+    if (valid == 0) {
+        cerr << "*** INVALID CONFIGURATION: " << message << " ***" << endl;
+        assert(0);
+    }
+}
+
+uint8_t is_power_of_two(uint32_t value)
+{
+    return value && ((value & (value - 1)) == 0);
+}
+
+void load_config(const char *file_name)
+{
+    ifstream config_file(file_name);
+    if (!config_file.is_open()) {
+        cerr << "*** CANNOT OPEN CONFIG FILE: " << file_name << " ***" << endl;
+        assert(0);
+    }
+
+    string line;
+    while (getline(config_file, line)) {
+        if (line.find('#') != string::npos)
+            line.erase(line.find('#'));
+        if (line.find('=') != string::npos)
+            line[line.find('=')] = ' ';
+
+        string name, policy;
+        uint64_t value;
+        istringstream fields(line);
+        if (!(fields >> name))
+            continue;
+
+        uint32_t i;
+        for (i=0; i<NUM_CONFIG_POLICIES; i++) {
+            if (name == config_policies[i].name)
+                break;
+        }
+        if (i < NUM_CONFIG_POLICIES) {
+            if (!(fields >> policy)) {
+                cerr << "*** INVALID CONFIG LINE: " << line << " ***" << endl;
+                assert(0);
+            }
+            *config_policies[i].value = policy;
+            cout << "Config " << name << ": " << policy << endl;
+            continue;
+        }
+
+        if (!(fields >> value) || (value > UINT32_MAX)) {
+            cerr << "*** INVALID CONFIG LINE: " << line << " ***" << endl;
+            assert(0);
+        }
+
+        for (i=0; i<NUM_CONFIG_ITEMS; i++) {
+            if (name == config_items[i].name)
+                break;
+        }
+        if (i == NUM_CONFIG_ITEMS) {
+            cerr << "*** UNKNOWN CONFIG PARAMETER: " << name << " ***" << endl;
+            assert(0);
+        }
+
+        *config_items[i].value = value;
+        cout << "Config " << name << ": " << value << endl;
+    }
+
+    check_config(FETCH_WIDTH && DECODE_WIDTH && EXEC_WIDTH && LQ_WIDTH && SQ_WIDTH && RETIRE_WIDTH && SCHEDULER_SIZE, "widths must not be 0");
+    check_config(ROB_SIZE && LQ_SIZE && SQ_SIZE, "ROB_SIZE, LQ_SIZE, and SQ_SIZE must not be 0");
+    check_config(ROB_SIZE <= MAX_SIZE, "ROB_SIZE is larger than MAX_SIZE in inc/set.h");
+
+    // get_set() masks the address with NUM_SET-1
+    check_config(is_power_of_two(ITLB_SET) && is_power_of_two(DTLB_SET) && is_power_of_two(STLB_SET)
+                 && is_power_of_two(L1I_SET) && is_power_of_two(L1D_SET) && is_power_of_two(L2C_SET) && is_power_of_two(LLC_SET), "cache sets must be a power of 2");
+    check_config(ITLB_WAY && DTLB_WAY && STLB_WAY && L1I_WAY && L1D_WAY && L2C_WAY && LLC_WAY, "cache ways must not be 0");
+    check_config(ITLB_MSHR_SIZE && DTLB_MSHR_SIZE && STLB_MSHR_SIZE && L1I_MSHR_SIZE && L1D_MSHR_SIZE && L2C_MSHR_SIZE && LLC_MSHR_SIZE, "MSHR sizes must not be 0");
+
+    check_config(is_power_of_two(DRAM_CHANNELS) && is_power_of_two(DRAM_RANKS) && is_power_of_two(DRAM_BANKS)
+                 && is_power_of_two(DRAM_ROWS) && is_power_of_two(DRAM_COLUMNS), "DRAM dimensions must be a power of 2");
+    check_config(DRAM_WQ_SIZE && DRAM_RQ_SIZE, "DRAM queue sizes must not be 0");
+    LOG2_DRAM_CHANNELS = lg2(DRAM_CHANNELS);
+    LOG2_DRAM_RANKS = lg2(DRAM_RANKS);
+    LOG2_DRAM_BANKS = lg2(DRAM_BANKS);
+    LOG2_DRAM_ROWS = lg2(DRAM_ROWS);
+    LOG2_DRAM_COLUMNS = lg2(DRAM_COLUMNS);
+}
+
+#endif
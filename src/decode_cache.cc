@@ -0,0 +1,156 @@
+#include <cstddef>
+
+#include "decode_cache.h"
+
+// the registers of a record are compared and copied as one array
+static_assert(offsetof(input_instr, source_registers) == offsetof(input_instr, destination_registers) + NUM_INSTR_DESTINATIONS,
+              "source_registers must follow destination_registers");
+
+void decode_instr(const input_instr *instr, DECODED_INSTR *decoded)
+{
+    decoded->valid = 1;
+    decoded->ip = instr->ip;
+    decoded->trace_is_branch = instr->is_branch;
+    memcpy(decoded->registers, instr->destination_registers, sizeof(decoded->registers));
+
+    bool reads_sp = false;
+    bool writes_sp = false;
+    bool reads_flags = false;
+    bool reads_ip = false;
+    bool writes_ip = false;
+    bool reads_other = false;
+
+    int num_reg_ops = 0;
+    for (uint32_t i=0; i<NUM_INSTR_DESTINATIONS; i++) {
+        switch(instr->destination_registers[i]) {
+          case 0:
+            break;
+          case REG_STACK_POINTER:
+            writes_sp = true;
+            break;
+          case REG_INSTRUCTION_POINTER:
+            writes_ip = true;
+            break;
+          default:
+            break;
+        }
+
+        if (instr->destination_registers[i])
+            num_reg_ops++;
+    }
+
+    for (uint32_t i=0; i<NUM_INSTR_SOURCES; i++) {
+        switch(instr->source_registers[i]) {
+          case 0:
+            break;
+          case REG_STACK_POINTER:
+            reads_sp = true;
+            break;
+          case REG_FLAGS:
+            reads_flags = true;
+            break;
+          case REG_INSTRUCTION_POINTER:
+            reads_ip = true;
+            break;
+          default:
+            reads_other = true;
+            break;
+        }
+
+        if (instr->source_registers[i])
+            num_reg_ops++;
+    }
+    decoded->num_reg_ops = num_reg_ops;
+
+    decoded->is_branch = instr->is_branch;
+    decoded->always_taken = 0;
+    decoded->branch_type = NOT_BRANCH;
+
+    // determine what kind of branch this is, if any
+    if (!reads_sp && !reads_flags && writes_ip && !reads_other) {
+        // direct jump
+        decoded->is_branch = 1;
+        decoded->always_taken = 1;
+        decoded->branch_type = BRANCH_DIRECT_JUMP;
+    }
+    else if (!reads_sp && !reads_flags && writes_ip && reads_other) {
+        // indirect branch
+        decoded->is_branch = 1;
+        decoded->always_taken = 1;
+        decoded->branch_type = BRANCH_INDIRECT;
+    }
+    else if (!reads_sp && reads_ip && !writes_sp && writes_ip && reads_flags && !reads_other) {
+        // conditional branch
+        decoded->is_branch = 1;
+        decoded->branch_type = BRANCH_CONDITIONAL;
+    }
+    else if (reads_sp && reads_ip && writes_sp && writes_ip && !reads_flags && !reads_other) {
+        // direct call
+        decoded->is_branch = 1;
+        decoded->always_taken = 1;
+        decoded->branch_type = BRANCH_DIRECT_CALL;
+    }
+    else if (reads_sp && reads_ip && writes_sp && writes_ip && !reads_flags && reads_other) {
+        // indirect call
+        decoded->is_branch = 1;
+        decoded->always_taken = 1;
+        decoded->branch_type = BRANCH_INDIRECT_CALL;
+    }
+    else if (reads_sp && !reads_ip && writes_sp && writes_ip) {
+        // return
+        decoded->is_branch = 1;
+        decoded->always_taken = 1;
+        decoded->branch_type = BRANCH_RETURN;
+    }
+    else if (writes_ip) {
+        // some other branch type that doesn't fit the above categories
+        decoded->is_branch = 1;
+        decoded->branch_type = BRANCH_OTHER;
+    }
+}
+
+uint8_t DECODE_CACHE::load(const char *file_name)
+{
+    FILE *file = fopen(file_name, "rb");
+    if (file == NULL)
+        return 0;
+
+    char magic[8];
+    uint32_t version = 0, size = 0;
+    uint8_t loaded = (fread(magic, sizeof(magic), 1, file) == 1) && !memcmp(magic, DECODE_SIDECAR_MAGIC, sizeof(magic))
+                     && (fread(&version, sizeof(version), 1, file) == 1) && (version == DECODE_SIDECAR_VERSION)
+                     && (fread(&size, sizeof(size), 1, file) == 1) && (size == DECODE_CACHE_SIZE);
+    if (loaded) {
+        entry.resize(DECODE_CACHE_SIZE);
+        loaded = (fread(&entry[0], sizeof(DECODED_INSTR), DECODE_CACHE_SIZE, file) == DECODE_CACHE_SIZE);
+        if (!loaded) // a torn file must not leave half a table behind
+            entry.clear();
+    }
+
+    fclose(file);
+    return loaded;
+}
+
+uint8_t DECODE_CACHE::save(const char *file_name)
+{
+    if (entry.empty())
+        return 1;
+
+    // written next to the old sidecar and renamed over it, so a reader never sees half a file
+    char temp_name[1024];
+    snprintf(temp_name, sizeof(temp_name), "%s.%d", file_name, (int)getpid());
+    FILE *file = fopen(temp_name, "wb");
+    if (file == NULL)
+        return 0;
+
+    uint32_t version = DECODE_SIDECAR_VERSION, size = DECODE_CACHE_SIZE;
+    uint8_t saved = (fwrite(DECODE_SIDECAR_MAGIC, 8, 1, file) == 1) && (fwrite(&version, sizeof(version), 1, file) == 1)
+                    && (fwrite(&size, sizeof(size), 1, file) == 1)
+                    && (fwrite(&entry[0], sizeof(DECODED_INSTR), DECODE_CACHE_SIZE, file) == DECODE_CACHE_SIZE);
+    if (fclose(file) || !saved || rename(temp_name, file_name)) {
+        remove(temp_name);
+        return 0;
+    }
+
+    return 1;
+}
@@ -120,6 +120,47 @@ void MEMORY_CONTROLLER::operate()
     }
 }
 
+uint64_t MEMORY_CONTROLLER::next_event_cycle()
+{
+    uint64_t next = UINT64_MAX;
+
+    for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
+        // read/write mode switch is taken on the next operate()
+        if ((write_mode[i] == 0) && ((WQ[i].occupancy >= DRAM_WRITE_HIGH_WM) || ((RQ[i].occupancy == 0) && (WQ[i].occupancy > 0))))
+            return 0;
+        if (write_mode[i] && ((WQ[i].occupancy == 0) || (RQ[i].occupancy && (WQ[i].occupancy < DRAM_WRITE_LOW_WM))))
+            return 0;
+
+        PACKET_QUEUE *queue = write_mode[i] ? &WQ[i] : &RQ[i];
+
+        // schedule() does nothing until an unscheduled request finds an idle bank
+        if ((queue->next_schedule_index < queue->SIZE) && (queue->next_schedule_cycle < next)) {
+            for (uint32_t j=0; j<queue->SIZE; j++) {
+                uint64_t op_addr = queue->entry[j].address;
+                if ((op_addr == 0) || queue->entry[j].scheduled)
+                    continue;
+
+                if (bank_request[dram_get_channel(op_addr)][dram_get_rank(op_addr)][dram_get_bank(op_addr)].working == 0) {
+                    next = queue->next_schedule_cycle;
+                    break;
+                }
+            }
+        }
+
+        // process() also waits for the bank that holds the request
+        if (queue->next_process_index < queue->SIZE) {
+            uint64_t op_addr = queue->entry[queue->next_process_index].address,
+                     process_cycle = bank_request[dram_get_channel(op_addr)][dram_get_rank(op_addr)][dram_get_bank(op_addr)].cycle_available;
+            if (process_cycle < queue->next_process_cycle)
+                process_cycle = queue->next_process_cycle;
+            if (process_cycle < next)
+                next = process_cycle;
+        }
+    }
+
+    return next;
+}
+
 void MEMORY_CONTROLLER::schedule(PACKET_QUEUE *queue)
 {
     uint64_t read_addr;
@@ -460,7 +501,7 @@ int MEMORY_CONTROLLER::add_rq(PACKET *packet)
         return index; // merged index
 
     // search for the empty index
-    for (index=0; index<DRAM_RQ_SIZE; index++) {
+    for (index=0; index<(int)DRAM_RQ_SIZE; index++) {
         if (RQ[channel].entry[index].address == 0) {
             
             RQ[channel].entry[index] = *packet;
@@ -502,7 +543,7 @@ int MEMORY_CONTROLLER::add_wq(PACKET *packet)
         return index; // merged index
 
     // search for the empty index
-    for (index=0; index<DRAM_WQ_SIZE; index++) {
+    for (index=0; index<(int)DRAM_WQ_SIZE; index++) {
         if (WQ[channel].entry[index].address == 0) {
             
             WQ[channel].entry[index] = *packet;
@@ -702,3 +743,8 @@ void MEMORY_CONTROLLER::increment_WQ_FULL(uint64_t address)
     uint32_t channel = dram_get_channel(address);
     WQ[channel].FULL++;
 }
+
+void MEMORY_CONTROLLER::functional_access(PACKET *packet)
+{
+    // DRAM keeps no state that needs warming up
+}
@@ -0,0 +1,197 @@
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "lockstep.h"
+#include "sweep.h"
+#include "ooo_cpu.h"
+
+char *knob_lockstep = NULL;
+
+LOCKSTEP_RESULT *lockstep_result = NULL;
+int32_t lockstep_system = -1;
+
+// copy the trace into every system that is still running, from the beginning again at its end
+void run_lockstep_reader(vector<int> &pipes)
+{
+    uint32_t record_size = ooo_cpu[0].trace.record_size,
+             max_records = LOCKSTEP_CHUNK / record_size;
+    vector<char> chunk(max_records * record_size);
+    uint32_t num_running = pipes.size();
+
+    while (num_running) {
+        size_t size = 0;
+        for (uint32_t r=0; r<max_records; r++) {
+            if (!ooo_cpu[0].trace.read(&chunk[size])) {
+                cout << "*** Reached end of trace for Core: 0 Repeating trace: " << ooo_cpu[0].trace_string << endl; 
+                break;
+            }
+            size += record_size;
+        }
+
+        // the slowest system holds back the others once its pipe is full
+        for (uint32_t n=0; n<pipes.size(); n++) {
+            size_t written = 0;
+            while ((pipes[n] >= 0) && (written < size)) {
+                ssize_t done = write(pipes[n], &chunk[written], size - written);
+                if ((done < 0) && (errno == EINTR))
+                    continue;
+
+                if (done < 0) { // the system has finished and closed its end
+                    close(pipes[n]);
+                    pipes[n] = -1;
+                    num_running--;
+                }
+                else
+                    written += done;
+            }
+        }
+    }
+}
+
+void print_lockstep_results(vector<string> &systems)
+{
+    const char *cache_name[NUM_SAMPLED_CACHES] = {"L1D", "L1I", "L2C", "LLC"};
+
+    cout << endl << "Lockstep Results (region of interest)" << endl;
+    for (uint32_t n=0; n<systems.size(); n++)
+        cout << "System " << n << ": " << systems[n] << endl;
+
+    cout << endl << setw(16) << "";
+    for (uint32_t n=0; n<systems.size(); n++)
+        cout << setw(12) << ("System " + to_string(n));
+    cout << endl;
+
+    cout << setw(16) << left << "IPC" << right;
+    for (uint32_t n=0; n<systems.size(); n++) {
+        if (lockstep_result[n].finished)
+            cout << setw(12) << (1.0*lockstep_result[n].instr) / lockstep_result[n].cycle;
+        else
+            cout << setw(12) << "-";
+    }
+    cout << endl;
+
+    for (uint32_t c=0; c<NUM_SAMPLED_CACHES; c++) {
+        cout << setw(16) << left << (string(cache_name[c]) + " MPKI") << right;
+        for (uint32_t n=0; n<systems.size(); n++) {
+            if (lockstep_result[n].finished)
+                cout << setw(12) << (1000.0*lockstep_result[n].miss[c]) / lockstep_result[n].instr;
+            else
+                cout << setw(12) << "-";
+        }
+        cout << endl;
+    }
+
+    cout << setw(16) << left << "Branch MPKI" << right;
+    for (uint32_t n=0; n<systems.size(); n++) {
+        if (lockstep_result[n].finished)
+            cout << setw(12) << (1000.0*lockstep_result[n].branch_mispredictions) / lockstep_result[n].instr;
+        else
+            cout << setw(12) << "-";
+    }
+    cout << endl;
+}
+
+void fork_lockstep()
+{
+    vector<string> systems;
+    read_point_file(knob_lockstep, "LOCKSTEP", systems);
+
+    lockstep_result = (LOCKSTEP_RESULT *)mmap(NULL, systems.size()*sizeof(LOCKSTEP_RESULT), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (lockstep_result == MAP_FAILED) {
+        cerr << "*** CANNOT ALLOCATE LOCKSTEP RESULTS ***" << endl;
+        assert(0);
+    }
+    memset(lockstep_result, 0, systems.size()*sizeof(LOCKSTEP_RESULT));
+
+    vector<int> read_end(systems.size()), write_end(systems.size());
+    for (uint32_t n=0; n<systems.size(); n++) {
+        int pipe_fd[2];
+        if (pipe(pipe_fd)) {
+            cerr << "*** CANNOT CREATE LOCKSTEP PIPE " << n << " ***" << endl;
+            assert(0);
+        }
+#ifdef F_SETPIPE_SZ
+        fcntl(pipe_fd[1], F_SETPIPE_SZ, LOCKSTEP_BUFFER);
+#endif
+        read_end[n] = pipe_fd[0];
+        write_end[n] = pipe_fd[1];
+    }
+
+    vector<pid_t> children;
+    for (uint32_t n=0; n<systems.size(); n++) {
+        char result_name[1024];
+        snprintf(result_name, sizeof(result_name), "%s.%u", knob_lockstep, n);
+
+        cout << flush;
+        pid_t pid = fork();
+        if (pid < 0) {
+            cerr << "*** CANNOT FORK LOCKSTEP SYSTEM " << n << " ***" << endl;
+            assert(0);
+        }
+
+        if (pid == 0) {
+            if (freopen(result_name, "w", stdout) == NULL) {
+                cerr << "*** CANNOT OPEN RESULT FILE: " << result_name << " ***" << endl;
+                exit(1);
+            }
+            cout << "Lockstep system " << n << ": " << systems[n] << endl;
+
+            // keep only the read end of our own pipe, so the reader sees when we exit
+            for (uint32_t m=0; m<systems.size(); m++) {
+                close(write_end[m]);
+                if (m != n)
+                    close(read_end[m]);
+            }
+            ooo_cpu[0].trace.open_fd(read_end[n], ooo_cpu[0].trace.record_size);
+
+            lockstep_system = n;
+            apply_point_options(systems[n]);
+            create_policies();
+            return;
+        }
+
+        cout << "Lockstep system " << n << " pid: " << pid << " options: " << systems[n] << " results: " << result_name << endl;
+        children.push_back(pid);
+    }
+
+    for (uint32_t n=0; n<systems.size(); n++)
+        close(read_end[n]);
+
+    // a finished system closes its pipe, which must not kill the reader
+    signal(SIGPIPE, SIG_IGN);
+    run_lockstep_reader(write_end);
+
+    uint32_t num_failed = 0;
+    for (uint32_t n=0; n<children.size(); n++) {
+        int status;
+        waitpid(children[n], &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) || !lockstep_result[n].finished) {
+            cout << "Lockstep system " << n << " failed" << endl;
+            lockstep_result[n].finished = 0;
+            num_failed++;
+        }
+    }
+
+    print_lockstep_results(systems);
+
+    cout << endl << "ChampSim completed " << children.size() - num_failed << " of " << children.size() << " lockstep systems" << endl;
+    exit(num_failed ? 1 : 0);
+}
+
+void record_lockstep_result()
+{
+    LOCKSTEP_RESULT *result = &lockstep_result[lockstep_system];
+
+    result->instr = ooo_cpu[0].finish_sim_instr;
+    result->cycle = ooo_cpu[0].finish_sim_cycle;
+    result->branch_mispredictions = ooo_cpu[0].branch_mispredictions;
+    for (uint32_t n=0; n<NUM_SAMPLED_CACHES; n++) {
+        CACHE *cache = sampled_cache(0, n);
+        result->miss[n] = 0;
+        for (uint32_t j=0; j<NUM_TYPES; j++)
+            result->miss[n] += cache->roi_miss[0][j];
+    }
+    result->finished = 1;
+}
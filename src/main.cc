@@ -3,6 +3,13 @@
 #include <getopt.h>
 #include "ooo_cpu.h"
 #include "uncore.h"
+#include "parallel.h"
+#include "checkpoint.h"
+#include "native_trace.h"
+#include "sweep.h"
+#include "sampling.h"
+#include "simpoint.h"
+#include "lockstep.h"
 #include <fstream>
 
 uint8_t warmup_complete[NUM_CPUS], 
@@ -11,7 +18,12 @@ uint8_t warmup_complete[NUM_CPUS],
         all_simulation_complete = 0,
         MAX_INSTR_DESTINATIONS = NUM_INSTR_DESTINATIONS,
         knob_cloudsuite = 0,
-        knob_low_bandwidth = 0;
+        knob_trace_v2 = 0,
+        knob_multithreaded = 0,
+        knob_low_bandwidth = 0,
+        knob_cycle_skip = 0,
+        knob_functional_warmup = 0,
+        knob_ready_list_scheduler = 0;
 
 uint64_t warmup_instructions     = 1000000,
          simulation_instructions = 10000000,
@@ -97,20 +109,25 @@ void print_sim_stats(uint32_t cpu, CACHE *cache)
 void print_branch_stats()
 {
     for (uint32_t i=0; i<NUM_CPUS; i++) {
+        // sampled and SimPoint runs count only the instructions of their units, see finish_sampled_simulation()
+        uint64_t num_instr = ooo_cpu[i].num_retired - ooo_cpu[i].begin_sim_instr;
+        if (knob_sampling_period || knob_simpoints)
+            num_instr = ooo_cpu[i].finish_sim_instr;
+
         cout << endl << "CPU " << i << " Branch Prediction Accuracy: ";
         cout << (100.0*(ooo_cpu[i].num_branch - ooo_cpu[i].branch_mispredictions)) / ooo_cpu[i].num_branch;
-        cout << "% MPKI: " << (1000.0*ooo_cpu[i].branch_mispredictions)/(ooo_cpu[i].num_retired - ooo_cpu[i].warmup_instructions);
+        cout << "% MPKI: " << (1000.0*ooo_cpu[i].branch_mispredictions)/num_instr;
 	cout << " Average ROB Occupancy at Mispredict: " << (1.0*ooo_cpu[i].total_rob_occupancy_at_branch_mispredict)/ooo_cpu[i].branch_mispredictions << endl << endl;
 	
 	cout << "Branch types" << endl;
-	cout << "NOT_BRANCH: " << ooo_cpu[i].total_branch_types[0] << " " << (100.0*ooo_cpu[i].total_branch_types[0])/(ooo_cpu[i].num_retired - ooo_cpu[i].begin_sim_instr) << "%" << endl;
-	cout << "BRANCH_DIRECT_JUMP: " << ooo_cpu[i].total_branch_types[1] << " " << (100.0*ooo_cpu[i].total_branch_types[1])/(ooo_cpu[i].num_retired - ooo_cpu[i].begin_sim_instr) << "%" << endl;
-	cout << "BRANCH_INDIRECT: " << ooo_cpu[i].total_branch_types[2] << " " << (100.0*ooo_cpu[i].total_branch_types[2])/(ooo_cpu[i].num_retired - ooo_cpu[i].begin_sim_instr) << "%" << endl;
-	cout << "BRANCH_CONDITIONAL: " << ooo_cpu[i].total_branch_types[3] << " " << (100.0*ooo_cpu[i].total_branch_types[3])/(ooo_cpu[i].num_retired - ooo_cpu[i].begin_sim_instr) << "%" << endl;
-	cout << "BRANCH_DIRECT_CALL: " << ooo_cpu[i].total_branch_types[4] << " " << (100.0*ooo_cpu[i].total_branch_types[4])/(ooo_cpu[i].num_retired - ooo_cpu[i].begin_sim_instr) << "%" << endl;
-	cout << "BRANCH_INDIRECT_CALL: " << ooo_cpu[i].total_branch_types[5] << " " << (100.0*ooo_cpu[i].total_branch_types[5])/(ooo_cpu[i].num_retired - ooo_cpu[i].begin_sim_instr) << "%" << endl;
-	cout << "BRANCH_RETURN: " << ooo_cpu[i].total_branch_types[6] << " " << (100.0*ooo_cpu[i].total_branch_types[6])/(ooo_cpu[i].num_retired - ooo_cpu[i].begin_sim_instr) << "%" << endl;
-	cout << "BRANCH_OTHER: " << ooo_cpu[i].total_branch_types[7] << " " << (100.0*ooo_cpu[i].total_branch_types[7])/(ooo_cpu[i].num_retired - ooo_cpu[i].begin_sim_instr) << "%" << endl << endl;
+	cout << "NOT_BRANCH: " << ooo_cpu[i].total_branch_types[0] << " " << (100.0*ooo_cpu[i].total_branch_types[0])/num_instr << "%" << endl;
+	cout << "BRANCH_DIRECT_JUMP: " << ooo_cpu[i].total_branch_types[1] << " " << (100.0*ooo_cpu[i].total_branch_types[1])/num_instr << "%" << endl;
+	cout << "BRANCH_INDIRECT: " << ooo_cpu[i].total_branch_types[2] << " " << (100.0*ooo_cpu[i].total_branch_types[2])/num_instr << "%" << endl;
+	cout << "BRANCH_CONDITIONAL: " << ooo_cpu[i].total_branch_types[3] << " " << (100.0*ooo_cpu[i].total_branch_types[3])/num_instr << "%" << endl;
+	cout << "BRANCH_DIRECT_CALL: " << ooo_cpu[i].total_branch_types[4] << " " << (100.0*ooo_cpu[i].total_branch_types[4])/num_instr << "%" << endl;
+	cout << "BRANCH_INDIRECT_CALL: " << ooo_cpu[i].total_branch_types[5] << " " << (100.0*ooo_cpu[i].total_branch_types[5])/num_instr << "%" << endl;
+	cout << "BRANCH_RETURN: " << ooo_cpu[i].total_branch_types[6] << " " << (100.0*ooo_cpu[i].total_branch_types[6])/num_instr << "%" << endl;
+	cout << "BRANCH_OTHER: " << ooo_cpu[i].total_branch_types[7] << " " << (100.0*ooo_cpu[i].total_branch_types[7])/num_instr << "%" << endl << endl;
     }
 }
 
@@ -120,18 +137,18 @@ void print_dram_stats()
     cout << "DRAM Statistics" << endl;
     for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
         cout << " CHANNEL " << i << endl;
-        cout << " RQ ROW_BUFFER_HIT: " << setw(10) << uncore.DRAM.RQ[i].ROW_BUFFER_HIT << "  ROW_BUFFER_MISS: " << setw(10) << uncore.DRAM.RQ[i].ROW_BUFFER_MISS << endl;
-        cout << " DBUS_CONGESTED: " << setw(10) << uncore.DRAM.dbus_congested[NUM_TYPES][NUM_TYPES] << endl; 
-        cout << " WQ ROW_BUFFER_HIT: " << setw(10) << uncore.DRAM.WQ[i].ROW_BUFFER_HIT << "  ROW_BUFFER_MISS: " << setw(10) << uncore.DRAM.WQ[i].ROW_BUFFER_MISS;
-        cout << "  FULL: " << setw(10) << uncore.DRAM.WQ[i].FULL << endl; 
+        cout << " RQ ROW_BUFFER_HIT: " << setw(10) << uncore->DRAM.RQ[i].ROW_BUFFER_HIT << "  ROW_BUFFER_MISS: " << setw(10) << uncore->DRAM.RQ[i].ROW_BUFFER_MISS << endl;
+        cout << " DBUS_CONGESTED: " << setw(10) << uncore->DRAM.dbus_congested[NUM_TYPES][NUM_TYPES] << endl; 
+        cout << " WQ ROW_BUFFER_HIT: " << setw(10) << uncore->DRAM.WQ[i].ROW_BUFFER_HIT << "  ROW_BUFFER_MISS: " << setw(10) << uncore->DRAM.WQ[i].ROW_BUFFER_MISS;
+        cout << "  FULL: " << setw(10) << uncore->DRAM.WQ[i].FULL << endl; 
         cout << endl;
     }
 
     uint64_t total_congested_cycle = 0;
     for (uint32_t i=0; i<DRAM_CHANNELS; i++)
-        total_congested_cycle += uncore.DRAM.dbus_cycle_congested[i];
-    if (uncore.DRAM.dbus_congested[NUM_TYPES][NUM_TYPES])
-        cout << " AVG_CONGESTED_CYCLE: " << (total_congested_cycle / uncore.DRAM.dbus_congested[NUM_TYPES][NUM_TYPES]) << endl;
+        total_congested_cycle += uncore->DRAM.dbus_cycle_congested[i];
+    if (uncore->DRAM.dbus_congested[NUM_TYPES][NUM_TYPES])
+        cout << " AVG_CONGESTED_CYCLE: " << (total_congested_cycle / uncore->DRAM.dbus_congested[NUM_TYPES][NUM_TYPES]) << endl;
     else
         cout << " AVG_CONGESTED_CYCLE: -" << endl;
 }
@@ -163,8 +180,26 @@ void reset_cache_stats(uint32_t cpu, CACHE *cache)
     cache->WQ.FULL = 0;
 }
 
+void set_dram_bandwidth()
+{
+    if (knob_low_bandwidth)
+        DRAM_MTPS = DRAM_IO_FREQ/4;
+    else
+        DRAM_MTPS = DRAM_IO_FREQ;
+
+    // default: 16 = (64 / 8) * (3200 / 1600)
+    // it takes 16 CPU cycles to tranfser 64B cache block on a 8B (64-bit) bus 
+    // note that dram burst length = BLOCK_SIZE/DRAM_CHANNEL_WIDTH
+    DRAM_DBUS_RETURN_TIME = (BLOCK_SIZE / DRAM_CHANNEL_WIDTH) * (CPU_FREQ / DRAM_MTPS);
+}
+
 void finish_warmup()
 {
+    if (knob_save_checkpoint)
+        save_checkpoint(knob_save_checkpoint);
+    if (knob_sweep)
+        fork_sweep();
+
     uint64_t elapsed_second = (uint64_t)(time(NULL) - start_time),
              elapsed_minute = elapsed_second / 60,
              elapsed_hour = elapsed_minute / 60;
@@ -201,16 +236,16 @@ void finish_warmup()
         reset_cache_stats(i, &ooo_cpu[i].L1I);
         reset_cache_stats(i, &ooo_cpu[i].L1D);
         reset_cache_stats(i, &ooo_cpu[i].L2C);
-        reset_cache_stats(i, &uncore.LLC);
+        reset_cache_stats(i, &uncore->LLC);
     }
     cout << endl;
 
     // reset DRAM stats
     for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
-        uncore.DRAM.RQ[i].ROW_BUFFER_HIT = 0;
-        uncore.DRAM.RQ[i].ROW_BUFFER_MISS = 0;
-        uncore.DRAM.WQ[i].ROW_BUFFER_HIT = 0;
-        uncore.DRAM.WQ[i].ROW_BUFFER_MISS = 0;
+        uncore->DRAM.RQ[i].ROW_BUFFER_HIT = 0;
+        uncore->DRAM.RQ[i].ROW_BUFFER_MISS = 0;
+        uncore->DRAM.WQ[i].ROW_BUFFER_HIT = 0;
+        uncore->DRAM.WQ[i].ROW_BUFFER_MISS = 0;
     }
 
     // set actual cache latency
@@ -222,7 +257,21 @@ void finish_warmup()
         ooo_cpu[i].L1D.LATENCY  = L1D_LATENCY;
         ooo_cpu[i].L2C.LATENCY  = L2C_LATENCY;
     }
-    uncore.LLC.LATENCY = LLC_LATENCY;
+    uncore->LLC.LATENCY = LLC_LATENCY;
+}
+
+// the ROB head of core i has not retired for DEADLOCK_CYCLE cycles; the cycles a synchronization marker waited for
+// the other cores do not count, since it gives up waiting after DEADLOCK_CYCLE cycles, see O3_CPU::retire_rob()
+uint8_t deadlocked(uint32_t i)
+{
+    ooo_model_instr &head = ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head];
+    if (head.ip == 0)
+        return 0;
+
+    uint64_t since = head.event_cycle;
+    if (ooo_cpu[i].sync_wait_cycle > since)
+        since = ooo_cpu[i].sync_wait_cycle;
+    return (since + DEADLOCK_CYCLE) <= current_core_cycle[i];
 }
 
 void print_deadlock(uint32_t i)
@@ -297,6 +346,66 @@ uint64_t rotr64 (uint64_t n, unsigned int c)
 }
 
 RANDOM champsim_rand(champsim_seed);
+// MULTITHREADED TRACES
+// -multithreaded runs the per-thread traces of one program (made with the tracer's -v 2) on the cores,
+// which share one address space; each synchronization marker retires only after the markers recorded
+// before it in any thread, e.g., a lock is acquired in the order the threads acquired it when traced
+atomic<uint64_t> sync_sequence(0); // the highest marker retired
+atomic<uint8_t> sync_ordering(1); // 0 if some markers may never be read, see main() and sync_marker_timeout()
+
+uint8_t sync_marker_ready(uint64_t sequence)
+{
+    return !knob_multithreaded || !sync_ordering || (sequence <= sync_sequence + 1);
+}
+
+void sync_marker_retired(uint64_t sequence)
+{
+    uint64_t last = sync_sequence;
+    while ((sequence > last) && !sync_sequence.compare_exchange_weak(last, sequence));
+}
+
+// the markers in front of this one did not come in DEADLOCK_CYCLE cycles, e.g., a thread ended early or there are
+// more threads than cores, and would hold up every later marker as well, so the markers are not ordered from now on
+void sync_marker_timeout(uint32_t cpu, uint64_t sequence)
+{
+    if (sync_ordering.exchange(0)) {
+        cout << "CPU " << cpu << " waited " << DEADLOCK_CYCLE << " cycles for the synchronization markers before " << sequence;
+        cout << ", synchronization markers are not ordered for the rest of the run" << endl;
+    }
+}
+
+// the trace of thread n of a program, named like OutputFileName() of the tracer names it next to the trace of thread 0
+string thread_trace_name(const string &name, uint32_t n)
+{
+    size_t pos = name.find(".champsimtrace");
+    if (pos == string::npos) {
+        size_t last_slash = name.rfind('/');
+        pos = name.rfind('.');
+        if ((pos == string::npos) || ((last_slash != string::npos) && (pos < last_slash)))
+            pos = name.length();
+    }
+
+    return name.substr(0, pos) + ".t" + to_string(n) + name.substr(pos);
+}
+
+// a thread that is traced but not simulated never retires its markers, which the other threads would wait for
+void check_thread_traces()
+{
+    for (uint32_t n=1; ; n++) {
+        string name = thread_trace_name(ooo_cpu[0].trace_string, n);
+        if (access(name.c_str(), F_OK) != 0)
+            return;
+
+        uint32_t i = 1;
+        while ((i < NUM_CPUS) && (name != ooo_cpu[i].trace_string))
+            i++;
+        if (i == NUM_CPUS) {
+            cerr << "*** -multithreaded NEEDS THE TRACE OF EVERY THREAD ON A CORE OF ITS OWN, " << name << " IS NOT GIVEN ***" << endl;
+            assert(0);
+        }
+    }
+}
+
 uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_vpage, uint8_t is_code)
 {
 #ifdef SANITY_CHECK
@@ -305,12 +414,18 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
 #endif
 
     uint8_t  swap = 0;
-    uint64_t high_bit_mask = rotr64(cpu, lg2(NUM_CPUS)),
+    // the threads of a -multithreaded program share its address space
+    uint64_t high_bit_mask = knob_multithreaded ? 0 : rotr64(cpu, lg2(NUM_CPUS)),
              unique_va = va | high_bit_mask;
     //uint64_t vpage = unique_va >> LOG2_PAGE_SIZE,
     uint64_t vpage = unique_vpage | high_bit_mask,
              voffset = unique_va & ((1<<LOG2_PAGE_SIZE) - 1);
 
+    // page tables are shared by all cores
+    unique_lock<mutex> page_table_lock(page_table_mutex, defer_lock);
+    if (knob_threads > 1)
+        page_table_lock.lock();
+
     // smart random number generator
     uint64_t random_ppage;
 
@@ -385,7 +500,7 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
                 ooo_cpu[cpu].L1I.invalidate_entry(cl_addr);
                 ooo_cpu[cpu].L1D.invalidate_entry(cl_addr);
                 ooo_cpu[cpu].L2C.invalidate_entry(cl_addr);
-                uncore.LLC.invalidate_entry(cl_addr);
+                uncore->LLC.invalidate_entry(cl_addr);
             }
 
             // swap complete
@@ -481,6 +596,319 @@ uint64_t va_to_pa(uint32_t cpu, uint64_t instr_id, uint64_t va, uint64_t unique_
     return pa;
 }
 
+// advance one core and its private caches by one cycle
+void operate_cpu(uint32_t i)
+{
+    // proceed one cycle
+    current_core_cycle[i]++;
+
+    //cout << "Trying to process instr_id: " << ooo_cpu[i].instr_unique_id << " fetch_stall: " << +ooo_cpu[i].fetch_stall;
+    //cout << " stall_cycle: " << stall_cycle[i] << " current: " << current_core_cycle[i] << endl;
+
+    // core might be stalled due to page fault or branch misprediction
+    if (stall_cycle[i] <= current_core_cycle[i]) {
+
+        // retire
+        if ((ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].executed == COMPLETED) && (ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].event_cycle <= current_core_cycle[i]))
+            ooo_cpu[i].retire_rob();
+
+        // complete 
+        ooo_cpu[i].update_rob();
+
+        // schedule
+        uint32_t schedule_index = ooo_cpu[i].ROB.next_schedule;
+        if ((ooo_cpu[i].ROB.entry[schedule_index].scheduled == 0) && (ooo_cpu[i].ROB.entry[schedule_index].event_cycle <= current_core_cycle[i]))
+            ooo_cpu[i].schedule_instruction();
+        // execute
+        ooo_cpu[i].execute_instruction();
+
+        ooo_cpu[i].update_rob();
+
+        // memory operation
+        ooo_cpu[i].schedule_memory_instruction();
+        ooo_cpu[i].execute_memory_instruction();
+
+        ooo_cpu[i].update_rob();
+
+        // decode
+        if (ooo_cpu[i].DECODE_BUFFER.occupancy > 0)
+            ooo_cpu[i].decode_and_dispatch();
+
+        // fetch
+        ooo_cpu[i].fetch_instruction();
+
+        // read from trace
+        if ((ooo_cpu[i].IFETCH_BUFFER.occupancy < ooo_cpu[i].IFETCH_BUFFER.SIZE) && (ooo_cpu[i].fetch_stall == 0) && (sampling_drain == 0))
+            ooo_cpu[i].read_from_trace();
+    }
+}
+
+// fast-forward all clocks to the cycle before the earliest pending event
+// the skipped cycles would not have changed any state, so this is cycle-exact
+void skip_idle_cycles()
+{
+    // start with the core that kept us from skipping last time
+    static uint32_t busy_cpu = 0;
+    uint64_t current = current_core_cycle[0], next = UINT64_MAX, event_cycle;
+
+    for (uint32_t n=0; n<NUM_CPUS; n++) {
+        uint32_t i = (busy_cpu + n) % NUM_CPUS;
+        event_cycle = ooo_cpu[i].next_event_cycle();
+        if (event_cycle <= (current + 1)) {
+            busy_cpu = i;
+            return;
+        }
+        if (event_cycle < next)
+            next = event_cycle;
+
+        // do not jump over a deadlock report
+        if (ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].ip && ((ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].event_cycle + DEADLOCK_CYCLE) < next))
+            next = ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].event_cycle + DEADLOCK_CYCLE;
+    }
+
+    event_cycle = uncore->LLC.next_event_cycle();
+    if (event_cycle < next)
+        next = event_cycle;
+
+    event_cycle = uncore->DRAM.next_event_cycle();
+    if (event_cycle < next)
+        next = event_cycle;
+
+    if ((next <= (current + 1)) || (next == UINT64_MAX))
+        return;
+
+    for (int i=0; i<NUM_CPUS; i++)
+        current_core_cycle[i] = next - 1;
+}
+
+// warm up the branch predictors, TLBs, caches, and prefetchers without timing
+void run_functional_warmup()
+{
+    uint8_t warming_up = 1;
+    while (warming_up) {
+        warming_up = 0;
+        for (uint32_t i=0; i<NUM_CPUS; i++) {
+            if (ooo_cpu[i].num_retired < warmup_instructions) {
+                ooo_cpu[i].functional_warmup();
+                warming_up = 1;
+            }
+        }
+    }
+
+    uint64_t elapsed_second = (uint64_t)(time(NULL) - start_time);
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        cout << "Functional warmup complete CPU " << i << " instructions: " << ooo_cpu[i].num_retired;
+        cout << " (Simulation time: " << elapsed_second << " sec) " << endl;
+    }
+
+    skip_detailed_warmup();
+}
+
+// the cores were warmed up outside the detailed loop (functional warmup or checkpoint),
+// so the detailed simulation is measured from its first cycle
+void skip_detailed_warmup()
+{
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        // page faults while warming up do not stall the core
+        stall_cycle[i] = 0;
+
+        // no heartbeats until the detailed simulation has run for a while
+        while (ooo_cpu[i].next_print_instruction <= ooo_cpu[i].num_retired)
+            ooo_cpu[i].next_print_instruction += STAT_PRINTING_PERIOD;
+        ooo_cpu[i].last_sim_instr = ooo_cpu[i].num_retired;
+
+        warmup_complete[i] = 1;
+    }
+
+    all_warmup_complete = NUM_CPUS + 1;
+    finish_warmup();
+}
+
+void print_heartbeat(uint32_t i, uint64_t elapsed_hour, uint64_t elapsed_minute, uint64_t elapsed_second)
+{
+    float cumulative_ipc;
+    if (warmup_complete[i])
+        cumulative_ipc = (1.0*(ooo_cpu[i].num_retired - ooo_cpu[i].begin_sim_instr)) / (current_core_cycle[i] - ooo_cpu[i].begin_sim_cycle);
+    else
+        cumulative_ipc = (1.0*ooo_cpu[i].num_retired) / current_core_cycle[i];
+    float heartbeat_ipc = (1.0*ooo_cpu[i].num_retired - ooo_cpu[i].last_sim_instr) / (current_core_cycle[i] - ooo_cpu[i].last_sim_cycle);
+
+    cout << "Heartbeat CPU " << i << " instructions: " << ooo_cpu[i].num_retired << " cycles: " << current_core_cycle[i];
+    cout << " heartbeat IPC: " << heartbeat_ipc << " cumulative IPC: " << cumulative_ipc; 
+    cout << " (Simulation time: " << elapsed_hour << " hr " << elapsed_minute << " min " << elapsed_second << " sec) " << endl;
+    ooo_cpu[i].next_print_instruction += STAT_PRINTING_PERIOD;
+
+    ooo_cpu[i].last_sim_instr = ooo_cpu[i].num_retired;
+    ooo_cpu[i].last_sim_cycle = current_core_cycle[i];
+}
+
+// only touches state owned by cpu i, so it is safe to call from a worker thread
+void finish_simulation(uint32_t i)
+{
+    simulation_complete[i] = 1;
+    ooo_cpu[i].finish_sim_instr = ooo_cpu[i].num_retired - ooo_cpu[i].begin_sim_instr;
+    ooo_cpu[i].finish_sim_cycle = current_core_cycle[i] - ooo_cpu[i].begin_sim_cycle;
+
+    record_roi_stats(i, &ooo_cpu[i].L1D);
+    record_roi_stats(i, &ooo_cpu[i].L1I);
+    record_roi_stats(i, &ooo_cpu[i].L2C);
+    record_roi_stats(i, &uncore->LLC);
+}
+
+void print_finished(uint32_t i, uint64_t elapsed_hour, uint64_t elapsed_minute, uint64_t elapsed_second)
+{
+    cout << "Finished CPU " << i << " instructions: " << ooo_cpu[i].finish_sim_instr << " cycles: " << ooo_cpu[i].finish_sim_cycle;
+    cout << " cumulative IPC: " << ((float) ooo_cpu[i].finish_sim_instr / ooo_cpu[i].finish_sim_cycle);
+    cout << " (Simulation time: " << elapsed_hour << " hr " << elapsed_minute << " min " << elapsed_second << " sec) " << endl;
+}
+
+// TRACE CONVERSION
+// -convert_trace FILE writes the trace of CPU 0 to FILE in the native format (inc/native_trace.h) and exits
+char *knob_convert_trace = NULL;
+uint32_t knob_convert_codec = CST_CODEC_XZ;
+
+// TRACE SEEKING
+// -skip_instructions N starts simulating every core at instruction N of its trace,
+// jumping there through the block index of a .cst trace and decoding past the rest otherwise
+uint64_t knob_skip_instructions = 0;
+
+// TRACE BROKER
+// -trace_broker DIR maps an uncompressed copy of each trace kept in DIR (e.g., /dev/shm or a local disk),
+// so all runs on a host that use the same DIR decompress a trace only once and share it in the page cache
+char *knob_trace_broker = NULL;
+
+// DECODE SIDECAR
+// -decode_sidecar starts the decode cache of each core (inc/decode_cache.h) from TRACE.decoded
+// and leaves the cache there at the end, so the next run on the same trace starts warm
+uint8_t knob_decode_sidecar = 0;
+
+void load_decode_sidecars()
+{
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        string name = string(ooo_cpu[i].trace.file_name) + ".decoded";
+        if (ooo_cpu[i].decode_cache.load(name.c_str()))
+            cout << "CPU " << i << " decode cache loaded from " << name << endl;
+    }
+}
+
+void save_decode_sidecars()
+{
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        string name = string(ooo_cpu[i].trace.file_name) + ".decoded";
+        if (!ooo_cpu[i].decode_cache.save(name.c_str()))
+            cout << "CPU " << i << " decode cache cannot be saved to " << name << endl;
+    }
+}
+
+// PARALLEL ENGINE
+QUANTUM_BARRIER quantum_barrier;
+
+// advance the cores owned by this thread by one quantum
+void operate_cpu_quantum(uint32_t thread_id)
+{
+    for (uint32_t i=thread_id; i<NUM_CPUS; i+=knob_threads) {
+        for (uint32_t cycle=0; cycle<knob_quantum; cycle++) {
+            operate_cpu(i);
+
+            // the uncore thread sums these up at the end of the quantum
+            if ((warmup_complete[i] == 0) && (ooo_cpu[i].num_retired > warmup_instructions))
+                warmup_complete[i] = 1;
+
+            if ((all_warmup_complete > NUM_CPUS) && (simulation_complete[i] == 0) && (ooo_cpu[i].num_retired >= (ooo_cpu[i].begin_sim_instr + ooo_cpu[i].simulation_instructions)))
+                finish_simulation(i);
+        }
+    }
+}
+
+void cpu_worker(uint32_t thread_id)
+{
+    uint64_t generation = 0;
+    while (1) {
+        generation = quantum_barrier.wait_release(generation);
+        if (quantum_barrier.done)
+            return;
+
+        operate_cpu_quantum(thread_id);
+        quantum_barrier.arrive();
+    }
+}
+
+// catch the LLC and DRAM up with the cycles the cores just ran
+void operate_uncore_quantum(uint64_t quantum_begin_cycle)
+{
+    for (uint64_t cycle=quantum_begin_cycle+1; cycle<=quantum_begin_cycle+knob_quantum; cycle++) {
+        for (uint32_t i=0; i<NUM_CPUS; i++)
+            current_core_cycle[i] = cycle;
+
+        for (uint32_t i=0; i<NUM_CPUS; i++)
+            llc_port[i].drain(cycle);
+
+        uncore->DRAM.operate();
+        uncore->LLC.operate();
+    }
+}
+
+void run_parallel_simulation(uint8_t show_heartbeat)
+{
+    vector<thread> workers;
+    for (uint32_t t=1; t<knob_threads; t++)
+        workers.push_back(thread(cpu_worker, t));
+
+    uint8_t finish_printed[NUM_CPUS] = {0};
+    while (all_simulation_complete < NUM_CPUS) {
+
+        // all cores advance together, so they share the same cycle count
+        uint64_t quantum_begin_cycle = current_core_cycle[0];
+
+        quantum_barrier.release();
+        operate_cpu_quantum(0);
+        quantum_barrier.wait_workers(knob_threads - 1);
+
+        operate_uncore_quantum(quantum_begin_cycle);
+
+        uint64_t elapsed_second = (uint64_t)(time(NULL) - start_time),
+                 elapsed_minute = elapsed_second / 60,
+                 elapsed_hour = elapsed_minute / 60;
+        elapsed_minute -= elapsed_hour*60;
+        elapsed_second -= (elapsed_hour*3600 + elapsed_minute*60);
+
+        for (uint32_t i=0; i<NUM_CPUS; i++) {
+            // heartbeat information
+            if (show_heartbeat && (ooo_cpu[i].num_retired >= ooo_cpu[i].next_print_instruction))
+                print_heartbeat(i, elapsed_hour, elapsed_minute, elapsed_second);
+
+            // check for deadlock
+            if (deadlocked(i))
+                print_deadlock(i);
+        }
+
+        // check for warmup
+        if (all_warmup_complete < NUM_CPUS) {
+            all_warmup_complete = 0;
+            for (uint32_t i=0; i<NUM_CPUS; i++)
+                all_warmup_complete += warmup_complete[i];
+        }
+        if (all_warmup_complete == NUM_CPUS) { // this part is called only once when all cores are warmed up
+            all_warmup_complete++;
+            finish_warmup();
+        }
+
+        // simulation complete
+        for (uint32_t i=0; i<NUM_CPUS; i++) {
+            if (simulation_complete[i] && (finish_printed[i] == 0)) {
+                print_finished(i, elapsed_hour, elapsed_minute, elapsed_second);
+                finish_printed[i] = 1;
+                all_simulation_complete++;
+            }
+        }
+    }
+
+    quantum_barrier.done = 1;
+    quantum_barrier.release();
+    for (uint32_t t=0; t<workers.size(); t++)
+        workers[t].join();
+}
+
 int main(int argc, char** argv)
 {
 	// interrupt signal hanlder
@@ -506,7 +934,34 @@ int main(int argc, char** argv)
             {"simulation_instructions", required_argument, 0, 'i'},
             {"hide_heartbeat", no_argument, 0, 'h'},
             {"cloudsuite", no_argument, 0, 'c'},
+            {"trace_v2", no_argument, 0, 'V'},
+            {"multithreaded", no_argument, 0, 'J'},
             {"low_bandwidth",  no_argument, 0, 'b'},
+            {"threads", required_argument, 0, 'p'},
+            {"quantum", required_argument, 0, 'q'},
+            {"cycle_skip", no_argument, 0, 'k'},
+            {"functional_warmup", no_argument, 0, 'f'},
+            {"ready_list_scheduler", no_argument, 0, 'K'},
+            {"save_checkpoint", required_argument, 0, 'S'},
+            {"load_checkpoint", required_argument, 0, 'L'},
+            {"sweep", required_argument, 0, 'x'},
+            {"sampling_period", required_argument, 0, 'P'},
+            {"sampling_unit", required_argument, 0, 'U'},
+            {"sampling_warming", required_argument, 0, 'W'},
+            {"simpoints", required_argument, 0, 'R'},
+            {"lockstep", required_argument, 0, 'O'},
+            {"convert_trace", required_argument, 0, 'T'},
+            {"convert_codec", required_argument, 0, 'Z'},
+            {"skip_instructions", required_argument, 0, 'N'},
+            {"decode_sidecar", no_argument, 0, 'E'},
+            {"trace_broker", required_argument, 0, 'A'},
+            {"config", required_argument, 0, 'C'},
+            {"branch_predictor", required_argument, 0, 'B'},
+            {"l1i_prefetcher", required_argument, 0, 'I'},
+            {"l1d_prefetcher", required_argument, 0, 'D'},
+            {"l2c_prefetcher", required_argument, 0, 'M'},
+            {"llc_prefetcher", required_argument, 0, 'G'},
+            {"llc_replacement", required_argument, 0, 'Y'},
             {"traces",  no_argument, 0, 't'},
             {0, 0, 0, 0}      
         };
@@ -535,9 +990,99 @@ int main(int argc, char** argv)
                 knob_cloudsuite = 1;
                 MAX_INSTR_DESTINATIONS = NUM_INSTR_DESTINATIONS_SPARC;
                 break;
+            case 'V':
+                knob_trace_v2 = 1;
+                break;
+            case 'J':
+                knob_multithreaded = 1;
+                break;
             case 'b':
                 knob_low_bandwidth = 1;
                 break;
+            case 'p':
+                knob_threads = atol(optarg);
+                break;
+            case 'q':
+                knob_quantum = atol(optarg);
+                break;
+            case 'k':
+                knob_cycle_skip = 1;
+                break;
+            case 'f':
+                knob_functional_warmup = 1;
+                break;
+            case 'K':
+                knob_ready_list_scheduler = 1;
+                break;
+            case 'S':
+                knob_save_checkpoint = optarg;
+                break;
+            case 'L':
+                knob_load_checkpoint = optarg;
+                break;
+            case 'x':
+                knob_sweep = optarg;
+                break;
+            case 'P':
+                knob_sampling_period = atol(optarg);
+                break;
+            case 'U':
+                knob_sampling_unit = atol(optarg);
+                break;
+            case 'W':
+                knob_sampling_warming = atol(optarg);
+                break;
+            case 'R':
+                knob_simpoints = optarg;
+                break;
+            case 'O':
+                knob_lockstep = optarg;
+                break;
+            case 'T':
+                knob_convert_trace = optarg;
+                break;
+            case 'Z':
+                if (strcmp(optarg, "zlib") == 0)
+                    knob_convert_codec = CST_CODEC_ZLIB;
+                else if (strcmp(optarg, "xz") == 0)
+                    knob_convert_codec = CST_CODEC_XZ;
+                else {
+                    cerr << "*** -convert_codec MUST BE zlib OR xz ***" << endl;
+                    assert(0);
+                }
+                break;
+            case 'N':
+                knob_skip_instructions = atol(optarg);
+                break;
+            case 'E':
+                knob_decode_sidecar = 1;
+                break;
+            case 'A':
+                knob_trace_broker = optarg;
+                break;
+            case 'C':
+                // loaded right away, so options after -config override the file
+                knob_config = optarg;
+                load_config(knob_config);
+                break;
+            case 'B':
+                knob_branch_predictor = optarg;
+                break;
+            case 'I':
+                knob_l1i_prefetcher = optarg;
+                break;
+            case 'D':
+                knob_l1d_prefetcher = optarg;
+                break;
+            case 'M':
+                knob_l2c_prefetcher = optarg;
+                break;
+            case 'G':
+                knob_llc_prefetcher = optarg;
+                break;
+            case 'Y':
+                knob_llc_replacement = optarg;
+                break;
             case 't':
                 traces_encountered = 1;
                 break;
@@ -549,6 +1094,12 @@ int main(int argc, char** argv)
             break;
     }
 
+    // the core, cache, and DRAM geometry must be known before they are built
+    ooo_cpu = new O3_CPU[NUM_CPUS];
+    uncore = new UNCORE;
+    llc_port = new LLC_PORT[NUM_CPUS];
+    create_policies();
+
     // consequences of knobs
     cout << "Warmup Instructions: " << warmup_instructions << endl;
     cout << "Simulation Instructions: " << simulation_instructions << endl;
@@ -557,21 +1108,77 @@ int main(int argc, char** argv)
     cout << "LLC sets: " << LLC_SET << endl;
     cout << "LLC ways: " << LLC_WAY << endl;
 
-    if (knob_low_bandwidth)
-        DRAM_MTPS = DRAM_IO_FREQ/4;
-    else
-        DRAM_MTPS = DRAM_IO_FREQ;
+    if ((knob_threads == 0) || (knob_quantum == 0)) {
+        cout << "-threads and -quantum must be at least 1" << endl;
+        assert(0);
+    }
+    if (knob_threads > NUM_CPUS)
+        knob_threads = NUM_CPUS;
+    if (knob_quantum == 1) // quantum 1 runs the exact serial loop
+        knob_threads = 1;
+    cout << "Threads: " << knob_threads << " Quantum: " << knob_quantum << " cycles" << endl;
+    if (knob_cycle_skip && (knob_quantum > 1)) {
+        cout << "-cycle_skip is ignored with -quantum > 1" << endl;
+        knob_cycle_skip = 0;
+    }
+
+    if (knob_sweep && (knob_quantum > 1)) {
+        cout << "-sweep is ignored with -quantum > 1" << endl;
+        knob_sweep = NULL;
+    }
+
+    if (knob_simpoints && (knob_sampling_period || knob_functional_warmup || knob_load_checkpoint)) {
+        cout << "-sampling_period, -functional_warmup, and -load_checkpoint are ignored with -simpoints" << endl;
+        knob_sampling_period = 0;
+        knob_functional_warmup = 0;
+        knob_load_checkpoint = NULL;
+    }
+    if (knob_skip_instructions && (knob_simpoints || knob_load_checkpoint)) {
+        cout << "-skip_instructions is ignored with -simpoints and -load_checkpoint" << endl;
+        knob_skip_instructions = 0;
+    }
+    if (knob_skip_instructions)
+        cout << "Skip Instructions: " << knob_skip_instructions << endl;
+    if (knob_multithreaded && !knob_trace_v2)
+        cout << "-multithreaded shares the address space, but version 1 traces have no synchronization markers to order" << endl;
+    if (knob_multithreaded && (knob_skip_instructions || knob_load_checkpoint)) {
+        // the markers skipped in one trace could hold up the others forever
+        cout << "Synchronization markers are not ordered with -skip_instructions and -load_checkpoint" << endl;
+        sync_ordering = 0;
+    }
+    if (knob_simpoints && (knob_quantum > 1)) {
+        cout << "-simpoints is ignored with -quantum > 1" << endl;
+        knob_simpoints = NULL;
+    }
+    if (knob_lockstep && (NUM_CPUS > 1)) {
+        cerr << "*** -lockstep NEEDS A SINGLE-CORE BUILD ***" << endl;
+        assert(0);
+    }
+    if (knob_lockstep && (knob_sweep || knob_save_checkpoint || knob_load_checkpoint)) {
+        cout << "-sweep, -save_checkpoint, and -load_checkpoint are ignored with -lockstep" << endl;
+        knob_sweep = NULL;
+        knob_save_checkpoint = NULL;
+        knob_load_checkpoint = NULL;
+    }
+    if (knob_sampling_period && (knob_quantum > 1)) {
+        cout << "-sampling_period is ignored with -quantum > 1" << endl;
+        knob_sampling_period = 0;
+    }
+    if (knob_sampling_period) {
+        if ((knob_sampling_unit == 0) || (knob_sampling_period < (knob_sampling_warming + knob_sampling_unit))) {
+            cerr << "*** -sampling_period MUST HOLD -sampling_warming AND A NONZERO -sampling_unit ***" << endl;
+            assert(0);
+        }
+        cout << "Sampling period: " << knob_sampling_period << " unit: " << knob_sampling_unit << " detailed warming: " << knob_sampling_warming << " instructions" << endl;
+    }
+
+    set_dram_bandwidth();
 
     // DRAM access latency
     tRP  = (uint32_t)((1.0 * tRP_DRAM_NANOSECONDS  * CPU_FREQ) / 1000); 
     tRCD = (uint32_t)((1.0 * tRCD_DRAM_NANOSECONDS * CPU_FREQ) / 1000); 
     tCAS = (uint32_t)((1.0 * tCAS_DRAM_NANOSECONDS * CPU_FREQ) / 1000); 
 
-    // default: 16 = (64 / 8) * (3200 / 1600)
-    // it takes 16 CPU cycles to tranfser 64B cache block on a 8B (64-bit) bus 
-    // note that dram burst length = BLOCK_SIZE/DRAM_CHANNEL_WIDTH
-    DRAM_DBUS_RETURN_TIME = (BLOCK_SIZE / DRAM_CHANNEL_WIDTH) * (CPU_FREQ / DRAM_MTPS);
-
     printf("Off-chip DRAM Size: %u MB Channels: %u Width: %u-bit Data Rate: %u MT/s\n",
             DRAM_SIZE, DRAM_CHANNELS, 8*DRAM_CHANNEL_WIDTH, DRAM_MTPS);
 
@@ -597,12 +1204,19 @@ int main(int argc, char** argv)
 			}
 				
 
-            if (full_name[last_dot - full_name + 1] == 'g') // gzip format
-                sprintf(ooo_cpu[count_traces].gunzip_command, "gunzip -c %s", argv[i]);
-            else if (full_name[last_dot - full_name + 1] == 'x') // xz
-                sprintf(ooo_cpu[count_traces].gunzip_command, "xz -dc %s", argv[i]);
-            else {
-                cout << "ChampSim does not support traces other than gz or xz compression!" << endl; 
+            if ((last_dot == NULL) || ((strcmp(last_dot, ".gz") != 0) && (strcmp(last_dot, ".xz") != 0) && (strcmp(last_dot, ".zst") != 0) && (strcmp(last_dot, ".cst") != 0)
+                                       && (strcmp(last_dot, ".champsimtrace") != 0))) {
+                cout << "ChampSim does not support traces other than gz, xz, zst compression, the native cst format, or uncompressed .champsimtrace files!" << endl; 
+                assert(0);
+            }
+            // an uncompressed trace has one dot-separated part less in its name
+            int uncompressed = (strcmp(last_dot, ".champsimtrace") == 0);
+            if ((knob_cloudsuite || knob_trace_v2) && (strcmp(last_dot, ".cst") == 0)) {
+                cout << "The native cst format does not hold -cloudsuite or -trace_v2 traces!" << endl; 
+                assert(0);
+            }
+            if (knob_cloudsuite && knob_trace_v2) {
+                cout << "There are no version 2 -cloudsuite traces!" << endl; 
                 assert(0);
             }
 
@@ -619,14 +1233,19 @@ int main(int argc, char** argv)
             //printf("application: %s\n", pch[count_str-3]);
 
             int j = 0;
-            while (pch[count_str-3][j] != '\0') {
-                seed_number += pch[count_str-3][j];
-                //printf("%c %d %d\n", pch[count_str-3][j], j, seed_number);
+            char *seed_part = pch[count_str-3+uncompressed];
+            while (seed_part[j] != '\0') {
+                seed_number += seed_part[j];
+                //printf("%c %d %d\n", seed_part[j], j, seed_number);
                 j++;
             }
 
-            ooo_cpu[count_traces].trace_file = popen(ooo_cpu[count_traces].gunzip_command, "r");
-            if (ooo_cpu[count_traces].trace_file == NULL) {
+            // decompressed on the core's own reader thread, or mapped if uncompressed
+            string trace_name = full_name;
+            if (knob_trace_broker && !uncompressed)
+                trace_name = share_trace(full_name, knob_trace_broker);
+            if (!ooo_cpu[count_traces].trace.open(trace_name.c_str(), knob_cloudsuite ? sizeof(cloudsuite_instr)
+                                                                     : knob_trace_v2 ? sizeof(input_instr_v2) : sizeof(input_instr))) {
                 printf("\n*** Trace file not found: %s ***\n\n", argv[i]);
                 assert(0);
             }
@@ -646,8 +1265,30 @@ int main(int argc, char** argv)
         printf("\n*** Not enough traces for the configured number of cores ***\n\n");
         assert(0);
     }
+    if (knob_multithreaded && knob_trace_v2 && sync_ordering)
+        check_thread_traces();
     // end trace file setup
 
+    if (knob_convert_trace) {
+        convert_trace(&ooo_cpu[0].trace, knob_convert_trace, knob_convert_codec);
+        return 0;
+    }
+
+    if (knob_decode_sidecar)
+        load_decode_sidecars();
+
+    // before forking the lockstep systems, which get the trace from where CPU 0 left off
+    if (knob_skip_instructions) {
+        for (int i=0; i<NUM_CPUS; i++) {
+            ooo_cpu[i].seek_trace(knob_skip_instructions);
+            ooo_cpu[i].trace_start = knob_skip_instructions;
+        }
+    }
+
+    // from here on, each lockstep system initializes and simulates itself
+    if (knob_lockstep)
+        fork_lockstep();
+
     // TODO: can we initialize these variables from the class constructor?
     srand(seed_number);
     champsim_seed = seed_number;
@@ -663,7 +1304,7 @@ int main(int argc, char** argv)
         ooo_cpu[i].ROB.cpu = i;
 
         // BRANCH PREDICTOR
-        ooo_cpu[i].initialize_branch_predictor();
+        ooo_cpu[i].branch_predictor->initialize();
 
         // TLBs
         ooo_cpu[i].ITLB.cpu = i;
@@ -695,38 +1336,45 @@ int main(int argc, char** argv)
         ooo_cpu[i].L1I.MAX_READ = 2;
         ooo_cpu[i].L1I.fill_level = FILL_L1;
         ooo_cpu[i].L1I.lower_level = &ooo_cpu[i].L2C; 
-        ooo_cpu[i].l1i_prefetcher_initialize();
+        ooo_cpu[i].l1i_prefetcher->initialize();
 
         ooo_cpu[i].L1D.cpu = i;
         ooo_cpu[i].L1D.cache_type = IS_L1D;
         ooo_cpu[i].L1D.MAX_READ = (2 > MAX_READ_PER_CYCLE) ? MAX_READ_PER_CYCLE : 2;
         ooo_cpu[i].L1D.fill_level = FILL_L1;
         ooo_cpu[i].L1D.lower_level = &ooo_cpu[i].L2C; 
-        ooo_cpu[i].L1D.l1d_prefetcher_initialize();
+        ooo_cpu[i].L1D.prefetcher->initialize();
 
         ooo_cpu[i].L2C.cpu = i;
         ooo_cpu[i].L2C.cache_type = IS_L2C;
         ooo_cpu[i].L2C.fill_level = FILL_L2;
         ooo_cpu[i].L2C.upper_level_icache[i] = &ooo_cpu[i].L1I;
         ooo_cpu[i].L2C.upper_level_dcache[i] = &ooo_cpu[i].L1D;
-        ooo_cpu[i].L2C.lower_level = &uncore.LLC;
-        ooo_cpu[i].L2C.l2c_prefetcher_initialize();
+        ooo_cpu[i].L2C.lower_level = &uncore->LLC;
+        ooo_cpu[i].L2C.prefetcher->initialize();
+
+        // with a quantum, L2C requests reach the LLC through a per-core port
+        if (knob_quantum > 1) {
+            llc_port[i].cpu = i;
+            llc_port[i].llc = &uncore->LLC;
+            ooo_cpu[i].L2C.lower_level = &llc_port[i];
+        }
 
         // SHARED CACHE
-        uncore.LLC.cache_type = IS_LLC;
-        uncore.LLC.fill_level = FILL_LLC;
-        uncore.LLC.MAX_READ = NUM_CPUS;
-        uncore.LLC.upper_level_icache[i] = &ooo_cpu[i].L2C;
-        uncore.LLC.upper_level_dcache[i] = &ooo_cpu[i].L2C;
-        uncore.LLC.lower_level = &uncore.DRAM;
+        uncore->LLC.cache_type = IS_LLC;
+        uncore->LLC.fill_level = FILL_LLC;
+        uncore->LLC.MAX_READ = NUM_CPUS;
+        uncore->LLC.upper_level_icache[i] = &ooo_cpu[i].L2C;
+        uncore->LLC.upper_level_dcache[i] = &ooo_cpu[i].L2C;
+        uncore->LLC.lower_level = &uncore->DRAM;
 
         // OFF-CHIP DRAM
-        uncore.DRAM.fill_level = FILL_DRAM;
-        uncore.DRAM.upper_level_icache[i] = &uncore.LLC;
-        uncore.DRAM.upper_level_dcache[i] = &uncore.LLC;
+        uncore->DRAM.fill_level = FILL_DRAM;
+        uncore->DRAM.upper_level_icache[i] = &uncore->LLC;
+        uncore->DRAM.upper_level_dcache[i] = &uncore->LLC;
         for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
-            uncore.DRAM.RQ[i].is_RQ = 1;
-            uncore.DRAM.WQ[i].is_WQ = 1;
+            uncore->DRAM.RQ[i].is_RQ = 1;
+            uncore->DRAM.WQ[i].is_WQ = 1;
         }
 
         warmup_complete[i] = 0;
@@ -744,12 +1392,31 @@ int main(int argc, char** argv)
         major_fault[i] = 0;
     }
 
-    uncore.LLC.llc_initialize_replacement();
-    uncore.LLC.llc_prefetcher_initialize();
+    uncore->LLC.replacement->initialize();
+    uncore->LLC.prefetcher->initialize();
 
     // simulation entry point
     start_time = time(NULL);
+    if (knob_load_checkpoint) {
+        load_checkpoint(knob_load_checkpoint);
+        skip_detailed_warmup();
+    }
+    else if (knob_functional_warmup || knob_sampling_period)
+        run_functional_warmup();
+
     uint8_t run_simulation = 1;
+    if (knob_simpoints) {
+        run_simpoint_simulation();
+        run_simulation = 0;
+    }
+    else if (knob_sampling_period) {
+        run_sampled_simulation();
+        run_simulation = 0;
+    }
+    else if (knob_quantum > 1) {
+        run_parallel_simulation(show_heartbeat);
+        run_simulation = 0;
+    }
     while (run_simulation) {
 
         uint64_t elapsed_second = (uint64_t)(time(NULL) - start_time),
@@ -759,73 +1426,14 @@ int main(int argc, char** argv)
         elapsed_second -= (elapsed_hour*3600 + elapsed_minute*60);
 
         for (int i=0; i<NUM_CPUS; i++) {
-            // proceed one cycle
-            current_core_cycle[i]++;
-
-            //cout << "Trying to process instr_id: " << ooo_cpu[i].instr_unique_id << " fetch_stall: " << +ooo_cpu[i].fetch_stall;
-            //cout << " stall_cycle: " << stall_cycle[i] << " current: " << current_core_cycle[i] << endl;
-
-            // core might be stalled due to page fault or branch misprediction
-            if (stall_cycle[i] <= current_core_cycle[i]) {
-
-	      // retire
-	      if ((ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].executed == COMPLETED) && (ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].event_cycle <= current_core_cycle[i]))
-		ooo_cpu[i].retire_rob();
-
-	      // complete 
-	      ooo_cpu[i].update_rob();
-
-	      // schedule
-	      uint32_t schedule_index = ooo_cpu[i].ROB.next_schedule;
-	      if ((ooo_cpu[i].ROB.entry[schedule_index].scheduled == 0) && (ooo_cpu[i].ROB.entry[schedule_index].event_cycle <= current_core_cycle[i]))
-		ooo_cpu[i].schedule_instruction();
-	      // execute
-	      ooo_cpu[i].execute_instruction();
-
-	      ooo_cpu[i].update_rob();
-
-	      // memory operation
-	      ooo_cpu[i].schedule_memory_instruction();
-	      ooo_cpu[i].execute_memory_instruction();
-
-	      ooo_cpu[i].update_rob();
-
-	      // decode
-	      if(ooo_cpu[i].DECODE_BUFFER.occupancy > 0)
-		{
-		  ooo_cpu[i].decode_and_dispatch();
-		}
-	      
-	      // fetch
-	      ooo_cpu[i].fetch_instruction();
-	      
-	      // read from trace
-	      if ((ooo_cpu[i].IFETCH_BUFFER.occupancy < ooo_cpu[i].IFETCH_BUFFER.SIZE) && (ooo_cpu[i].fetch_stall == 0))
-		{
-		  ooo_cpu[i].read_from_trace();
-		}
-	    }
+            operate_cpu(i);
 
             // heartbeat information
-            if (show_heartbeat && (ooo_cpu[i].num_retired >= ooo_cpu[i].next_print_instruction)) {
-                float cumulative_ipc;
-                if (warmup_complete[i])
-                    cumulative_ipc = (1.0*(ooo_cpu[i].num_retired - ooo_cpu[i].begin_sim_instr)) / (current_core_cycle[i] - ooo_cpu[i].begin_sim_cycle);
-                else
-                    cumulative_ipc = (1.0*ooo_cpu[i].num_retired) / current_core_cycle[i];
-                float heartbeat_ipc = (1.0*ooo_cpu[i].num_retired - ooo_cpu[i].last_sim_instr) / (current_core_cycle[i] - ooo_cpu[i].last_sim_cycle);
-
-                cout << "Heartbeat CPU " << i << " instructions: " << ooo_cpu[i].num_retired << " cycles: " << current_core_cycle[i];
-                cout << " heartbeat IPC: " << heartbeat_ipc << " cumulative IPC: " << cumulative_ipc; 
-                cout << " (Simulation time: " << elapsed_hour << " hr " << elapsed_minute << " min " << elapsed_second << " sec) " << endl;
-                ooo_cpu[i].next_print_instruction += STAT_PRINTING_PERIOD;
-
-                ooo_cpu[i].last_sim_instr = ooo_cpu[i].num_retired;
-                ooo_cpu[i].last_sim_cycle = current_core_cycle[i];
-            }
+            if (show_heartbeat && (ooo_cpu[i].num_retired >= ooo_cpu[i].next_print_instruction))
+                print_heartbeat(i, elapsed_hour, elapsed_minute, elapsed_second);
 
             // check for deadlock
-            if (ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].ip && (ooo_cpu[i].ROB.entry[ooo_cpu[i].ROB.head].event_cycle + DEADLOCK_CYCLE) <= current_core_cycle[i])
+            if (deadlocked(i))
                 print_deadlock(i);
 
             // check for warmup
@@ -850,18 +1458,8 @@ int main(int argc, char** argv)
             
             // simulation complete
             if ((all_warmup_complete > NUM_CPUS) && (simulation_complete[i] == 0) && (ooo_cpu[i].num_retired >= (ooo_cpu[i].begin_sim_instr + ooo_cpu[i].simulation_instructions))) {
-                simulation_complete[i] = 1;
-                ooo_cpu[i].finish_sim_instr = ooo_cpu[i].num_retired - ooo_cpu[i].begin_sim_instr;
-                ooo_cpu[i].finish_sim_cycle = current_core_cycle[i] - ooo_cpu[i].begin_sim_cycle;
-
-                cout << "Finished CPU " << i << " instructions: " << ooo_cpu[i].finish_sim_instr << " cycles: " << ooo_cpu[i].finish_sim_cycle;
-                cout << " cumulative IPC: " << ((float) ooo_cpu[i].finish_sim_instr / ooo_cpu[i].finish_sim_cycle);
-                cout << " (Simulation time: " << elapsed_hour << " hr " << elapsed_minute << " min " << elapsed_second << " sec) " << endl;
-
-                record_roi_stats(i, &ooo_cpu[i].L1D);
-                record_roi_stats(i, &ooo_cpu[i].L1I);
-                record_roi_stats(i, &ooo_cpu[i].L2C);
-                record_roi_stats(i, &uncore.LLC);
+                finish_simulation(i);
+                print_finished(i, elapsed_hour, elapsed_minute, elapsed_second);
 
                 all_simulation_complete++;
             }
@@ -871,8 +1469,11 @@ int main(int argc, char** argv)
         }
 
         // TODO: should it be backward?
-        uncore.DRAM.operate();
-        uncore.LLC.operate();
+        uncore->DRAM.operate();
+        uncore->LLC.operate();
+
+        if (knob_cycle_skip && run_simulation)
+            skip_idle_cycles();
     }
 
     uint64_t elapsed_second = (uint64_t)(time(NULL) - start_time),
@@ -882,7 +1483,7 @@ int main(int argc, char** argv)
     elapsed_second -= (elapsed_hour*3600 + elapsed_minute*60);
     
     cout << endl << "ChampSim completed all CPUs" << endl;
-    if (NUM_CPUS > 1) {
+    if ((NUM_CPUS > 1) && (knob_sampling_period == 0) && (knob_simpoints == NULL)) {
         cout << endl << "Total Simulation Statistics (not including warmup)" << endl;
         for (uint32_t i=0; i<NUM_CPUS; i++) {
             cout << endl << "CPU " << i << " cumulative IPC: " << (float) (ooo_cpu[i].num_retired - ooo_cpu[i].begin_sim_instr) / (current_core_cycle[i] - ooo_cpu[i].begin_sim_cycle); 
@@ -891,12 +1492,12 @@ int main(int argc, char** argv)
             print_sim_stats(i, &ooo_cpu[i].L1D);
             print_sim_stats(i, &ooo_cpu[i].L1I);
             print_sim_stats(i, &ooo_cpu[i].L2C);
-            ooo_cpu[i].L1D.l1d_prefetcher_final_stats();
-            ooo_cpu[i].L2C.l2c_prefetcher_final_stats();
+            ooo_cpu[i].L1D.prefetcher->final_stats();
+            ooo_cpu[i].L2C.prefetcher->final_stats();
 #endif
-            print_sim_stats(i, &uncore.LLC);
+            print_sim_stats(i, &uncore->LLC);
         }
-        uncore.LLC.llc_prefetcher_final_stats();
+        uncore->LLC.prefetcher->final_stats();
     }
 
     cout << endl << "Region of Interest Statistics" << endl;
@@ -908,22 +1509,28 @@ int main(int argc, char** argv)
         print_roi_stats(i, &ooo_cpu[i].L1I);
         print_roi_stats(i, &ooo_cpu[i].L2C);
 #endif
-        print_roi_stats(i, &uncore.LLC);
+        print_roi_stats(i, &uncore->LLC);
         cout << "Major fault: " << major_fault[i] << " Minor fault: " << minor_fault[i] << endl;
     }
 
     for (uint32_t i=0; i<NUM_CPUS; i++) {
-        ooo_cpu[i].L1D.l1d_prefetcher_final_stats();
-        ooo_cpu[i].L2C.l2c_prefetcher_final_stats();
+        ooo_cpu[i].L1D.prefetcher->final_stats();
+        ooo_cpu[i].L2C.prefetcher->final_stats();
     }
 
-    uncore.LLC.llc_prefetcher_final_stats();
+    uncore->LLC.prefetcher->final_stats();
 
 #ifndef CRC2_COMPILE
-    uncore.LLC.llc_replacement_final_stats();
+    uncore->LLC.replacement->final_stats();
     print_dram_stats();
     print_branch_stats();
 #endif
 
+    if (knob_decode_sidecar)
+        save_decode_sidecars();
+
+    if (lockstep_system >= 0)
+        record_lockstep_result();
+
     return 0;
 }
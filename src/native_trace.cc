@@ -0,0 +1,371 @@
+#include <cstddef>
+#include <sys/stat.h>
+#include <zlib.h>
+#include <lzma.h>
+
+#include "native_trace.h"
+
+// the encoder and decoder index the registers and memory operands as one array each
+static_assert(offsetof(input_instr, source_registers) == offsetof(input_instr, destination_registers) + NUM_INSTR_DESTINATIONS,
+              "source_registers must follow destination_registers");
+static_assert(offsetof(input_instr, source_memory) == offsetof(input_instr, destination_memory) + NUM_INSTR_DESTINATIONS*sizeof(uint64_t),
+              "source_memory must follow destination_memory");
+#define CST_NUM_SLOTS (NUM_INSTR_DESTINATIONS + NUM_INSTR_SOURCES)
+
+static inline uint8_t *write_varint(uint8_t *p, uint64_t value)
+{
+    while (value >= 0x80) {
+        *p++ = (uint8_t)value | 0x80;
+        value >>= 7;
+    }
+    *p++ = (uint8_t)value;
+    return p;
+}
+
+static inline uint64_t read_varint(const uint8_t *&p)
+{
+    uint64_t value = *p & 0x7f;
+    uint32_t shift = 7;
+    while (*p++ & 0x80) {
+        value |= (uint64_t)(*p & 0x7f) << shift;
+        shift += 7;
+    }
+    return value;
+}
+
+static inline uint64_t zigzag(uint64_t delta)
+{
+    return (delta << 1) ^ (uint64_t)((int64_t)delta >> 63);
+}
+
+static inline uint64_t unzigzag(uint64_t value)
+{
+    return (value >> 1) ^ (0 - (value & 1));
+}
+
+uint8_t CST_WRITER::open(const char *file_name, uint32_t block_codec)
+{
+    file = fopen(file_name, "wb");
+    if (file == NULL)
+        return 0;
+
+    codec = block_codec;
+    num_records = 0;
+    index.clear();
+    encoded.reserve((size_t)CST_BLOCK_RECORDS * CST_MAX_RECORD_BYTES);
+    last_address.assign(CST_IP_TABLE_SIZE, 0);
+    last_ip = 0;
+
+    CST_HEADER header;
+    memset(&header, 0, sizeof(header));
+    strncpy(header.magic, CST_MAGIC, sizeof(header.magic));
+    header.version = CST_VERSION;
+    header.record_size = sizeof(input_instr);
+    fwrite(&header, sizeof(header), 1, file);
+
+    return 1;
+}
+
+void CST_WRITER::write(const input_instr *instr)
+{
+    size_t begin = encoded.size();
+    encoded.resize(begin + CST_MAX_RECORD_BYTES);
+    uint8_t *p = &encoded[begin];
+
+    const uint8_t *registers = instr->destination_registers;
+    const uint64_t *memory = instr->destination_memory;
+    uint8_t register_mask = 0, memory_mask = 0;
+    for (uint32_t i=0; i<CST_NUM_SLOTS; i++) {
+        register_mask |= (registers[i] != 0) << i;
+        memory_mask |= (memory[i] != 0) << i;
+    }
+
+    *p++ = register_mask | ((instr->is_branch != 0) << 6) | ((instr->branch_taken != 0) << 7);
+    *p++ = memory_mask;
+    p = write_varint(p, zigzag(instr->ip - last_ip));
+    last_ip = instr->ip;
+
+    for (uint32_t i=0; i<CST_NUM_SLOTS; i++) {
+        if (registers[i])
+            *p++ = registers[i];
+    }
+
+    uint64_t &last = last_address[cst_ip_hash(instr->ip)];
+    for (uint32_t i=0; i<CST_NUM_SLOTS; i++) {
+        if (memory[i]) {
+            p = write_varint(p, zigzag(memory[i] - last));
+            last = memory[i];
+        }
+    }
+
+    encoded.resize(p - &encoded[0]);
+    num_records++;
+    if ((num_records % CST_BLOCK_RECORDS) == 0)
+        write_block();
+}
+
+void CST_WRITER::write_block()
+{
+    CST_BLOCK_INDEX block;
+    block.offset = ftell(file);
+    block.num_records = ((num_records - 1) % CST_BLOCK_RECORDS) + 1;
+    block.first_instr = num_records - block.num_records;
+    block.encoded_size = encoded.size();
+    block.codec = codec;
+
+    vector<uint8_t> compressed;
+    if (codec == CST_CODEC_ZLIB) {
+        uLongf size = compressBound(encoded.size());
+        compressed.resize(size);
+        if (compress2(&compressed[0], &size, &encoded[0], encoded.size(), 9) != Z_OK) {
+            cerr << "*** CANNOT COMPRESS TRACE BLOCK " << index.size() << " ***" << endl;
+            assert(0);
+        }
+        compressed.resize(size);
+    }
+    else {
+        size_t size = 0;
+        compressed.resize(lzma_stream_buffer_bound(encoded.size()));
+        if (lzma_easy_buffer_encode(6, LZMA_CHECK_NONE, NULL, &encoded[0], encoded.size(), &compressed[0], &size, compressed.size()) != LZMA_OK) {
+            cerr << "*** CANNOT COMPRESS TRACE BLOCK " << index.size() << " ***" << endl;
+            assert(0);
+        }
+        compressed.resize(size);
+    }
+
+    block.compressed_size = compressed.size();
+    if (fwrite(&compressed[0], compressed.size(), 1, file) != 1) {
+        cerr << "*** CANNOT WRITE TRACE BLOCK " << index.size() << " ***" << endl;
+        assert(0);
+    }
+    index.push_back(block);
+
+    encoded.clear();
+    last_address.assign(CST_IP_TABLE_SIZE, 0);
+    last_ip = 0;
+}
+
+void CST_WRITER::close()
+{
+    if (encoded.size())
+        write_block();
+
+    CST_FOOTER footer;
+    memset(&footer, 0, sizeof(footer));
+    footer.num_blocks = index.size();
+    footer.num_records = num_records;
+    footer.index_offset = ftell(file);
+    strncpy(footer.magic, CST_INDEX_MAGIC, sizeof(footer.magic));
+
+    if ((index.size() && (fwrite(&index[0], sizeof(CST_BLOCK_INDEX), index.size(), file) != index.size()))
+        || (fwrite(&footer, sizeof(footer), 1, file) != 1) || fclose(file)) {
+        cerr << "*** CANNOT WRITE TRACE INDEX ***" << endl;
+        assert(0);
+    }
+    file = NULL;
+}
+
+class NATIVE_DECODER : public TRACE_DECODER {
+  public:
+    FILE *file;
+    vector<CST_BLOCK_INDEX> index;
+    uint64_t num_records, next_block;
+
+    // the block being decoded
+    vector<uint8_t> compressed, encoded;
+    const uint8_t *p;
+    uint32_t records_left;
+    uint64_t last_ip;
+    vector<uint64_t> last_address;
+
+    NATIVE_DECODER(FILE *v1) : file(v1) {
+        num_records = 0;
+        next_block = 0;
+        p = NULL;
+        records_left = 0;
+        last_ip = 0;
+    };
+
+    ~NATIVE_DECODER() {
+        fclose(file);
+    };
+
+    uint8_t  read_index(const char *file_name);
+    uint64_t find_block(uint64_t record);
+    void     load_block(uint64_t block),
+             seek(uint64_t record);
+    size_t   read(void *buffer, size_t size);
+    uint64_t seek_point(uint64_t record);
+};
+
+uint8_t NATIVE_DECODER::read_index(const char *file_name)
+{
+    CST_HEADER header;
+    CST_FOOTER footer;
+    if ((fread(&header, sizeof(header), 1, file) != 1) || strncmp(header.magic, CST_MAGIC, sizeof(header.magic))
+        || fseek(file, -(long)sizeof(footer), SEEK_END) || (fread(&footer, sizeof(footer), 1, file) != 1)
+        || strncmp(footer.magic, CST_INDEX_MAGIC, sizeof(footer.magic))) {
+        cerr << "*** NOT A NATIVE TRACE: " << file_name << " ***" << endl;
+        return 0;
+    }
+    if ((header.version != CST_VERSION) || (header.record_size != sizeof(input_instr))) {
+        cerr << "*** UNSUPPORTED NATIVE TRACE VERSION " << header.version << ": " << file_name << " ***" << endl;
+        return 0;
+    }
+
+    index.resize(footer.num_blocks);
+    if (footer.num_blocks && (fseek(file, footer.index_offset, SEEK_SET)
+        || (fread(&index[0], sizeof(CST_BLOCK_INDEX), footer.num_blocks, file) != footer.num_blocks))) {
+        cerr << "*** CANNOT READ NATIVE TRACE INDEX: " << file_name << " ***" << endl;
+        return 0;
+    }
+
+    num_records = footer.num_records;
+    last_address.assign(CST_IP_TABLE_SIZE, 0);
+    return 1;
+}
+
+// the block that holds record of the first repetition of the trace
+uint64_t NATIVE_DECODER::find_block(uint64_t record)
+{
+    uint64_t first = 0, last = index.size() - 1;
+    while (first < last) {
+        uint64_t middle = (first + last + 1) / 2;
+        if (index[middle].first_instr <= record)
+            first = middle;
+        else
+            last = middle - 1;
+    }
+
+    return first;
+}
+
+uint64_t NATIVE_DECODER::seek_point(uint64_t record)
+{
+    if (num_records == 0)
+        return 0;
+
+    uint64_t repetition = record - (record % num_records);
+    return repetition + index[find_block(record % num_records)].first_instr;
+}
+
+void NATIVE_DECODER::seek(uint64_t record)
+{
+    next_block = num_records ? find_block(record % num_records) : 0;
+    records_left = 0;
+}
+
+void NATIVE_DECODER::load_block(uint64_t block)
+{
+    CST_BLOCK_INDEX *entry = &index[block];
+
+    compressed.resize(entry->compressed_size);
+    encoded.resize(entry->encoded_size + CST_MAX_RECORD_BYTES); // varints are read without bounds checks
+    if (fseek(file, entry->offset, SEEK_SET) || (fread(&compressed[0], entry->compressed_size, 1, file) != 1)) {
+        cerr << "*** CANNOT READ NATIVE TRACE BLOCK " << block << " ***" << endl;
+        assert(0);
+    }
+
+    size_t size = 0;
+    if (entry->codec == CST_CODEC_ZLIB) {
+        uLongf zlib_size = entry->encoded_size;
+        if (uncompress(&encoded[0], &zlib_size, &compressed[0], entry->compressed_size) == Z_OK)
+            size = zlib_size;
+    }
+    else {
+        uint64_t memory_limit = UINT64_MAX;
+        size_t in_pos = 0;
+        if (lzma_stream_buffer_decode(&memory_limit, 0, NULL, &compressed[0], &in_pos, entry->compressed_size, &encoded[0], &size, entry->encoded_size) != LZMA_OK)
+            size = 0;
+    }
+    if (size != entry->encoded_size) {
+        cerr << "*** CORRUPT NATIVE TRACE BLOCK " << block << " ***" << endl;
+        assert(0);
+    }
+
+    p = &encoded[0];
+    records_left = entry->num_records;
+    last_ip = 0;
+    fill(last_address.begin(), last_address.end(), 0);
+}
+
+size_t NATIVE_DECODER::read(void *buffer, size_t size)
+{
+    input_instr *instr = (input_instr *)buffer;
+    size_t num_records = size / sizeof(input_instr), done = 0;
+
+    while (done < num_records) {
+        if (records_left == 0) {
+            if (next_block == index.size())
+                break;
+            load_block(next_block++);
+            continue;
+        }
+
+        memset((void *)instr, 0, sizeof(input_instr));
+
+        uint8_t register_mask = p[0], memory_mask = p[1];
+        p += 2;
+        instr->is_branch = (register_mask >> 6) & 1;
+        instr->branch_taken = register_mask >> 7;
+        last_ip += unzigzag(read_varint(p));
+        instr->ip = last_ip;
+
+        uint8_t *registers = instr->destination_registers;
+        for (uint32_t mask = register_mask & 0x3f; mask; mask &= mask - 1)
+            registers[__builtin_ctz(mask)] = *p++;
+
+        uint64_t *memory = instr->destination_memory,
+                 &last = last_address[cst_ip_hash(last_ip)];
+        for (uint32_t mask = memory_mask; mask; mask &= mask - 1) {
+            last += unzigzag(read_varint(p));
+            memory[__builtin_ctz(mask)] = last;
+        }
+
+        instr++;
+        done++;
+        records_left--;
+    }
+
+    return done * sizeof(input_instr);
+}
+
+TRACE_DECODER *open_native_decoder(const char *file_name)
+{
+    FILE *file = fopen(file_name, "rb");
+    if (file == NULL)
+        return NULL;
+
+    NATIVE_DECODER *decoder = new NATIVE_DECODER(file);
+    if (!decoder->read_index(file_name)) {
+        delete decoder;
+        return NULL;
+    }
+
+    return decoder;
+}
+
+void convert_trace(TRACE_READER *reader, const char *file_name, uint32_t codec)
+{
+    if (reader->record_size != sizeof(input_instr)) {
+        cerr << "*** -cloudsuite TRACES CANNOT BE CONVERTED ***" << endl;
+        assert(0);
+    }
+
+    CST_WRITER writer;
+    if (!writer.open(file_name, codec)) {
+        cerr << "*** CANNOT CREATE NATIVE TRACE: " << file_name << " ***" << endl;
+        assert(0);
+    }
+
+    input_instr instr;
+    while (reader->read(&instr))
+        writer.write(&instr);
+    writer.close();
+
+    struct stat input_stat, output_stat;
+    stat(reader->file_name, &input_stat);
+    stat(file_name, &output_stat);
+    cout << "Converted " << writer.num_records << " instructions in " << writer.index.size() << " blocks from " << reader->file_name;
+    cout << " (" << input_stat.st_size << " bytes) to " << file_name << " (" << output_stat.st_size << " bytes)" << endl;
+}
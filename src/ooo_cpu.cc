@@ -1,8 +1,10 @@
+#include <algorithm>
+
 #include "ooo_cpu.h"
 #include "set.h"
 
 // out-of-order core
-O3_CPU ooo_cpu[NUM_CPUS]; 
+O3_CPU *ooo_cpu; 
 uint64_t current_core_cycle[NUM_CPUS], stall_cycle[NUM_CPUS];
 uint32_t SCHEDULING_LATENCY = 0, EXEC_LATENCY = 0, DECODE_LATENCY = 0;
 
@@ -24,378 +26,358 @@ void O3_CPU::read_from_trace()
     // first, read PIN trace
     while (continue_reading) {
 
-        size_t instr_size = knob_cloudsuite ? sizeof(cloudsuite_instr) : sizeof(input_instr);
-
-        if (knob_cloudsuite) {
-            if (!fread(&current_cloudsuite_instr, instr_size, 1, trace_file)) {
-                // reached end of file for this trace
-                cout << "*** Reached end of trace for Core: " << cpu << " Repeating trace: " << trace_string << endl; 
+        // the instruction is read into a free slot of the instruction pool, where it stays until it retires
+        uint32_t slot = INSTR_POOL_free.back();
+        ooo_model_instr &arch_instr = INSTR_POOL[slot];
+        arch_instr = ooo_model_instr();
+        INSTR_COLD[slot].clear();
+        if (read_instr(&arch_instr) == 0) // reached end of trace, the loop reads again from the beginning
+            continue;
 
-                // close the trace file and re-open it
-                pclose(trace_file);
-                trace_file = popen(gunzip_command, "r");
-                if (trace_file == NULL) {
-                    cerr << endl << "*** CANNOT REOPEN TRACE FILE: " << trace_string << " ***" << endl;
-                    assert(0);
+        // update STA, this structure is required to execute store instructions properly without deadlock
+        for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
+            if (arch_instr.destination_memory[i]) {
+#ifdef SANITY_CHECK
+                if (STA[STA_tail] < UINT64_MAX) {
+                    if (STA_head != STA_tail)
+                        assert(0);
                 }
-            } else { // successfully read the trace
+#endif
+                STA[STA_tail] = instr_unique_id;
+                STA_tail++;
 
-                // copy the instruction into the performance model's instruction format
-                ooo_model_instr arch_instr;
-                int num_reg_ops = 0, num_mem_ops = 0;
+                if (STA_tail == STA_SIZE)
+                    STA_tail = 0;
+            }
+        }
 
-                arch_instr.instr_id = instr_unique_id;
-                arch_instr.ip = current_cloudsuite_instr.ip;
-                arch_instr.is_branch = current_cloudsuite_instr.is_branch;
-                arch_instr.branch_taken = current_cloudsuite_instr.branch_taken;
+        // add this instruction to the IFETCH_BUFFER
+        if (IFETCH_BUFFER.occupancy < IFETCH_BUFFER.SIZE) {
+            INSTR_POOL_free.pop_back();
+            uint32_t ifetch_buffer_index = add_to_ifetch_buffer(slot);
+            num_reads++;
+
+            // handle branch prediction
+            if (IFETCH_BUFFER.entry[ifetch_buffer_index].is_branch) {
+
+                DP( if (warmup_complete[cpu]) {
+                cout << "[BRANCH] instr_id: " << instr_unique_id << " ip: " << hex << arch_instr.ip << dec << " taken: " << +arch_instr.branch_taken << endl; });
+
+                num_branch++;
+
+                // handle branch prediction & branch predictor update
+                uint8_t branch_prediction = branch_predictor->predict_branch(IFETCH_BUFFER.entry[ifetch_buffer_index].ip);
+                uint64_t predicted_branch_target = IFETCH_BUFFER.entry[ifetch_buffer_index].branch_target;
+                if(branch_prediction == 0)
+                  {
+                    predicted_branch_target = 0;
+                  }
+                // call code prefetcher every time the branch predictor is used
+                if (!knob_cloudsuite)
+                    l1i_prefetcher->branch_operate(IFETCH_BUFFER.entry[ifetch_buffer_index].ip,
+                                                   IFETCH_BUFFER.entry[ifetch_buffer_index].branch_type,
+                                                   predicted_branch_target);
+
+                if(IFETCH_BUFFER.entry[ifetch_buffer_index].branch_taken != branch_prediction)
+                  {
+                    branch_mispredictions++;
+                    total_rob_occupancy_at_branch_mispredict += ROB.occupancy;
+                    if(warmup_complete[cpu])
+                      {
+                        fetch_stall = 1;
+                        instrs_to_read_this_cycle = 0;
+                        IFETCH_BUFFER.entry[ifetch_buffer_index].branch_mispredicted = 1;
+                      }
+                  }
+                else
+                  {
+                    // correct prediction
+                    if(branch_prediction == 1)
+                      {
+                        // if correctly predicted taken, then we can't fetch anymore instructions this cycle
+                        instrs_to_read_this_cycle = 0;
+                      }
+                  }
 
-                arch_instr.asid[0] = current_cloudsuite_instr.asid[0];
-                arch_instr.asid[1] = current_cloudsuite_instr.asid[1];
+                branch_predictor->last_branch_result(IFETCH_BUFFER.entry[ifetch_buffer_index].ip, IFETCH_BUFFER.entry[ifetch_buffer_index].branch_taken);
+            }
 
-                for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
-                    arch_instr.destination_registers[i] = current_cloudsuite_instr.destination_registers[i];
-                    arch_instr.destination_memory[i] = current_cloudsuite_instr.destination_memory[i];
-                    arch_instr.destination_virtual_address[i] = current_cloudsuite_instr.destination_memory[i];
+            if ((num_reads >= instrs_to_read_this_cycle) || (IFETCH_BUFFER.occupancy == IFETCH_BUFFER.SIZE))
+                continue_reading = 0;
+        }
+        instr_unique_id++;
+    }
 
-                    if (arch_instr.destination_registers[i])
-                        num_reg_ops++;
-                    if (arch_instr.destination_memory[i]) {
-                        num_mem_ops++;
+    //instrs_to_fetch_this_cycle = num_reads;
+}
 
-                        // update STA, this structure is required to execute store instructions properly without deadlock
-                        if (num_mem_ops > 0) {
-#ifdef SANITY_CHECK
-                            if (STA[STA_tail] < UINT64_MAX) {
-                                if (STA_head != STA_tail)
-                                    assert(0);
-                            }
-#endif
-                            STA[STA_tail] = instr_unique_id;
-                            STA_tail++;
+// read the next trace record and copy it into the performance model's instruction format
+// returns 0 if the end of the trace was reached (the trace starts over from the beginning)
+uint8_t O3_CPU::read_instr(ooo_model_instr *arch_instr)
+{
+    if (knob_cloudsuite) {
+        if (!trace.read(&current_cloudsuite_instr)) {
+            // reached end of file for this trace, the reader starts over from the beginning
+            cout << "*** Reached end of trace for Core: " << cpu << " Repeating trace: " << trace_string << endl; 
+            return 0;
+        }
 
-                            if (STA_tail == STA_SIZE)
-                                STA_tail = 0;
-                        }
-                    }
-                }
+        // copy the instruction into the performance model's instruction format
+        int num_reg_ops = 0, num_mem_ops = 0;
 
-                for (int i=0; i<NUM_INSTR_SOURCES; i++) {
-                    arch_instr.source_registers[i] = current_cloudsuite_instr.source_registers[i];
-                    arch_instr.source_memory[i] = current_cloudsuite_instr.source_memory[i];
-                    arch_instr.source_virtual_address[i] = current_cloudsuite_instr.source_memory[i];
+        arch_instr->instr_id = instr_unique_id;
+        arch_instr->ip = current_cloudsuite_instr.ip;
+        arch_instr->is_branch = current_cloudsuite_instr.is_branch;
+        arch_instr->branch_taken = current_cloudsuite_instr.branch_taken;
 
-                    if (arch_instr.source_registers[i])
-                        num_reg_ops++;
-                    if (arch_instr.source_memory[i])
-                        num_mem_ops++;
-                }
+        arch_instr->asid[0] = current_cloudsuite_instr.asid[0];
+        arch_instr->asid[1] = current_cloudsuite_instr.asid[1];
 
-                arch_instr.num_reg_ops = num_reg_ops;
-                arch_instr.num_mem_ops = num_mem_ops;
-                if (num_mem_ops > 0) 
-                    arch_instr.is_memory = 1;
-
-                // add this instruction to the IFETCH_BUFFER
-                if (IFETCH_BUFFER.occupancy < IFETCH_BUFFER.SIZE) {
-		  uint32_t ifetch_buffer_index = add_to_ifetch_buffer(&arch_instr);
-		  num_reads++;
-
-		  // handle branch prediction
-		  if (IFETCH_BUFFER.entry[ifetch_buffer_index].is_branch) {
-		    DP( if (warmup_complete[cpu]) {
-                        cout << "[BRANCH] instr_id: " << instr_unique_id << " ip: " << hex << arch_instr.ip << dec << " taken: " << +arch_instr.branch_taken << endl; });
-		    
-		    num_branch++;
-		    
-		    // handle branch prediction & branch predictor update
-		    uint8_t branch_prediction = predict_branch(IFETCH_BUFFER.entry[ifetch_buffer_index].ip);
-		    
-		    if(IFETCH_BUFFER.entry[ifetch_buffer_index].branch_taken != branch_prediction)
-		      {
-			branch_mispredictions++;
-			total_rob_occupancy_at_branch_mispredict += ROB.occupancy;
-			if(warmup_complete[cpu])
-			  {
-			    fetch_stall = 1;
-			    instrs_to_read_this_cycle = 0;
-			    IFETCH_BUFFER.entry[ifetch_buffer_index].branch_mispredicted = 1;
-			  }
-		      }
-		    else
-		      {
-			// correct prediction
-			if(branch_prediction == 1)
-			  {
-			    // if correctly predicted taken, then we can't fetch anymore instructions this cycle
-			    instrs_to_read_this_cycle = 0;
-			  }
-		      }
-		    
-		    last_branch_result(IFETCH_BUFFER.entry[ifetch_buffer_index].ip, IFETCH_BUFFER.entry[ifetch_buffer_index].branch_taken);
-		  }
-		  
-		  if ((num_reads >= instrs_to_read_this_cycle) || (IFETCH_BUFFER.occupancy == IFETCH_BUFFER.SIZE))
-		    continue_reading = 0;
-                }
-                instr_unique_id++;
-            }
+        for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
+            arch_instr->destination_registers[i] = current_cloudsuite_instr.destination_registers[i];
+            arch_instr->destination_memory[i] = current_cloudsuite_instr.destination_memory[i];
+
+            if (arch_instr->destination_registers[i])
+                num_reg_ops++;
+            if (arch_instr->destination_memory[i])
+                num_mem_ops++;
         }
-	else
-	  {
-	    input_instr trace_read_instr;
-            if (!fread(&trace_read_instr, instr_size, 1, trace_file))
-	      {
-                // reached end of file for this trace
-                cout << "*** Reached end of trace for Core: " << cpu << " Repeating trace: " << trace_string << endl; 
-		
-                // close the trace file and re-open it
-                pclose(trace_file);
-                trace_file = popen(gunzip_command, "r");
-                if (trace_file == NULL) {
-		  cerr << endl << "*** CANNOT REOPEN TRACE FILE: " << trace_string << " ***" << endl;
-                    assert(0);
-                }
+
+        for (int i=0; i<NUM_INSTR_SOURCES; i++) {
+            arch_instr->source_registers[i] = current_cloudsuite_instr.source_registers[i];
+            arch_instr->source_memory[i] = current_cloudsuite_instr.source_memory[i];
+
+            if (arch_instr->source_registers[i])
+                num_reg_ops++;
+            if (arch_instr->source_memory[i])
+                num_mem_ops++;
+        }
+
+        arch_instr->num_reg_ops = num_reg_ops;
+        arch_instr->num_mem_ops = num_mem_ops;
+        if (num_mem_ops > 0)
+            arch_instr->is_memory = 1;
+    }
+    else {
+        // points into the trace reader's ring, or into the trace itself when it is mapped
+        const input_instr *trace_read_instr = (const input_instr *)trace.next();
+        if (trace_read_instr == NULL) {
+            // reached end of file for this trace, the reader starts over from the beginning
+            cout << "*** Reached end of trace for Core: " << cpu << " Repeating trace: " << trace_string << endl; 
+            return 0;
+        }
+
+        if (instr_unique_id == 0) {
+            current_instr = next_instr = *trace_read_instr;
+            if (knob_trace_v2)
+                current_info = next_info = ((const input_instr_v2 *)trace_read_instr)->info;
+        }
+        else {
+            current_instr = next_instr;
+            next_instr = *trace_read_instr;
+            if (knob_trace_v2) {
+                current_info = next_info;
+                next_info = ((const input_instr_v2 *)trace_read_instr)->info;
             }
-	    else
-	      { // successfully read the trace
+        }
 
-		if(instr_unique_id == 0)
-		  {
-		    current_instr = next_instr = trace_read_instr;
-		  }
-		else
-		  {
-		    current_instr = next_instr;
-		    next_instr = trace_read_instr;
-		  }
+        // a synchronization marker is an instruction that does nothing
+        uint64_t sync_sequence = 0;
+        if (knob_trace_v2 && (current_info.instr_class == INSTR_CLASS_SYNC)) {
+            sync_sequence = current_instr.destination_memory[0];
+            memset(current_instr.destination_memory, 0, sizeof(current_instr.destination_memory));
+            memset(current_instr.source_memory, 0, sizeof(current_instr.source_memory));
+            memset(current_instr.source_registers, 0, sizeof(current_instr.source_registers));
+        }
 
-                // copy the instruction into the performance model's instruction format
-                ooo_model_instr arch_instr;
-                int num_reg_ops = 0, num_mem_ops = 0;
+        // the registers decide the branch type, which is looked up by IP
+        DECODED_INSTR *decoded = decode_cache.lookup(&current_instr);
+
+        // copy the instruction into the performance model's instruction format
+        int num_mem_ops = 0;
+
+        arch_instr->instr_id = instr_unique_id;
+        arch_instr->ip = current_instr.ip;
+        if (knob_trace_v2) {
+            // a version 2 trace tells the branch type instead
+            arch_instr->is_branch = (current_info.branch_type != NOT_BRANCH);
+            arch_instr->branch_taken = (current_info.branch_type == BRANCH_CONDITIONAL) || (current_info.branch_type == BRANCH_OTHER)
+                                       ? current_instr.branch_taken : arch_instr->is_branch;
+            arch_instr->branch_type = current_info.branch_type;
+            arch_instr->instr_class = current_info.instr_class;
+            arch_instr->instr_size = current_info.instr_size;
+            arch_instr->sync_sequence = sync_sequence;
+        }
+        else {
+            arch_instr->is_branch = decoded->is_branch;
+            arch_instr->branch_taken = decoded->always_taken ? 1 : current_instr.branch_taken;
+            arch_instr->branch_type = decoded->branch_type;
+        }
 
-                arch_instr.instr_id = instr_unique_id;
-                arch_instr.ip = current_instr.ip;
-                arch_instr.is_branch = current_instr.is_branch;
-                arch_instr.branch_taken = current_instr.branch_taken;
+        arch_instr->asid[0] = cpu;
+        arch_instr->asid[1] = cpu;
 
-                arch_instr.asid[0] = cpu;
-                arch_instr.asid[1] = cpu;
+        for (uint32_t i=0; i<NUM_INSTR_DESTINATIONS; i++) {
+            arch_instr->destination_registers[i] = current_instr.destination_registers[i];
+            arch_instr->destination_memory[i] = current_instr.destination_memory[i];
 
-		bool reads_sp = false;
-		bool writes_sp = false;
-		bool reads_flags = false;
-		bool reads_ip = false;
-		bool writes_ip = false;
-		bool reads_other = false;
+            if (arch_instr->destination_memory[i])
+                num_mem_ops++;
+        }
 
-                for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
-                    arch_instr.destination_registers[i] = current_instr.destination_registers[i];
-                    arch_instr.destination_memory[i] = current_instr.destination_memory[i];
-                    arch_instr.destination_virtual_address[i] = current_instr.destination_memory[i];
-
-		    switch(arch_instr.destination_registers[i])
-		      {
-		      case 0:
-			break;
-		      case REG_STACK_POINTER:
-			writes_sp = true;
-			break;
-		      case REG_INSTRUCTION_POINTER:
-			writes_ip = true;
-			break;
-		      default:
-			break;
-		      }
-
-		    /*
-		    if((arch_instr.is_branch) && (arch_instr.destination_registers[i] > 24) && (arch_instr.destination_registers[i] < 28))
-		      {
-			arch_instr.destination_registers[i] = 0;
-		      }
-		    */
-		    
-                    if (arch_instr.destination_registers[i])
-                        num_reg_ops++;
-                    if (arch_instr.destination_memory[i]) {
-                        num_mem_ops++;
-
-                        // update STA, this structure is required to execute store instructions properly without deadlock
-                        if (num_mem_ops > 0) {			  
-#ifdef SANITY_CHECK
-                            if (STA[STA_tail] < UINT64_MAX) {
-                                if (STA_head != STA_tail)
-                                    assert(0);
-                            }
-#endif
-                            STA[STA_tail] = instr_unique_id;
-                            STA_tail++;
+        for (int i=0; i<NUM_INSTR_SOURCES; i++) {
+            arch_instr->source_registers[i] = current_instr.source_registers[i];
+            arch_instr->source_memory[i] = current_instr.source_memory[i];
 
-                            if (STA_tail == STA_SIZE)
-                                STA_tail = 0;
-                        }
-                    }
-                }
+            if (arch_instr->source_memory[i])
+                num_mem_ops++;
+        }
 
-                for (int i=0; i<NUM_INSTR_SOURCES; i++) {
-                    arch_instr.source_registers[i] = current_instr.source_registers[i];
-                    arch_instr.source_memory[i] = current_instr.source_memory[i];
-                    arch_instr.source_virtual_address[i] = current_instr.source_memory[i];
+        arch_instr->num_reg_ops = decoded->num_reg_ops;
+        arch_instr->num_mem_ops = num_mem_ops;
+        if (num_mem_ops > 0)
+            arch_instr->is_memory = 1;
 
-		    switch(arch_instr.source_registers[i])
-                      {
-                      case 0:
-                        break;
-                      case REG_STACK_POINTER:
-                        reads_sp = true;
-                        break;
-                      case REG_FLAGS:
-                        reads_flags = true;
-                        break;
-                      case REG_INSTRUCTION_POINTER:
-                        reads_ip = true;
-                        break;
-                      default:
-                        reads_other = true;
-                        break;
-                      }
-		    
-		    /*
-		    if((!arch_instr.is_branch) && (arch_instr.source_registers[i] > 25) && (arch_instr.source_registers[i] < 28))
-		      {
-			arch_instr.source_registers[i] = 0;
-		      }
-		    */
-		    
-                    if (arch_instr.source_registers[i])
-                        num_reg_ops++;
-                    if (arch_instr.source_memory[i])
-                        num_mem_ops++;
-                }
+        total_branch_types[arch_instr->branch_type]++;
 
-                arch_instr.num_reg_ops = num_reg_ops;
-                arch_instr.num_mem_ops = num_mem_ops;
-                if (num_mem_ops > 0) 
-                    arch_instr.is_memory = 1;
+        if ((arch_instr->is_branch == 1) && (arch_instr->branch_taken == 1))
+            arch_instr->branch_target = next_instr.ip;
+    }
 
-		// determine what kind of branch this is, if any
-		if(!reads_sp && !reads_flags && writes_ip && !reads_other)
-		  {
-		    // direct jump
-		    arch_instr.is_branch = 1;
-                    arch_instr.branch_taken = 1;
-                    arch_instr.branch_type = BRANCH_DIRECT_JUMP;
-		  }
-		else if(!reads_sp && !reads_flags && writes_ip && reads_other)
-		  {
-		    // indirect branch
-		    arch_instr.is_branch = 1;
-                    arch_instr.branch_taken = 1;
-                    arch_instr.branch_type = BRANCH_INDIRECT;
-		  }
-		else if(!reads_sp && reads_ip && !writes_sp && writes_ip && reads_flags && !reads_other)
-		  {
-		    // conditional branch
-		    arch_instr.is_branch = 1;
-		    arch_instr.branch_taken = arch_instr.branch_taken; // don't change this
-		    arch_instr.branch_type = BRANCH_CONDITIONAL;
-		  }
-		else if(reads_sp && reads_ip && writes_sp && writes_ip && !reads_flags && !reads_other)
-		  {
-		    // direct call
-		    arch_instr.is_branch = 1;
-		    arch_instr.branch_taken = 1;
-		    arch_instr.branch_type = BRANCH_DIRECT_CALL;
-		  }
-		else if(reads_sp && reads_ip && writes_sp && writes_ip && !reads_flags && reads_other)
-		  {
-		    // indirect call
-		    arch_instr.is_branch = 1;
-		    arch_instr.branch_taken = 1;
-		    arch_instr.branch_type = BRANCH_INDIRECT_CALL;
-		  }
-		else if(reads_sp && !reads_ip && writes_sp && writes_ip)
-		  {
-		    // return
-		    arch_instr.is_branch = 1;
-		    arch_instr.branch_taken = 1;
-		    arch_instr.branch_type = BRANCH_RETURN;
-		  }
-		else if(writes_ip)
-		  {
-		    // some other branch type that doesn't fit the above categories
-		    arch_instr.is_branch = 1;
-                    arch_instr.branch_taken = arch_instr.branch_taken; // don't change this
-                    arch_instr.branch_type = BRANCH_OTHER;
-		  }
+    return 1;
+}
 
-		total_branch_types[arch_instr.branch_type]++;
-		
-		if((arch_instr.is_branch == 1) && (arch_instr.branch_taken == 1))
-		  {
-		    arch_instr.branch_target = next_instr.ip;
-		  }
+// make instruction num_instr the next one read from the trace, jumping to it when the trace has a block index
+void O3_CPU::seek_trace(uint64_t num_instr)
+{
+    // instruction n is made from trace record n-1, with record n as next_instr to find its branch target
+    if (knob_cloudsuite || (num_instr == 0)) {
+        trace.seek(num_instr);
+        instr_unique_id = num_instr;
+        return;
+    }
 
-                // add this instruction to the IFETCH_BUFFER
-                if (IFETCH_BUFFER.occupancy < IFETCH_BUFFER.SIZE) {
-		  uint32_t ifetch_buffer_index = add_to_ifetch_buffer(&arch_instr);
-		  num_reads++;
-
-                    // handle branch prediction
-                    if (IFETCH_BUFFER.entry[ifetch_buffer_index].is_branch) {
-
-                        DP( if (warmup_complete[cpu]) {
-                        cout << "[BRANCH] instr_id: " << instr_unique_id << " ip: " << hex << arch_instr.ip << dec << " taken: " << +arch_instr.branch_taken << endl; });
-
-                        num_branch++;
-
-			// handle branch prediction & branch predictor update
-			uint8_t branch_prediction = predict_branch(IFETCH_BUFFER.entry[ifetch_buffer_index].ip);
-			uint64_t predicted_branch_target = IFETCH_BUFFER.entry[ifetch_buffer_index].branch_target;
-			if(branch_prediction == 0)
-			  {
-			    predicted_branch_target = 0;
-			  }
-			// call code prefetcher every time the branch predictor is used
-			l1i_prefetcher_branch_operate(IFETCH_BUFFER.entry[ifetch_buffer_index].ip,
-						      IFETCH_BUFFER.entry[ifetch_buffer_index].branch_type,
-						      predicted_branch_target);
-			
-			if(IFETCH_BUFFER.entry[ifetch_buffer_index].branch_taken != branch_prediction)
-			  {
-			    branch_mispredictions++;
-			    total_rob_occupancy_at_branch_mispredict += ROB.occupancy;
-			    if(warmup_complete[cpu])
-			      {
-				fetch_stall = 1;
-				instrs_to_read_this_cycle = 0;
-				IFETCH_BUFFER.entry[ifetch_buffer_index].branch_mispredicted = 1;
-			      }
-			  }
-			else
-			  {
-			    // correct prediction
-			    if(branch_prediction == 1)
-			      {
-				// if correctly predicted taken, then we can't fetch anymore instructions this cycle
-				instrs_to_read_this_cycle = 0;
-			      }
-			  }
-			
-			last_branch_result(IFETCH_BUFFER.entry[ifetch_buffer_index].ip, IFETCH_BUFFER.entry[ifetch_buffer_index].branch_taken);
-                    }
+    trace.seek(num_instr - 1);
 
-                    if ((num_reads >= instrs_to_read_this_cycle) || (IFETCH_BUFFER.occupancy == IFETCH_BUFFER.SIZE))
-                        continue_reading = 0;
-                }
-                instr_unique_id++;
-            }
-        }
+    ooo_model_instr arch_instr;
+    instr_unique_id = 0;
+    while (read_instr(&arch_instr) == 0);
+    instr_unique_id = num_instr;
+}
+
+// read past instructions without simulating them
+void O3_CPU::skip_instructions(uint64_t num_instr)
+{
+    seek_trace(instr_unique_id + num_instr);
+    num_retired += num_instr;
+}
+
+// functional warmup: consume one instruction from the trace and touch the branch predictor,
+// TLBs, caches, and prefetchers it would touch, without modeling the pipeline
+void O3_CPU::functional_warmup()
+{
+    ooo_model_instr arch_instr;
+    if (read_instr(&arch_instr) == 0)
+        return;
+
+    if (arch_instr.sync_sequence)
+        sync_marker_retired(arch_instr.sync_sequence);
+
+    // branch predictor
+    if (arch_instr.is_branch) {
+        num_branch++;
+
+        uint8_t branch_prediction = branch_predictor->predict_branch(arch_instr.ip);
+        if (!knob_cloudsuite)
+            l1i_prefetcher->branch_operate(arch_instr.ip, arch_instr.branch_type, branch_prediction ? arch_instr.branch_target : 0);
+        if (arch_instr.branch_taken != branch_prediction)
+            branch_mispredictions++;
+
+        branch_predictor->last_branch_result(arch_instr.ip, arch_instr.branch_taken);
     }
 
-    //instrs_to_fetch_this_cycle = num_reads;
+    // instruction fetch, once per cache line like the fetch stage
+    if ((arch_instr.ip >> LOG2_BLOCK_SIZE) != functional_fetch_line) {
+        functional_fetch_line = arch_instr.ip >> LOG2_BLOCK_SIZE;
+
+        PACKET tlb_packet;
+        tlb_packet.instruction = 1;
+        tlb_packet.is_data = 0;
+        tlb_packet.fill_level = FILL_L1;
+        tlb_packet.cpu = cpu;
+        tlb_packet.address = arch_instr.ip >> LOG2_PAGE_SIZE;
+        tlb_packet.full_addr = arch_instr.ip;
+        tlb_packet.instr_id = arch_instr.instr_id;
+        tlb_packet.ip = arch_instr.ip;
+        tlb_packet.type = LOAD;
+        tlb_packet.asid[0] = arch_instr.asid[0];
+        tlb_packet.asid[1] = arch_instr.asid[1];
+        ITLB.functional_access(&tlb_packet);
+
+        uint64_t instruction_pa = (tlb_packet.data << LOG2_PAGE_SIZE) | (arch_instr.ip & ((1 << LOG2_PAGE_SIZE) - 1));
+
+        PACKET fetch_packet;
+        fetch_packet.instruction = 1;
+        fetch_packet.is_data = 0;
+        fetch_packet.fill_level = FILL_L1;
+        fetch_packet.fill_l1i = 1;
+        fetch_packet.cpu = cpu;
+        fetch_packet.address = instruction_pa >> 6;
+        fetch_packet.instruction_pa = instruction_pa;
+        fetch_packet.full_addr = instruction_pa;
+        fetch_packet.ip = arch_instr.ip;
+        fetch_packet.type = LOAD;
+
+        // invoke code prefetcher
+        int hit_way = L1I.check_hit(&fetch_packet);
+        uint8_t prefetch_hit = 0;
+        if (hit_way != -1)
+            prefetch_hit = L1I.block[L1I.get_set(fetch_packet.address)][hit_way].prefetch;
+        l1i_prefetcher->cache_operate(fetch_packet.ip, (hit_way != -1), prefetch_hit);
+
+        L1I.functional_access(&fetch_packet);
+    }
+
+    // loads, then stores
+    for (int i=0; i<NUM_INSTR_SOURCES+MAX_INSTR_DESTINATIONS; i++) {
+        uint8_t is_load = (i < NUM_INSTR_SOURCES);
+        uint64_t va = is_load ? arch_instr.source_memory[i] : arch_instr.destination_memory[i-NUM_INSTR_SOURCES];
+        if (va == 0)
+            continue;
+
+        PACKET tlb_packet;
+        tlb_packet.fill_level = FILL_L1;
+        tlb_packet.cpu = cpu;
+        tlb_packet.address = va >> LOG2_PAGE_SIZE;
+        tlb_packet.full_addr = va;
+        tlb_packet.instr_id = arch_instr.instr_id;
+        tlb_packet.ip = arch_instr.ip;
+        tlb_packet.type = is_load ? LOAD : RFO;
+        tlb_packet.asid[0] = arch_instr.asid[0];
+        tlb_packet.asid[1] = arch_instr.asid[1];
+        DTLB.functional_access(&tlb_packet);
+
+        uint64_t data_pa = (tlb_packet.data << LOG2_PAGE_SIZE) | (va & ((1 << LOG2_PAGE_SIZE) - 1));
+
+        PACKET data_packet;
+        data_packet.fill_level = FILL_L1;
+        data_packet.fill_l1d = 1;
+        data_packet.cpu = cpu;
+        data_packet.address = data_pa >> LOG2_BLOCK_SIZE;
+        data_packet.full_addr = data_pa;
+        data_packet.instr_id = arch_instr.instr_id;
+        data_packet.ip = arch_instr.ip;
+        data_packet.type = is_load ? LOAD : RFO;
+        data_packet.asid[0] = arch_instr.asid[0];
+        data_packet.asid[1] = arch_instr.asid[1];
+        L1D.functional_access(&data_packet);
+    }
+
+    num_retired++;
+    instr_unique_id++;
 }
 
-uint32_t O3_CPU::add_to_rob(ooo_model_instr *arch_instr)
+uint32_t O3_CPU::add_to_rob(uint32_t slot)
 {
     uint32_t index = ROB.tail;    
 
@@ -406,9 +388,36 @@ uint32_t O3_CPU::add_to_rob(ooo_model_instr *arch_instr)
         assert(0);
     }
 
-    ROB.entry[index] = *arch_instr;
+    ROB.entry.slot[index] = slot;
     ROB.entry[index].event_cycle = current_core_cycle[cpu];
 
+    // link the registers to their last writers, then make this instruction the last writer of its destinations
+    for (uint32_t i=0; i<NUM_INSTR_SOURCES; i++)
+        if (ROB.entry[index].source_registers[i])
+            ROB.entry[index].source_producer[i] = rename_table[ROB.entry[index].source_registers[i]];
+    for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++)
+        if (ROB.entry[index].destination_registers[i])
+            ROB.entry[index].prior_producer[i] = rename_table[ROB.entry[index].destination_registers[i]];
+    for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
+        if (ROB.entry[index].destination_registers[i]) {
+            rename_table[ROB.entry[index].destination_registers[i]].instr_id = ROB.entry[index].instr_id;
+            rename_table[ROB.entry[index].destination_registers[i]].rob_index = index;
+        }
+    }
+
+    // the same for the addresses it stores to, which add_load_queue() follows to find the store a load depends on
+    for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
+        if (ROB.entry[index].destination_memory[i] == 0)
+            continue;
+
+        REG_PRODUCER &last_store = store_table[ROB.entry[index].destination_memory[i]];
+        if ((last_store.instr_id == ROB.entry[index].instr_id) && (last_store.rob_index == index))
+            continue; // another destination of this instruction has the same address
+        ROB.entry[index].prior_store[i] = last_store;
+        last_store.instr_id = ROB.entry[index].instr_id;
+        last_store.rob_index = index;
+    }
+
     ROB.occupancy++;
     ROB.tail++;
     if (ROB.tail >= ROB.SIZE)
@@ -431,7 +440,7 @@ uint32_t O3_CPU::add_to_rob(ooo_model_instr *arch_instr)
     return index;
 }
 
-uint32_t O3_CPU::add_to_ifetch_buffer(ooo_model_instr *arch_instr)
+uint32_t O3_CPU::add_to_ifetch_buffer(uint32_t slot)
 {
   /*
   if((arch_instr->is_branch != 0) && (arch_instr->branch_type == BRANCH_OTHER))
@@ -460,9 +469,14 @@ uint32_t O3_CPU::add_to_ifetch_buffer(ooo_model_instr *arch_instr)
       assert(0);
     }
 
-  IFETCH_BUFFER.entry[index] = *arch_instr;
+  IFETCH_BUFFER.entry.slot[index] = slot;
   IFETCH_BUFFER.entry[index].event_cycle = current_core_cycle[cpu];
 
+  for (uint32_t i=0; i<NUM_INSTR_DESTINATIONS_SPARC; i++)
+    INSTR_COLD[slot].destination_virtual_address[i] = IFETCH_BUFFER.entry[index].destination_memory[i];
+  for (uint32_t i=0; i<NUM_INSTR_SOURCES; i++)
+    INSTR_COLD[slot].source_virtual_address[i] = IFETCH_BUFFER.entry[index].source_memory[i];
+
   // magically translate instructions
   uint64_t instr_pa = va_to_pa(cpu, IFETCH_BUFFER.entry[index].instr_id, IFETCH_BUFFER.entry[index].ip , (IFETCH_BUFFER.entry[index].ip)>>LOG2_PAGE_SIZE, 1);
   instr_pa >>= LOG2_PAGE_SIZE;
@@ -484,7 +498,7 @@ uint32_t O3_CPU::add_to_ifetch_buffer(ooo_model_instr *arch_instr)
   return index;
 }
 
-uint32_t O3_CPU::add_to_decode_buffer(ooo_model_instr *arch_instr)
+uint32_t O3_CPU::add_to_decode_buffer(uint32_t slot)
 {
   uint32_t index = DECODE_BUFFER.tail;
 
@@ -495,7 +509,7 @@ uint32_t O3_CPU::add_to_decode_buffer(ooo_model_instr *arch_instr)
       assert(0);
     }
 
-  DECODE_BUFFER.entry[index] = *arch_instr;
+  DECODE_BUFFER.entry.slot[index] = slot;
   DECODE_BUFFER.entry[index].event_cycle = current_core_cycle[cpu];
 
   DECODE_BUFFER.occupancy++;
@@ -608,7 +622,7 @@ void O3_CPU::fetch_instruction()
 	      // successfully sent to the ITLB, so mark all instructions in the IFETCH_BUFFER that match this ip as translated INFLIGHT
 	      for(uint32_t j=0; j<IFETCH_BUFFER.SIZE; j++)
 		{
-		  if((((IFETCH_BUFFER.entry[j].ip)>>LOG2_PAGE_SIZE) == ((IFETCH_BUFFER.entry[index].ip)>>LOG2_PAGE_SIZE)) && (IFETCH_BUFFER.entry[j].translated == 0))
+		  if(IFETCH_BUFFER.entry[j].ip && (((IFETCH_BUFFER.entry[j].ip)>>LOG2_PAGE_SIZE) == ((IFETCH_BUFFER.entry[index].ip)>>LOG2_PAGE_SIZE)) && (IFETCH_BUFFER.entry[j].translated == 0))
 		    {
 		      IFETCH_BUFFER.entry[j].translated = INFLIGHT;
 		      IFETCH_BUFFER.entry[j].fetched = 0;
@@ -646,7 +660,7 @@ void O3_CPU::fetch_instruction()
 	    {
 	      prefetch_hit = L1I.block[L1I.get_set(fetch_packet.address)][hit_way].prefetch;
 	    }
-	  l1i_prefetcher_cache_operate(fetch_packet.ip, (hit_way != -1), prefetch_hit);
+	  l1i_prefetcher->cache_operate(fetch_packet.ip, (hit_way != -1), prefetch_hit);
 	      
 	  int rq_index = L1I.add_rq(&fetch_packet);
 
@@ -655,7 +669,7 @@ void O3_CPU::fetch_instruction()
 	      // mark all instructions from this cache line as having been fetched
 	      for(uint32_t j=0; j<IFETCH_BUFFER.SIZE; j++)
 		{
-		  if(((IFETCH_BUFFER.entry[j].ip)>>6) == ((IFETCH_BUFFER.entry[index].ip)>>6))
+		  if(IFETCH_BUFFER.entry[j].ip && (((IFETCH_BUFFER.entry[j].ip)>>6) == ((IFETCH_BUFFER.entry[index].ip)>>6)))
 		    {
 		      IFETCH_BUFFER.entry[j].translated = COMPLETED;
 		      IFETCH_BUFFER.entry[j].fetched = INFLIGHT;
@@ -694,11 +708,10 @@ void O3_CPU::fetch_instruction()
 	{
 	  if(DECODE_BUFFER.occupancy < DECODE_BUFFER.SIZE)
 	    {
-	      uint32_t decode_index = add_to_decode_buffer(&IFETCH_BUFFER.entry[IFETCH_BUFFER.head]);
+	      uint32_t decode_index = add_to_decode_buffer(IFETCH_BUFFER.entry.slot[IFETCH_BUFFER.head]);
 	      DECODE_BUFFER.entry[decode_index].event_cycle = 0;
 	      
-	      ooo_model_instr empty_entry;
-	      IFETCH_BUFFER.entry[IFETCH_BUFFER.head] = empty_entry;
+	      IFETCH_BUFFER.entry.slot[IFETCH_BUFFER.head] = 0;
 	      
 	      IFETCH_BUFFER.head++;
 	      if(IFETCH_BUFFER.head >= IFETCH_BUFFER.SIZE)
@@ -736,11 +749,10 @@ void O3_CPU::decode_and_dispatch()
 	 ((DECODE_BUFFER.entry[DECODE_BUFFER.head].event_cycle != 0) && (DECODE_BUFFER.entry[DECODE_BUFFER.head].event_cycle < current_core_cycle[cpu]) && (ROB.occupancy < ROB.SIZE)))
 	{
 	  // move this instruction to the ROB if there's space
-	  uint32_t rob_index = add_to_rob(&DECODE_BUFFER.entry[DECODE_BUFFER.head]);
+	  uint32_t rob_index = add_to_rob(DECODE_BUFFER.entry.slot[DECODE_BUFFER.head]);
 	  ROB.entry[rob_index].event_cycle = current_core_cycle[cpu];
 
-	  ooo_model_instr empty_entry;
-	  DECODE_BUFFER.entry[DECODE_BUFFER.head] = empty_entry;
+	  DECODE_BUFFER.entry.slot[DECODE_BUFFER.head] = 0;
 	  
 	  DECODE_BUFFER.head++;
 	  if(DECODE_BUFFER.head >= DECODE_BUFFER.SIZE)
@@ -771,7 +783,7 @@ void O3_CPU::decode_and_dispatch()
 	  break;
 	}
       
-      if(DECODE_BUFFER.entry[decode_index].event_cycle == 0)
+      if(DECODE_BUFFER.entry[decode_index].ip && (DECODE_BUFFER.entry[decode_index].event_cycle == 0))
 	{
 	  // apply decode latency
 	  DECODE_BUFFER.entry[decode_index].event_cycle = current_core_cycle[cpu] + DECODE_LATENCY;
@@ -843,11 +855,36 @@ void O3_CPU::schedule_instruction()
     if ((ROB.head == ROB.tail) && ROB.occupancy == 0)
         return;
 
-    // execution is out-of-order but we have an in-order scheduling algorithm to detect all RAW dependencies
+    // with -ready_list_scheduler, instructions enter a scheduler of SCHEDULER_SIZE entries in order as long as
+    // it has room, however far they are from the ROB head, so only the instructions entering it are looked at
+    if (knob_ready_list_scheduler) {
+        while (scheduler_occupancy < SCHEDULER_SIZE) {
+            uint32_t i = ROB.next_schedule;
+            if ((ROB.entry[i].ip == 0) || ROB.entry[i].scheduled || (ROB.entry[i].fetched != COMPLETED) || (ROB.entry[i].event_cycle > current_core_cycle[cpu]))
+                return;
+
+            do_scheduling(i);
+        }
+        return;
+    }
+
+    // execution is out-of-order but we have an in-order scheduling algorithm to detect all RAW dependencies;
+    // the scan passes over the scheduled instructions at the ROB head without doing anything unless one of them
+    // stops it, so it starts at the first unscheduled instruction
+    uint32_t num_scheduled = 0;
+    if (ROB.entry[ROB.head].scheduled) {
+        if ((oldest_blocker(0) != UINT64_MAX) || (oldest_blocker(1) != UINT64_MAX))
+            return;
+
+        num_scheduled = (ROB.next_schedule > ROB.head) ? (ROB.next_schedule - ROB.head) : (ROB.SIZE - ROB.head);
+        if (num_scheduled >= SCHEDULER_SIZE)
+            return;
+    }
+
     uint32_t limit = ROB.next_fetch[1];
-    num_searched = 0;
+    num_searched = num_scheduled;
     if (ROB.head < limit) {
-        for (uint32_t i=ROB.head; i<limit; i++) { 
+        for (uint32_t i=ROB.head+num_scheduled; i<limit; i++) { 
             if ((ROB.entry[i].fetched != COMPLETED) || (ROB.entry[i].event_cycle > current_core_cycle[cpu]) || (num_searched >= SCHEDULER_SIZE))
                 return;
 
@@ -858,7 +895,7 @@ void O3_CPU::schedule_instruction()
         }
     }
     else {
-        for (uint32_t i=ROB.head; i<ROB.SIZE; i++) {
+        for (uint32_t i=ROB.head+num_scheduled; i<ROB.SIZE; i++) {
             if ((ROB.entry[i].fetched != COMPLETED) || (ROB.entry[i].event_cycle > current_core_cycle[cpu]) || (num_searched >= SCHEDULER_SIZE))
                 return;
 
@@ -885,9 +922,14 @@ void O3_CPU::do_scheduling(uint32_t rob_index)
 
     reg_dependency(rob_index);
     ROB.next_schedule = (rob_index == (ROB.SIZE - 1)) ? 0 : (rob_index + 1);
+    scheduler_occupancy++;
 
-    if (ROB.entry[rob_index].is_memory)
+    if (ROB.entry[rob_index].is_memory) {
         ROB.entry[rob_index].scheduled = INFLIGHT;
+        add_schedule_blocker(rob_index);
+        if (ROB.entry[rob_index].reg_ready)
+            memory_ready.insert(make_pair(ROB.entry[rob_index].instr_id, rob_index));
+    }
     else {
         ROB.entry[rob_index].scheduled = COMPLETED;
 
@@ -896,8 +938,11 @@ void O3_CPU::do_scheduling(uint32_t rob_index)
             ROB.entry[rob_index].event_cycle = current_core_cycle[cpu] + SCHEDULING_LATENCY;
         else
             ROB.entry[rob_index].event_cycle += SCHEDULING_LATENCY;
+        add_schedule_blocker(rob_index);
 
-        if (ROB.entry[rob_index].reg_ready) {
+        if (ROB.entry[rob_index].reg_ready && knob_ready_list_scheduler)
+            add_to_ready_list(rob_index);
+        else if (ROB.entry[rob_index].reg_ready) {
 
 #ifdef SANITY_CHECK
             if (RTE1[RTE1_tail] < ROB_SIZE)
@@ -934,32 +979,26 @@ void O3_CPU::reg_dependency(uint32_t rob_index)
         }
     } }); 
 
-    // check RAW dependency
-    int prior = rob_index - 1;
-    if (prior < 0)
-        prior = ROB.SIZE - 1;
-
-    if (rob_index != ROB.head) {
-        if ((int)ROB.head <= prior) {
-            for (int i=prior; i>=(int)ROB.head; i--) if (ROB.entry[i].executed != COMPLETED) {
-		for (uint32_t j=0; j<NUM_INSTR_SOURCES; j++) {
-			if (ROB.entry[rob_index].source_registers[j] && (ROB.entry[rob_index].reg_RAW_checked[j] == 0))
-				reg_RAW_dependency(i, rob_index, j);
-		}
-	    }
-        } else {
-            for (int i=prior; i>=0; i--) if (ROB.entry[i].executed != COMPLETED) {
-		for (uint32_t j=0; j<NUM_INSTR_SOURCES; j++) {
-			if (ROB.entry[rob_index].source_registers[j] && (ROB.entry[rob_index].reg_RAW_checked[j] == 0))
-				reg_RAW_dependency(i, rob_index, j);
-		}
-	    }
-            for (int i=ROB.SIZE-1; i>=(int)ROB.head; i--) if (ROB.entry[i].executed != COMPLETED) {
-		for (uint32_t j=0; j<NUM_INSTR_SOURCES; j++) {
-			if (ROB.entry[rob_index].source_registers[j] && (ROB.entry[rob_index].reg_RAW_checked[j] == 0))
-				reg_RAW_dependency(i, rob_index, j);
-		}
-	    }
+    // check RAW dependency: the producer is the youngest older writer of the register that has not
+    // completed, found by following the writers of the register from the last one before this instruction
+    // back until one has retired, instead of searching the ROB
+    for (uint32_t j=0; j<NUM_INSTR_SOURCES; j++) {
+        if ((ROB.entry[rob_index].source_registers[j] == 0) || ROB.entry[rob_index].reg_RAW_checked[j])
+            continue;
+
+        REG_PRODUCER producer = ROB.entry[rob_index].source_producer[j];
+        while ((producer.rob_index < ROB.SIZE) && (ROB.entry[producer.rob_index].instr_id == producer.instr_id)
+               && ROB.entry[producer.rob_index].ip) {
+            ooo_model_instr *prior = &ROB.entry[producer.rob_index];
+            if (prior->executed != COMPLETED) {
+                reg_RAW_dependency(producer.rob_index, rob_index, j);
+                break;
+            }
+
+            uint32_t i = 0;
+            while (prior->destination_registers[i] != ROB.entry[rob_index].source_registers[j])
+                i++;
+            producer = prior->prior_producer[i];
         }
     }
 }
@@ -973,8 +1012,8 @@ void O3_CPU::reg_RAW_dependency(uint32_t prior, uint32_t current, uint32_t sourc
         if (ROB.entry[prior].destination_registers[i] == ROB.entry[current].source_registers[source_index]) {
 
             // we need to mark this dependency in the ROB since the producer might not be added in the store queue yet
-            ROB.entry[prior].registers_instrs_depend_on_me.insert (current);   // this load cannot be executed until the prior store gets executed
-            ROB.entry[prior].registers_index_depend_on_me[source_index].insert (current);   // this load cannot be executed until the prior store gets executed
+            INSTR_COLD[ROB.entry.slot[prior]].registers_instrs_depend_on_me.insert (current);   // this load cannot be executed until the prior store gets executed
+            INSTR_COLD[ROB.entry.slot[prior]].registers_index_depend_on_me[source_index].insert (current);   // this load cannot be executed until the prior store gets executed
             ROB.entry[prior].reg_RAW_producer = 1;
 
             ROB.entry[current].reg_ready = 0;
@@ -1000,7 +1039,30 @@ void O3_CPU::execute_instruction()
     // out-of-order execution for non-memory instructions
     // memory instructions are handled by memory_instruction()
     uint32_t exec_issued = 0, num_iteration = 0;
-    
+
+    // with -ready_list_scheduler, the oldest ready instructions issue first; the ones still waiting
+    // for SCHEDULING_LATENCY go back on the heap
+    if (knob_ready_list_scheduler) {
+        while ((exec_issued < EXEC_WIDTH) && !ready_list.empty()) {
+            pop_heap(ready_list.begin(), ready_list.end(), greater<pair<uint64_t, uint32_t>>());
+            if (ROB.entry[ready_list.back().second].event_cycle <= current_core_cycle[cpu]) {
+                do_execution(ready_list.back().second);
+                exec_issued++;
+            }
+            else
+                ready_later.push_back(ready_list.back());
+            ready_list.pop_back();
+        }
+
+        for (uint32_t i=0; i<ready_later.size(); i++) {
+            ready_list.push_back(ready_later[i]);
+            push_heap(ready_list.begin(), ready_list.end(), greater<pair<uint64_t, uint32_t>>());
+        }
+        ready_later.clear();
+        return;
+    }
+
+    // a head that is not ready yet stays the head for the rest of the cycle
     while (exec_issued < EXEC_WIDTH) {
         if (RTE0[RTE0_head] < ROB_SIZE) {
             uint32_t exec_index = RTE0[RTE0_head];
@@ -1013,6 +1075,8 @@ void O3_CPU::execute_instruction()
                     RTE0_head = 0;
                 exec_issued++;
             }
+            else
+                break;
         }
         else {
             //DP (if (warmup_complete[cpu]) {
@@ -1038,6 +1102,8 @@ void O3_CPU::execute_instruction()
                     RTE1_head = 0;
                 exec_issued++;
             }
+            else
+                break;
         }
         else {
             //DP (if (warmup_complete[cpu]) {
@@ -1058,14 +1124,38 @@ void O3_CPU::do_execution(uint32_t rob_index)
   //cout << "do_execution() rob_index: " << rob_index << " cycle: " << current_core_cycle[cpu] << endl;
   
         ROB.entry[rob_index].executed = INFLIGHT;
+        scheduler_occupancy--;
+
+        // ADD LATENCY, which depends on the instruction class in a version 2 trace
+        uint32_t latency = EXEC_LATENCY;
+        switch (ROB.entry[rob_index].instr_class) {
+          case INSTR_CLASS_INT_MUL:
+            latency += INT_MUL_LATENCY;
+            break;
+          case INSTR_CLASS_INT_DIV:
+            latency += INT_DIV_LATENCY;
+            break;
+          case INSTR_CLASS_FP:
+            latency += FP_LATENCY;
+            break;
+          case INSTR_CLASS_FP_DIV:
+            latency += FP_DIV_LATENCY;
+            break;
+          case INSTR_CLASS_SIMD:
+            latency += SIMD_LATENCY;
+            break;
+          default:
+            break;
+        }
 
-        // ADD LATENCY
         if (ROB.entry[rob_index].event_cycle < current_core_cycle[cpu])
-            ROB.entry[rob_index].event_cycle = current_core_cycle[cpu] + EXEC_LATENCY;
+            ROB.entry[rob_index].event_cycle = current_core_cycle[cpu] + latency;
         else
-            ROB.entry[rob_index].event_cycle += EXEC_LATENCY;
+            ROB.entry[rob_index].event_cycle += latency;
+        add_schedule_blocker(rob_index);
 
         inflight_reg_executions++;
+        schedule_completion(rob_index, ROB.entry[rob_index].event_cycle);
 
         DP (if (warmup_complete[cpu]) {
         cout << "[ROB] " << __func__ << " non-memory instr_id: " << ROB.entry[rob_index].instr_id; 
@@ -1078,45 +1168,16 @@ void O3_CPU::schedule_memory_instruction()
     if ((ROB.head == ROB.tail) && ROB.occupancy == 0)
         return;
 
-    // execution is out-of-order but we have an in-order scheduling algorithm to detect all RAW dependencies
-    uint32_t limit = ROB.next_schedule;
+    // execution is out-of-order but we have an in-order scheduling algorithm to detect all RAW dependencies;
+    // of the memory instructions in the ROB, the scan only acts on the ones whose registers are ready, up to
+    // the oldest one whose event_cycle is still ahead, so only those are visited
+    uint64_t blocker = oldest_blocker(1);
     num_searched = 0;
-    if (ROB.head < limit) {
-        for (uint32_t i=ROB.head; i<limit; i++) {
-
-            if (ROB.entry[i].is_memory == 0)
-                continue;
-
-            if ((ROB.entry[i].fetched != COMPLETED) || (ROB.entry[i].event_cycle > current_core_cycle[cpu]) || (num_searched >= SCHEDULER_SIZE))
-                break;
-
-            if (ROB.entry[i].is_memory && ROB.entry[i].reg_ready && (ROB.entry[i].scheduled == INFLIGHT))
-                do_memory_scheduling(i);
-        }
-    }
-    else {
-        for (uint32_t i=ROB.head; i<ROB.SIZE; i++) {
-
-            if (ROB.entry[i].is_memory == 0)
-                continue;
-
-            if ((ROB.entry[i].fetched != COMPLETED) || (ROB.entry[i].event_cycle > current_core_cycle[cpu]) || (num_searched >= SCHEDULER_SIZE))
-                break;
-
-            if (ROB.entry[i].is_memory && ROB.entry[i].reg_ready && (ROB.entry[i].scheduled == INFLIGHT))
-                do_memory_scheduling(i);
-        }
-        for (uint32_t i=0; i<limit; i++) {
-
-            if (ROB.entry[i].is_memory == 0)
-                continue;
-
-            if ((ROB.entry[i].fetched != COMPLETED) || (ROB.entry[i].event_cycle > current_core_cycle[cpu]) || (num_searched >= SCHEDULER_SIZE))
-                break;
-
-            if (ROB.entry[i].is_memory && ROB.entry[i].reg_ready && (ROB.entry[i].scheduled == INFLIGHT))
-                do_memory_scheduling(i);
-        }
+    set<pair<uint64_t, uint32_t>>::iterator ready = memory_ready.begin();
+    while ((ready != memory_ready.end()) && (ready->first < blocker) && (num_searched < SCHEDULER_SIZE)) {
+        uint32_t rob_index = ready->second;
+        ready++;
+        do_memory_scheduling(rob_index);
     }
 }
 
@@ -1131,8 +1192,13 @@ void O3_CPU::do_memory_scheduling(uint32_t rob_index)
     uint32_t not_available = check_and_add_lsq(rob_index);
     if (not_available == 0) {
         ROB.entry[rob_index].scheduled = COMPLETED;
-        if (ROB.entry[rob_index].executed == 0) // it could be already set to COMPLETED due to store-to-load forwarding
+        memory_ready.erase(make_pair(ROB.entry[rob_index].instr_id, rob_index));
+        scheduler_occupancy--;
+        if (ROB.entry[rob_index].executed == 0) { // it could be already set to COMPLETED due to store-to-load forwarding
             ROB.entry[rob_index].executed  = INFLIGHT;
+            if (ROB.entry[rob_index].num_mem_ops == 0)
+                schedule_completion(rob_index, current_core_cycle[cpu]);
+        }
 
         DP (if (warmup_complete[cpu]) {
         cout << "[ROB] " << __func__ << " instr_id: " << ROB.entry[rob_index].instr_id << " rob_index: " << rob_index;
@@ -1198,15 +1264,43 @@ uint32_t O3_CPU::check_and_add_lsq(uint32_t rob_index)
     return not_available;
 }
 
+// same checks as check_and_add_lsq() without adding anything
+uint8_t O3_CPU::lsq_available(uint32_t rob_index)
+{
+    uint32_t num_mem_ops = 0, num_added = 0;
+
+    for (uint32_t i=0; i<NUM_INSTR_SOURCES; i++) {
+        if (ROB.entry[rob_index].source_memory[i]) {
+            num_mem_ops++;
+            if (ROB.entry[rob_index].source_added[i])
+                num_added++;
+            else if (LQ.occupancy < LQ.SIZE)
+                return 1;
+        }
+    }
+
+    for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
+        if (ROB.entry[rob_index].destination_memory[i]) {
+            num_mem_ops++;
+            if (ROB.entry[rob_index].destination_added[i])
+                num_added++;
+            else if ((SQ.occupancy < SQ.SIZE) && (STA[STA_head] == ROB.entry[rob_index].instr_id))
+                return 1;
+        }
+    }
+
+    // all operations are already in the LSQ, do_memory_scheduling() will mark it scheduled
+    return (num_added == num_mem_ops);
+}
+
 void O3_CPU::add_load_queue(uint32_t rob_index, uint32_t data_index)
 {
-    // search for an empty slot 
+    // take the lowest empty slot
     uint32_t lq_index = LQ.SIZE;
-    for (uint32_t i=0; i<LQ.SIZE; i++) {
-        if (LQ.entry[i].virtual_address == 0) {
-            lq_index = i;
-            break;
-        }
+    if (!LQ_free.empty()) {
+        pop_heap(LQ_free.begin(), LQ_free.end(), greater<uint32_t>());
+        lq_index = LQ_free.back();
+        LQ_free.pop_back();
     }
 
     // sanity check
@@ -1227,81 +1321,69 @@ void O3_CPU::add_load_queue(uint32_t rob_index, uint32_t data_index)
     LQ.entry[lq_index].event_cycle = current_core_cycle[cpu] + SCHEDULING_LATENCY;
     LQ.occupancy++;
 
-    // check RAW dependency
-    int prior = rob_index - 1;
-    if (prior < 0)
-        prior = ROB.SIZE - 1;
-
-    if (rob_index != ROB.head) {
-        if ((int)ROB.head <= prior) {
-            for (int i=prior; i>=(int)ROB.head; i--) {
-                if (LQ.entry[lq_index].producer_id != UINT64_MAX)
-                    break;
-
-                    mem_RAW_dependency(i, rob_index, data_index, lq_index);
-            }
+    // check RAW dependency: the producer is the youngest older store to the address in the ROB, found by
+    // following the stores to the address from the last one back until one is older than this load or has
+    // retired, instead of searching the ROB; the younger stores passed on the way may already be in the SQ
+    uint64_t address = LQ.entry[lq_index].virtual_address, war_store_id = UINT64_MAX;
+    REG_PRODUCER producer;
+    unordered_map<uint64_t, REG_PRODUCER>::iterator last_store = store_table.find(address);
+    if (last_store != store_table.end())
+        producer = last_store->second;
+    while ((producer.rob_index < ROB.SIZE) && (ROB.entry[producer.rob_index].instr_id == producer.instr_id)
+           && ROB.entry[producer.rob_index].ip) {
+        ooo_model_instr *store = &ROB.entry[producer.rob_index];
+        if (producer.instr_id < LQ.entry[lq_index].instr_id) {
+            mem_RAW_dependency(producer.rob_index, rob_index, data_index, lq_index);
+            break;
         }
-        else {
-            for (int i=prior; i>=0; i--) {
-                if (LQ.entry[lq_index].producer_id != UINT64_MAX)
-                    break;
 
-                    mem_RAW_dependency(i, rob_index, data_index, lq_index);
-            }
-            for (int i=ROB.SIZE-1; i>=(int)ROB.head; i--) { 
-                if (LQ.entry[lq_index].producer_id != UINT64_MAX)
-                    break;
-
-                    mem_RAW_dependency(i, rob_index, data_index, lq_index);
-            }
+        for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
+            if ((store->destination_memory[i] == address) && (store->sq_index[i] != UINT32_MAX))
+                war_store_id = producer.instr_id;
         }
+
+        uint32_t i = 0;
+        while (store->destination_memory[i] != address)
+            i++;
+        producer = store->prior_store[i];
     }
 
     // check
     // 1) if store-to-load forwarding is possible
     // 2) if there is WAR that are not correctly executed
     uint32_t forwarding_index = SQ.SIZE;
-    for (uint32_t i=0; i<SQ.SIZE; i++) {
-
-        // skip empty slot
-        if (SQ.entry[i].virtual_address == 0)
-            continue;
+    if (LQ.entry[lq_index].producer_id != UINT64_MAX) {
 
         // forwarding should be done by the SQ entry that holds the same producer_id from RAW dependency check
-        if (SQ.entry[i].virtual_address == LQ.entry[lq_index].virtual_address) { // store-to-load forwarding check
-
-            // forwarding store is in the SQ
-            if ((rob_index != ROB.head) && (LQ.entry[lq_index].producer_id == SQ.entry[i].instr_id)) { // RAW
-                forwarding_index = i;
-                break; // should be break
-            }
-
-            if ((LQ.entry[lq_index].producer_id == UINT64_MAX) && (LQ.entry[lq_index].instr_id <= SQ.entry[i].instr_id)) { // WAR 
-                // a load is about to be added in the load queue and we found a store that is 
-                // "logically later in the program order but already executed" => this is not correctly executed WAR
-                // due to out-of-order execution, this case is possible, for example
-                // 1) application is load intensive and load queue is full
-                // 2) we have loads that can't be added in the load queue
-                // 3) subsequent stores logically behind in the program order are added in the store queue first
-
-                // thanks to the store buffer, data is not written back to the memory system until retirement
-                // also due to in-order retirement, this "already executed store" cannot be retired until we finish the prior load instruction 
-                // if we detect WAR when a load is added in the load queue, just let the load instruction to access the memory system
-                // no need to mark any dependency because this is actually WAR not RAW
-
-                // do not forward data from the store queue since this is WAR
-                // just read correct data from data cache
-
-                LQ.entry[lq_index].physical_address = 0;
-                LQ.entry[lq_index].translated = 0;
-                LQ.entry[lq_index].fetched = 0;
-                
-                DP(if(warmup_complete[cpu]) {
-                cout << "[LQ] " << __func__ << " instr_id: " << LQ.entry[lq_index].instr_id << " reset fetched: " << +LQ.entry[lq_index].fetched;
-                cout << " to obey WAR store instr_id: " << SQ.entry[i].instr_id << " cycle: " << current_core_cycle[cpu] << endl; });
-            }
+        for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
+            if ((ROB.entry[producer.rob_index].destination_memory[i] == address) && (ROB.entry[producer.rob_index].sq_index[i] < forwarding_index))
+                forwarding_index = ROB.entry[producer.rob_index].sq_index[i];
         }
     }
+    else if (war_store_id != UINT64_MAX) {
+        // a load is about to be added in the load queue and we found a store that is 
+        // "logically later in the program order but already executed" => this is not correctly executed WAR
+        // due to out-of-order execution, this case is possible, for example
+        // 1) application is load intensive and load queue is full
+        // 2) we have loads that can't be added in the load queue
+        // 3) subsequent stores logically behind in the program order are added in the store queue first
+
+        // thanks to the store buffer, data is not written back to the memory system until retirement
+        // also due to in-order retirement, this "already executed store" cannot be retired until we finish the prior load instruction 
+        // if we detect WAR when a load is added in the load queue, just let the load instruction to access the memory system
+        // no need to mark any dependency because this is actually WAR not RAW
+
+        // do not forward data from the store queue since this is WAR
+        // just read correct data from data cache
+
+        LQ.entry[lq_index].physical_address = 0;
+        LQ.entry[lq_index].translated = 0;
+        LQ.entry[lq_index].fetched = 0;
+        
+        DP(if(warmup_complete[cpu]) {
+        cout << "[LQ] " << __func__ << " instr_id: " << LQ.entry[lq_index].instr_id << " reset fetched: " << +LQ.entry[lq_index].fetched;
+        cout << " to obey WAR store instr_id: " << war_store_id << " cycle: " << current_core_cycle[cpu] << endl; });
+    }
 
     if (forwarding_index != SQ.SIZE) { // we have a store-to-load forwarding
 
@@ -1317,8 +1399,10 @@ void O3_CPU::add_load_queue(uint32_t rob_index, uint32_t data_index)
                 cerr << "instr_id: " << ROB.entry[fwr_rob_index].instr_id << endl;
                 assert(0);
             }
-            if (ROB.entry[fwr_rob_index].num_mem_ops == 0)
+            if (ROB.entry[fwr_rob_index].num_mem_ops == 0) {
                 inflight_mem_executions++;
+                schedule_completion(fwr_rob_index, current_core_cycle[cpu]);
+            }
 
             DP(if(warmup_complete[cpu]) {
             cout << "[LQ] " << __func__ << " instr_id: " << LQ.entry[lq_index].instr_id << hex;
@@ -1360,7 +1444,7 @@ void O3_CPU::mem_RAW_dependency(uint32_t prior, uint32_t current, uint32_t data_
         if (ROB.entry[prior].destination_memory[i] == ROB.entry[current].source_memory[data_index]) { //  store-to-load forwarding check
 
             // we need to mark this dependency in the ROB since the producer might not be added in the store queue yet
-            ROB.entry[prior].memory_instrs_depend_on_me.insert (current);   // this load cannot be executed until the prior store gets executed
+            INSTR_COLD[ROB.entry.slot[prior]].memory_instrs_depend_on_me.insert (current);   // this load cannot be executed until the prior store gets executed
             ROB.entry[prior].is_producer = 1;
             LQ.entry[lq_index].producer_id = ROB.entry[prior].instr_id; 
             LQ.entry[lq_index].translated = INFLIGHT;
@@ -1619,8 +1703,10 @@ void O3_CPU::execute_store(uint32_t rob_index, uint32_t sq_index, uint32_t data_
         cerr << "instr_id: " << ROB.entry[rob_index].instr_id << endl;
         assert(0);
     }
-    if (ROB.entry[rob_index].num_mem_ops == 0)
+    if (ROB.entry[rob_index].num_mem_ops == 0) {
         inflight_mem_executions++;
+        schedule_completion(rob_index, current_core_cycle[cpu]);
+    }
 
     DP (if (warmup_complete[cpu]) {
     cout << "[SQ1] " << __func__ << " instr_id: " << SQ.entry[sq_index].instr_id << hex;
@@ -1630,7 +1716,7 @@ void O3_CPU::execute_store(uint32_t rob_index, uint32_t sq_index, uint32_t data_
     // resolve RAW dependency after DTLB access
     // check if this store has dependent loads
     if (ROB.entry[rob_index].is_producer) {
-	ITERATE_SET(dependent,ROB.entry[rob_index].memory_instrs_depend_on_me, ROB_SIZE) {
+	ITERATE_SET(dependent,INSTR_COLD[ROB.entry.slot[rob_index]].memory_instrs_depend_on_me, ROB_SIZE) {
             // check if dependent loads are already added in the load queue
             for (uint32_t j=0; j<NUM_INSTR_SOURCES; j++) { // which one is dependent?
                 if (ROB.entry[dependent].source_memory[j] && ROB.entry[dependent].source_added[j]) {
@@ -1662,8 +1748,10 @@ void O3_CPU::execute_store(uint32_t rob_index, uint32_t sq_index, uint32_t data_
                             assert(0);
                         }
 #endif
-                        if (ROB.entry[fwr_rob_index].num_mem_ops == 0)
+                        if (ROB.entry[fwr_rob_index].num_mem_ops == 0) {
                             inflight_mem_executions++;
+                            schedule_completion(fwr_rob_index, current_core_cycle[cpu]);
+                        }
 
                         DP(if(warmup_complete[cpu]) {
                         cout << "[LQ3] " << __func__ << " instr_id: " << LQ.entry[lq_index].instr_id << hex;
@@ -1674,7 +1762,7 @@ void O3_CPU::execute_store(uint32_t rob_index, uint32_t sq_index, uint32_t data_
 
                         // clear dependency bit
                         if (j == (NUM_INSTR_SOURCES-1))
-                            ROB.entry[rob_index].memory_instrs_depend_on_me.insert (dependent);
+                            INSTR_COLD[ROB.entry.slot[rob_index]].memory_instrs_depend_on_me.insert (dependent);
                     }
                 }
             }
@@ -1763,15 +1851,21 @@ void O3_CPU::reg_RAW_release(uint32_t rob_index)
 {
     // if (!ROB.entry[rob_index].registers_instrs_depend_on_me.empty()) 
 
-    ITERATE_SET(i,ROB.entry[rob_index].registers_instrs_depend_on_me, ROB_SIZE) {
+    ITERATE_SET(i,INSTR_COLD[ROB.entry.slot[rob_index]].registers_instrs_depend_on_me, ROB_SIZE) {
         for (uint32_t j=0; j<NUM_INSTR_SOURCES; j++) {
-            if (ROB.entry[rob_index].registers_index_depend_on_me[j].search (i)) {
+            if (INSTR_COLD[ROB.entry.slot[rob_index]].registers_index_depend_on_me[j].search (i)) {
                 ROB.entry[i].num_reg_dependent--;
 
                 if (ROB.entry[i].num_reg_dependent == 0) {
                     ROB.entry[i].reg_ready = 1;
-                    if (ROB.entry[i].is_memory)
+                    if (ROB.entry[i].is_memory) {
                         ROB.entry[i].scheduled = INFLIGHT;
+                        memory_ready.insert(make_pair(ROB.entry[i].instr_id, (uint32_t)i));
+                    }
+                    else if (knob_ready_list_scheduler) {
+                        ROB.entry[i].scheduled = COMPLETED;
+                        add_to_ready_list(i);
+                    }
                     else {
                         ROB.entry[i].scheduled = COMPLETED;
 
@@ -1801,6 +1895,46 @@ void O3_CPU::reg_RAW_release(uint32_t rob_index)
     }
 }
 
+void O3_CPU::add_to_ready_list(uint32_t rob_index)
+{
+    ready_list.push_back(make_pair(ROB.entry[rob_index].instr_id, rob_index));
+    push_heap(ready_list.begin(), ready_list.end(), greater<pair<uint64_t, uint32_t>>());
+
+    DP (if (warmup_complete[cpu]) {
+    cout << "[READY] " << __func__ << " instr_id: " << ROB.entry[rob_index].instr_id << " rob_index: " << rob_index;
+    cout << " ready: " << ready_list.size() << endl; });
+}
+
+// a scheduled instruction whose event_cycle was set past the current cycle stops the in-order scheduling scans
+void O3_CPU::add_schedule_blocker(uint32_t rob_index)
+{
+    if ((ROB.entry[rob_index].scheduled == 0) || (ROB.entry[rob_index].event_cycle <= current_core_cycle[cpu]))
+        return;
+
+    // schedule_instruction() does not scan with -ready_list_scheduler
+    if (knob_ready_list_scheduler && (ROB.entry[rob_index].is_memory == 0))
+        return;
+
+    schedule_blockers[ROB.entry[rob_index].is_memory].insert(make_pair(ROB.entry[rob_index].instr_id, rob_index));
+}
+
+// the instr_id of the oldest scheduled instruction whose event_cycle is still ahead, UINT64_MAX if there is none;
+// the ones in front of it that have retired or reached their event_cycle are dropped
+uint64_t O3_CPU::oldest_blocker(uint32_t is_memory)
+{
+    set<pair<uint64_t, uint32_t>> &blockers = schedule_blockers[is_memory];
+    while (!blockers.empty()) {
+        uint64_t instr_id = blockers.begin()->first;
+        uint32_t rob_index = blockers.begin()->second;
+        if ((ROB.entry[rob_index].instr_id == instr_id) && ROB.entry[rob_index].ip && (ROB.entry[rob_index].event_cycle > current_core_cycle[cpu]))
+            return instr_id;
+
+        blockers.erase(blockers.begin());
+    }
+
+    return UINT64_MAX;
+}
+
 void O3_CPU::operate_cache()
 {
     ITLB.operate();
@@ -1811,7 +1945,7 @@ void O3_CPU::operate_cache()
     L2C.operate();
 
     // also handle per-cycle prefetcher operation
-    l1i_prefetcher_cycle_operate();
+    l1i_prefetcher->cycle_operate();
 }
 
 void O3_CPU::update_rob()
@@ -1828,19 +1962,39 @@ void O3_CPU::update_rob()
     if (L1D.PROCESSED.occupancy && (L1D.PROCESSED.entry[L1D.PROCESSED.head].event_cycle <= current_core_cycle[cpu]))
         complete_data_fetch(&L1D.PROCESSED, 0);
 
-    // update ROB entries with completed executions
-    if ((inflight_reg_executions > 0) || (inflight_mem_executions > 0)) {
-        if (ROB.head < ROB.tail) {
-            for (uint32_t i=ROB.head; i<ROB.tail; i++) 
-                complete_execution(i);
-        }
-        else {
-            for (uint32_t i=ROB.head; i<ROB.SIZE; i++)
-                complete_execution(i);
-            for (uint32_t i=0; i<ROB.tail; i++)
-                complete_execution(i);
-        }
+    // update ROB entries with completed executions: only the instructions in the slots of the completion
+    // wheel up to this cycle are looked at, in ROB order; the current slot is looked at again by the next
+    // call, since update_rob() runs several times per cycle
+    uint64_t cycle = completion_wheel_cycle;
+    for (uint32_t i=0; (i<COMPLETION_WHEEL_SIZE) && (cycle+i <= current_core_cycle[cpu]); i++) {
+        vector<uint32_t> &slot = completion_wheel[(cycle+i) % COMPLETION_WHEEL_SIZE];
+        completing.insert(completing.end(), slot.begin(), slot.end());
+        slot.clear();
     }
+    completion_wheel_cycle = current_core_cycle[cpu];
+
+    if (completing.empty())
+        return;
+
+    uint32_t head = ROB.head, size = ROB.SIZE;
+    sort(completing.begin(), completing.end(), [head, size](uint32_t a, uint32_t b) {
+        return ((a + size - head) % size) < ((b + size - head) % size);
+    });
+    for (uint32_t i=0; i<completing.size(); i++) {
+        complete_execution(completing[i]);
+
+        // a memory instruction whose event_cycle is not reached yet, or lies beyond the wheel
+        if (ROB.entry[completing[i]].executed == INFLIGHT)
+            schedule_completion(completing[i], ROB.entry[completing[i]].event_cycle);
+    }
+    completing.clear();
+}
+
+void O3_CPU::schedule_completion(uint32_t rob_index, uint64_t cycle)
+{
+    if (cycle < completion_wheel_cycle)
+        cycle = completion_wheel_cycle;
+    completion_wheel[cycle % COMPLETION_WHEEL_SIZE].push_back(rob_index);
 }
 
 void O3_CPU::complete_instr_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb)
@@ -1858,7 +2012,7 @@ void O3_CPU::complete_instr_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb)
 	// mark the appropriate instructions in the IFETCH_BUFFER as translated and ready to fetch
 	for(uint32_t j=0; j<IFETCH_BUFFER.SIZE; j++)
 	  {
-	    if(((IFETCH_BUFFER.entry[j].ip)>>LOG2_PAGE_SIZE) == ((complete_ip)>>LOG2_PAGE_SIZE))
+	    if(IFETCH_BUFFER.entry[j].ip && (((IFETCH_BUFFER.entry[j].ip)>>LOG2_PAGE_SIZE) == ((complete_ip)>>LOG2_PAGE_SIZE)))
 	      {
 		IFETCH_BUFFER.entry[j].translated = COMPLETED;
 		// we did not fetch this instruction's cache line, but we did translated it
@@ -1877,7 +2031,7 @@ void O3_CPU::complete_instr_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb)
 	// this is the L1I cache, so instructions are now fully fetched, so mark them as such
 	for(uint32_t j=0; j<IFETCH_BUFFER.SIZE; j++)
 	  {
-	    if(((IFETCH_BUFFER.entry[j].ip)>>6) == ((complete_ip)>>6))
+	    if(IFETCH_BUFFER.entry[j].ip && (((IFETCH_BUFFER.entry[j].ip)>>6) == ((complete_ip)>>6)))
 	      {
 		IFETCH_BUFFER.entry[j].translated = COMPLETED;
 		IFETCH_BUFFER.entry[j].fetched = COMPLETED;
@@ -1997,6 +2151,7 @@ void O3_CPU::complete_data_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb)
         }
 
         ROB.entry[rob_index].event_cycle = queue->entry[index].event_cycle;
+        add_schedule_blocker(rob_index);
     }
     else { // L1D
 
@@ -2011,6 +2166,7 @@ void O3_CPU::complete_data_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb)
             LQ.entry[lq_index].event_cycle = current_core_cycle[cpu];
             ROB.entry[rob_index].num_mem_ops--;
             ROB.entry[rob_index].event_cycle = queue->entry[index].event_cycle;
+            add_schedule_blocker(rob_index);
 
 #ifdef SANITY_CHECK
             if (ROB.entry[rob_index].num_mem_ops < 0) {
@@ -2018,8 +2174,10 @@ void O3_CPU::complete_data_fetch(PACKET_QUEUE *queue, uint8_t is_it_tlb)
                 assert(0);
             }
 #endif
-            if (ROB.entry[rob_index].num_mem_ops == 0)
+            if (ROB.entry[rob_index].num_mem_ops == 0) {
                 inflight_mem_executions++;
+                schedule_completion(rob_index, current_core_cycle[cpu]);
+            }
 
             DP (if (warmup_complete[cpu]) {
             cout << "[ROB] " << __func__ << " load instr_id: " << LQ.entry[lq_index].instr_id;
@@ -2089,6 +2247,7 @@ void O3_CPU::handle_o3_fetch(PACKET *current_packet, uint32_t cache_type)
         }
 
         ROB.entry[rob_index].event_cycle = current_packet->event_cycle;
+        add_schedule_blocker(rob_index);
     }
     else { // L1D
 
@@ -2111,8 +2270,10 @@ void O3_CPU::handle_o3_fetch(PACKET *current_packet, uint32_t cache_type)
                 assert(0);
             }
 #endif
-            if (ROB.entry[rob_index].num_mem_ops == 0)
+            if (ROB.entry[rob_index].num_mem_ops == 0) {
                 inflight_mem_executions++;
+                schedule_completion(rob_index, current_core_cycle[cpu]);
+            }
 
             DP (if (warmup_complete[cpu]) {
             cout << "[ROB] " << __func__ << " load instr_id: " << LQ.entry[lq_index].instr_id;
@@ -2125,6 +2286,7 @@ void O3_CPU::handle_o3_fetch(PACKET *current_packet, uint32_t cache_type)
             handle_merged_load(current_packet);
 
             ROB.entry[rob_index].event_cycle = current_packet->event_cycle;
+            add_schedule_blocker(rob_index);
         }
     }
 }
@@ -2188,8 +2350,10 @@ void O3_CPU::handle_merged_load(PACKET *provider)
         }
 #endif
 
-        if (ROB.entry[merged_rob_index].num_mem_ops == 0)
+        if (ROB.entry[merged_rob_index].num_mem_ops == 0) {
             inflight_mem_executions++;
+            schedule_completion(merged_rob_index, current_core_cycle[cpu]);
+        }
 
         DP (if (warmup_complete[cpu]) {
         cout << "[ROB] " << __func__ << " load instr_id: " << LQ.entry[merged].instr_id;
@@ -2211,6 +2375,9 @@ void O3_CPU::release_load_queue(uint32_t lq_index)
     LSQ_ENTRY empty_entry;
     LQ.entry[lq_index] = empty_entry;
     LQ.occupancy--;
+
+    LQ_free.push_back(lq_index);
+    push_heap(LQ_free.begin(), LQ_free.end(), greater<uint32_t>());
 }
 
 void O3_CPU::retire_rob()
@@ -2226,6 +2393,23 @@ void O3_CPU::retire_rob()
             return;
         }
 
+        // a synchronization marker waits for the markers of the other threads that come before it
+        if (ROB.entry[ROB.head].sync_sequence) {
+            if (!sync_marker_ready(ROB.entry[ROB.head].sync_sequence)) {
+                if (sync_wait_begin == UINT64_MAX)
+                    sync_wait_begin = current_core_cycle[cpu];
+                sync_wait_cycle = current_core_cycle[cpu];
+
+                // the markers in front of it may never come, e.g., from a thread that ended early, so they are given up
+                // rather than stopping this core for good
+                if ((sync_wait_begin + DEADLOCK_CYCLE) > current_core_cycle[cpu])
+                    return;
+                sync_marker_timeout(cpu, ROB.entry[ROB.head].sync_sequence);
+            }
+            sync_wait_begin = UINT64_MAX;
+            sync_marker_retired(ROB.entry[ROB.head].sync_sequence);
+        }
+
         // check store instruction
         uint32_t num_store = 0;
         for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
@@ -2293,12 +2477,23 @@ void O3_CPU::retire_rob()
             }
         }
 
+        // forget the addresses this was the last store to
+        for (uint32_t i=0; i<MAX_INSTR_DESTINATIONS; i++) {
+            if (ROB.entry[ROB.head].destination_memory[i] == 0)
+                continue;
+
+            unordered_map<uint64_t, REG_PRODUCER>::iterator last_store = store_table.find(ROB.entry[ROB.head].destination_memory[i]);
+            if ((last_store != store_table.end()) && (last_store->second.instr_id == ROB.entry[ROB.head].instr_id) && (last_store->second.rob_index == ROB.head))
+                store_table.erase(last_store);
+        }
+
         // release ROB entry
         DP ( if (warmup_complete[cpu]) {
         cout << "[ROB] " << __func__ << " instr_id: " << ROB.entry[ROB.head].instr_id << " is retired" << endl; });
 
-        ooo_model_instr empty_entry;
-        ROB.entry[ROB.head] = empty_entry;
+        // the slot is cleared when the next instruction is read into it
+        INSTR_POOL_free.push_back(ROB.entry.slot[ROB.head]);
+        ROB.entry.slot[ROB.head] = 0;
 	
         ROB.head++;
         if (ROB.head == ROB.SIZE)
@@ -2308,3 +2503,164 @@ void O3_CPU::retire_rob()
         num_retired++;
     }
 }
+
+// earliest cycle at which this core or its private caches can change state
+// returns a cycle no later than the next one if anything may happen right away
+uint64_t O3_CPU::next_event_cycle()
+{
+    uint64_t current = current_core_cycle[cpu], next = UINT64_MAX;
+
+    // page fault: nothing is operated until the stall is over
+    if (stall_cycle[cpu] > (current + 1))
+        return stall_cycle[cpu];
+
+    // read from trace
+    if ((IFETCH_BUFFER.occupancy < IFETCH_BUFFER.SIZE) && (fetch_stall == 0))
+        return current;
+
+    // fetch
+    if (fetch_stall && fetch_resume_cycle)
+        next = fetch_resume_cycle;
+
+    uint32_t index = IFETCH_BUFFER.head;
+    for (uint32_t i=0; i<IFETCH_BUFFER.SIZE; i++) {
+        if (IFETCH_BUFFER.entry[index].ip == 0)
+            break;
+
+        if ((IFETCH_BUFFER.entry[index].translated == 0) || ((IFETCH_BUFFER.entry[index].translated == COMPLETED) && (IFETCH_BUFFER.entry[index].fetched == 0)))
+            return current;
+
+        index++;
+        if (index == IFETCH_BUFFER.SIZE)
+            index = 0;
+        if (index == IFETCH_BUFFER.head)
+            break;
+    }
+
+    if (IFETCH_BUFFER.entry[IFETCH_BUFFER.head].ip && (IFETCH_BUFFER.entry[IFETCH_BUFFER.head].translated == COMPLETED) && (IFETCH_BUFFER.entry[IFETCH_BUFFER.head].fetched == COMPLETED) 
+        && (DECODE_BUFFER.occupancy < DECODE_BUFFER.SIZE))
+        return current;
+
+    // decode and dispatch
+    if (DECODE_BUFFER.occupancy && DECODE_BUFFER.entry[DECODE_BUFFER.head].ip) {
+        if (ROB.occupancy < ROB.SIZE) {
+            if ((warmup_complete[cpu] == 0) || (DECODE_BUFFER.entry[DECODE_BUFFER.head].event_cycle == 0))
+                return current;
+            if ((DECODE_BUFFER.entry[DECODE_BUFFER.head].event_cycle + 1) < next)
+                next = DECODE_BUFFER.entry[DECODE_BUFFER.head].event_cycle + 1;
+        }
+
+        // decode latency is applied to the first DECODE_WIDTH+1 entries
+        index = DECODE_BUFFER.head;
+        for (uint32_t i=0; i<=DECODE_WIDTH; i++) {
+            if (DECODE_BUFFER.entry[index].ip && (DECODE_BUFFER.entry[index].event_cycle == 0))
+                return current;
+            if (index == DECODE_BUFFER.tail)
+                break;
+            index++;
+            if (index == DECODE_BUFFER.SIZE)
+                index = 0;
+        }
+    }
+
+    // retire
+    if ((ROB.entry[ROB.head].executed == COMPLETED) && (ROB.entry[ROB.head].event_cycle < next))
+        next = ROB.entry[ROB.head].event_cycle;
+
+    // completed fetches and translations
+    if (ITLB.PROCESSED.occupancy && (ITLB.PROCESSED.entry[ITLB.PROCESSED.head].event_cycle < next))
+        next = ITLB.PROCESSED.entry[ITLB.PROCESSED.head].event_cycle;
+    if (L1I.PROCESSED.occupancy && (L1I.PROCESSED.entry[L1I.PROCESSED.head].event_cycle < next))
+        next = L1I.PROCESSED.entry[L1I.PROCESSED.head].event_cycle;
+    if (DTLB.PROCESSED.occupancy && (DTLB.PROCESSED.entry[DTLB.PROCESSED.head].event_cycle < next))
+        next = DTLB.PROCESSED.entry[DTLB.PROCESSED.head].event_cycle;
+    if (L1D.PROCESSED.occupancy && (L1D.PROCESSED.entry[L1D.PROCESSED.head].event_cycle < next))
+        next = L1D.PROCESSED.entry[L1D.PROCESSED.head].event_cycle;
+
+    // execute
+    if ((RTE0[RTE0_head] < ROB_SIZE) && (ROB.entry[RTE0[RTE0_head]].event_cycle < next))
+        next = ROB.entry[RTE0[RTE0_head]].event_cycle;
+    if ((RTE1[RTE1_head] < ROB_SIZE) && (ROB.entry[RTE1[RTE1_head]].event_cycle < next))
+        next = ROB.entry[RTE1[RTE1_head]].event_cycle;
+    for (uint32_t i=0; i<ready_list.size(); i++) {
+        if (ROB.entry[ready_list[i].second].event_cycle < next)
+            next = ROB.entry[ready_list[i].second].event_cycle;
+    }
+
+    // load/store queue
+    if ((RTS0[RTS0_head] < SQ_SIZE) && (SQ.entry[RTS0[RTS0_head]].event_cycle < next))
+        next = SQ.entry[RTS0[RTS0_head]].event_cycle;
+    if ((RTS1[RTS1_head] < SQ_SIZE) && (SQ.entry[RTS1[RTS1_head]].event_cycle < next))
+        next = SQ.entry[RTS1[RTS1_head]].event_cycle;
+    if ((RTL0[RTL0_head] < LQ_SIZE) && (LQ.entry[RTL0[RTL0_head]].event_cycle < next))
+        next = LQ.entry[RTL0[RTL0_head]].event_cycle;
+    if ((RTL1[RTL1_head] < LQ_SIZE) && (LQ.entry[RTL1[RTL1_head]].event_cycle < next))
+        next = LQ.entry[RTL1[RTL1_head]].event_cycle;
+
+    // private caches
+    CACHE *cache[6] = {&ITLB, &DTLB, &STLB, &L1I, &L1D, &L2C};
+    for (uint32_t i=0; i<6; i++) {
+        uint64_t cache_cycle = cache[i]->next_event_cycle();
+        if (cache_cycle < next)
+            next = cache_cycle;
+    }
+
+    // the ROB scans below are only needed if nothing else happens first
+    if (next <= (current + 1))
+        return next;
+
+    // schedule: the in-order scan must reach the first unscheduled entry, or with -ready_list_scheduler,
+    // the scheduler must have room for it
+    uint32_t schedule_index = ROB.next_schedule;
+    if (knob_ready_list_scheduler) {
+        if (ROB.entry[schedule_index].ip && (ROB.entry[schedule_index].scheduled == 0) && (ROB.entry[schedule_index].fetched == COMPLETED)
+            && (scheduler_occupancy < SCHEDULER_SIZE) && (ROB.entry[schedule_index].event_cycle < next))
+            next = ROB.entry[schedule_index].event_cycle;
+    }
+    else if (ROB.entry[schedule_index].scheduled == 0) {
+        uint32_t limit = ROB.next_fetch[1],
+                 count = (ROB.head < limit) ? (limit - ROB.head) : (ROB.SIZE - ROB.head + limit);
+        uint64_t ready_cycle = ROB.entry[schedule_index].event_cycle;
+        for (uint32_t i=0; (i<count) && (i<SCHEDULER_SIZE); i++) {
+            index = (ROB.head + i) % ROB.SIZE;
+            if (ROB.entry[index].fetched != COMPLETED)
+                break;
+            if (ROB.entry[index].event_cycle > ready_cycle)
+                ready_cycle = ROB.entry[index].event_cycle;
+            if (ROB.entry[index].scheduled == 0) {
+                if (ready_cycle < next)
+                    next = ready_cycle;
+                break;
+            }
+        }
+    }
+
+    // complete execution: the executing instructions are in the completion wheel
+    if ((inflight_reg_executions > 0) || (inflight_mem_executions > 0)) {
+        for (uint32_t n=0; n<COMPLETION_WHEEL_SIZE; n++) {
+            for (uint32_t i=0; i<completion_wheel[n].size(); i++) {
+                index = completion_wheel[n][i];
+                if ((ROB.entry[index].executed == INFLIGHT) && ((ROB.entry[index].is_memory == 0) || (ROB.entry[index].num_mem_ops == 0))
+                    && (ROB.entry[index].event_cycle < next)) {
+                    next = ROB.entry[index].event_cycle;
+                    if (next <= (current + 1))
+                        return next;
+                }
+            }
+        }
+    }
+
+    // schedule memory: the scan cannot pass the oldest memory instruction whose event_cycle is still ahead
+    // before that cycle
+    uint64_t blocker = oldest_blocker(1);
+    for (set<pair<uint64_t, uint32_t>>::iterator ready = memory_ready.begin(); ready != memory_ready.end(); ready++) {
+        if (lsq_available(ready->second)) {
+            uint64_t ready_cycle = (ready->first < blocker) ? current : ROB.entry[schedule_blockers[1].begin()->second].event_cycle;
+            if (ready_cycle < next)
+                next = ready_cycle;
+            break;
+        }
+    }
+
+    return next;
+}
@@ -0,0 +1,135 @@
+#include "parallel.h"
+
+uint32_t knob_threads = 1,
+         knob_quantum = 1;
+
+// serializes va_to_pa() when cores run on different host threads
+mutex page_table_mutex;
+
+LLC_PORT *llc_port;
+
+int LLC_PORT::push(PACKET *packet, uint8_t queue_type)
+{
+    LLC_REQUEST request;
+    request.packet = *packet;
+    request.queue_type = queue_type;
+    request.issue_cycle = current_core_cycle[cpu];
+
+    // the port is sized so that L2C occupancy checks keep it from overflowing
+    if (queue.push(request) == false) {
+        cerr << "[LLC_PORT_ERROR] " << __func__ << " cpu: " << cpu << " port is full";
+        cerr << " address: " << hex << packet->address << dec << " type: " << +queue_type << endl;
+        assert(0);
+    }
+    pending[queue_type]++;
+
+    return -1;
+}
+
+int LLC_PORT::add_rq(PACKET *packet)
+{
+    return push(packet, 1);
+}
+
+int LLC_PORT::add_wq(PACKET *packet)
+{
+    return push(packet, 2);
+}
+
+int LLC_PORT::add_pq(PACKET *packet)
+{
+    return push(packet, 3);
+}
+
+void LLC_PORT::return_data(PACKET *packet)
+{
+    // the LLC fills the L2C directly while the workers are parked
+    cerr << "[LLC_PORT_ERROR] " << __func__ << " cpu: " << cpu << " unexpected fill" << endl;
+    assert(0);
+}
+
+void LLC_PORT::operate()
+{
+
+}
+
+void LLC_PORT::increment_WQ_FULL(uint64_t address)
+{
+    WQ_FULL++;
+}
+
+void LLC_PORT::functional_access(PACKET *packet)
+{
+    llc->functional_access(packet);
+}
+
+uint32_t LLC_PORT::get_occupancy(uint8_t queue_type, uint64_t address)
+{
+    // the LLC is not operated during the core phase, so its occupancy is stable here
+    uint32_t occupancy = llc->get_occupancy(queue_type, address) + pending[queue_type],
+             size = llc->get_size(queue_type, address);
+
+    return (occupancy > size) ? size : occupancy;
+}
+
+uint32_t LLC_PORT::get_size(uint8_t queue_type, uint64_t address)
+{
+    return llc->get_size(queue_type, address);
+}
+
+void LLC_PORT::drain(uint64_t cycle)
+{
+    llc->WQ.FULL += WQ_FULL;
+    WQ_FULL = 0;
+
+    // requests enter the LLC in the order and at the cycle they were issued
+    LLC_REQUEST *request;
+    while ((request = queue.front()) != NULL) {
+        if (request->issue_cycle > cycle)
+            break;
+
+        PACKET *packet = &request->packet;
+        if (request->queue_type == 1) {
+            if (llc->add_rq(packet) == -2) // LLC RQ is full, retry next cycle
+                break;
+        }
+        else if (request->queue_type == 2) {
+            if (llc->get_occupancy(2, packet->address) == llc->get_size(2, packet->address))
+                break;
+            llc->add_wq(packet);
+        }
+        else {
+            if (llc->add_pq(packet) == -2)
+                break;
+        }
+
+        pending[request->queue_type]--;
+        queue.pop();
+    }
+}
+
+void QUANTUM_BARRIER::release()
+{
+    arrived.store(0, memory_order_relaxed);
+    generation.fetch_add(1, memory_order_release);
+}
+
+void QUANTUM_BARRIER::arrive()
+{
+    arrived.fetch_add(1, memory_order_release);
+}
+
+void QUANTUM_BARRIER::wait_workers(uint32_t num_workers)
+{
+    while (arrived.load(memory_order_acquire) < num_workers)
+        this_thread::yield();
+}
+
+uint64_t QUANTUM_BARRIER::wait_release(uint64_t last_generation)
+{
+    uint64_t current;
+    while ((current = generation.load(memory_order_acquire)) == last_generation)
+        this_thread::yield();
+
+    return current;
+}
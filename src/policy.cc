@@ -0,0 +1,137 @@
+#include <sstream>
+
+#include "ooo_cpu.h"
+#include "uncore.h"
+#include "checkpoint.h"
+
+string knob_branch_predictor = "bimodal",
+       knob_l1i_prefetcher = "no",
+       knob_l1d_prefetcher = "no",
+       knob_l2c_prefetcher = "no",
+       knob_llc_prefetcher = "no",
+       knob_llc_replacement = "lru";
+
+void BRANCH_PREDICTOR::checkpoint()
+{
+    checkpoint_section(name, 0);
+}
+
+void L1I_PREFETCHER::checkpoint()
+{
+    checkpoint_section(name, 0);
+}
+
+void CACHE_PREFETCHER::checkpoint()
+{
+    checkpoint_section(name, 0);
+}
+
+void LLC_REPLACEMENT::checkpoint()
+{
+    checkpoint_section(name, 0);
+}
+
+string core_policy(const string &names, uint32_t cpu, const char *kind)
+{
+    vector<string> per_core;
+    string name;
+    istringstream list(names);
+    while (getline(list, name, ','))
+        per_core.push_back(name);
+
+    if (per_core.size() == 1)
+        return per_core[0];
+    if (per_core.size() != NUM_CPUS) {
+        cerr << "*** " << kind << " NEEDS ONE NAME OR " << NUM_CPUS << " COMMA-SEPARATED NAMES: " << names << " ***" << endl;
+        assert(0);
+    }
+
+    return per_core[cpu];
+}
+
+void create_policies()
+{
+    // a lockstep system replaces the policies it inherited from the reader
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        delete ooo_cpu[i].branch_predictor;
+        delete ooo_cpu[i].l1i_prefetcher;
+        delete ooo_cpu[i].L1D.prefetcher;
+        delete ooo_cpu[i].L2C.prefetcher;
+    }
+    delete uncore->LLC.prefetcher;
+    delete uncore->LLC.replacement;
+
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        ooo_cpu[i].branch_predictor = POLICY_REGISTRY<BRANCH_PREDICTOR>::create(core_policy(knob_branch_predictor, i, "BRANCH PREDICTOR"), "BRANCH PREDICTOR");
+        ooo_cpu[i].branch_predictor->core = &ooo_cpu[i];
+
+        ooo_cpu[i].l1i_prefetcher = POLICY_REGISTRY<L1I_PREFETCHER>::create(core_policy(knob_l1i_prefetcher, i, "L1I PREFETCHER"), "L1I PREFETCHER");
+        ooo_cpu[i].l1i_prefetcher->core = &ooo_cpu[i];
+
+        ooo_cpu[i].L1D.prefetcher = POLICY_REGISTRY<L1D_PREFETCHER>::create(core_policy(knob_l1d_prefetcher, i, "L1D PREFETCHER"), "L1D PREFETCHER");
+        ooo_cpu[i].L1D.prefetcher->cache = &ooo_cpu[i].L1D;
+
+        ooo_cpu[i].L2C.prefetcher = POLICY_REGISTRY<L2C_PREFETCHER>::create(core_policy(knob_l2c_prefetcher, i, "L2C PREFETCHER"), "L2C PREFETCHER");
+        ooo_cpu[i].L2C.prefetcher->cache = &ooo_cpu[i].L2C;
+
+        cout << "CPU " << i << " branch predictor: " << ooo_cpu[i].branch_predictor->name << " L1I prefetcher: " << ooo_cpu[i].l1i_prefetcher->name;
+        cout << " L1D prefetcher: " << ooo_cpu[i].L1D.prefetcher->name << " L2C prefetcher: " << ooo_cpu[i].L2C.prefetcher->name << endl;
+    }
+
+    uncore->LLC.prefetcher = POLICY_REGISTRY<LLC_PREFETCHER>::create(knob_llc_prefetcher, "LLC PREFETCHER");
+    uncore->LLC.prefetcher->cache = &uncore->LLC;
+
+    uncore->LLC.replacement = POLICY_REGISTRY<LLC_REPLACEMENT>::create(knob_llc_replacement, "LLC REPLACEMENT");
+    uncore->LLC.replacement->cache = &uncore->LLC;
+
+    cout << "LLC prefetcher: " << uncore->LLC.prefetcher->name << " LLC replacement: " << uncore->LLC.replacement->name << endl;
+}
+
+// a sweep point replaces only the policies it changes; the new ones start from their initial state,
+// like a structure whose checkpoint section was saved by a different policy
+template <class POLICY, class BASE>
+uint8_t replace_policy(BASE *&policy, const string &name, const char *kind)
+{
+    if (name == policy->name)
+        return 0;
+
+    cout << kind << " " << policy->name << " is replaced by " << name << " and starts from its initial state" << endl;
+    delete policy;
+    policy = POLICY_REGISTRY<POLICY>::create(name, kind);
+    return 1;
+}
+
+void replace_policies()
+{
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        if (replace_policy<BRANCH_PREDICTOR>(ooo_cpu[i].branch_predictor, core_policy(knob_branch_predictor, i, "BRANCH PREDICTOR"), "BRANCH PREDICTOR")) {
+            ooo_cpu[i].branch_predictor->core = &ooo_cpu[i];
+            ooo_cpu[i].branch_predictor->initialize();
+        }
+
+        if (replace_policy<L1I_PREFETCHER>(ooo_cpu[i].l1i_prefetcher, core_policy(knob_l1i_prefetcher, i, "L1I PREFETCHER"), "L1I PREFETCHER")) {
+            ooo_cpu[i].l1i_prefetcher->core = &ooo_cpu[i];
+            ooo_cpu[i].l1i_prefetcher->initialize();
+        }
+
+        if (replace_policy<L1D_PREFETCHER>(ooo_cpu[i].L1D.prefetcher, core_policy(knob_l1d_prefetcher, i, "L1D PREFETCHER"), "L1D PREFETCHER")) {
+            ooo_cpu[i].L1D.prefetcher->cache = &ooo_cpu[i].L1D;
+            ooo_cpu[i].L1D.prefetcher->initialize();
+        }
+
+        if (replace_policy<L2C_PREFETCHER>(ooo_cpu[i].L2C.prefetcher, core_policy(knob_l2c_prefetcher, i, "L2C PREFETCHER"), "L2C PREFETCHER")) {
+            ooo_cpu[i].L2C.prefetcher->cache = &ooo_cpu[i].L2C;
+            ooo_cpu[i].L2C.prefetcher->initialize();
+        }
+    }
+
+    if (replace_policy<LLC_PREFETCHER>(uncore->LLC.prefetcher, knob_llc_prefetcher, "LLC PREFETCHER")) {
+        uncore->LLC.prefetcher->cache = &uncore->LLC;
+        uncore->LLC.prefetcher->initialize();
+    }
+
+    if (replace_policy<LLC_REPLACEMENT>(uncore->LLC.replacement, knob_llc_replacement, "LLC REPLACEMENT")) {
+        uncore->LLC.replacement->cache = &uncore->LLC;
+        uncore->LLC.replacement->initialize();
+    }
+}
@@ -0,0 +1,276 @@
+#include <cmath>
+
+#include "sampling.h"
+#include "ooo_cpu.h"
+#include "uncore.h"
+
+#define SAMPLING_CONFIDENCE 1.96 // z-score of a 95% confidence interval
+#define SAMPLING_TARGET_ERROR 0.03
+
+uint64_t knob_sampling_period = 0,
+         knob_sampling_unit = 1000,
+         knob_sampling_warming = 2000;
+
+uint8_t sampling_drain = 0;
+
+SAMPLING_STATS sampling_stats[NUM_CPUS];
+
+CACHE *sampled_cache(uint32_t cpu, uint32_t n)
+{
+    CACHE *cache[NUM_SAMPLED_CACHES] = {&ooo_cpu[cpu].L1D, &ooo_cpu[cpu].L1I, &ooo_cpu[cpu].L2C, &uncore->LLC};
+    return cache[n];
+}
+
+void begin_sampling_unit(SAMPLING_STATS *stats, uint32_t i)
+{
+    stats->measuring = 1;
+    stats->begin_instr = ooo_cpu[i].num_retired;
+    stats->begin_cycle = current_core_cycle[i];
+    for (uint32_t n=0; n<NUM_SAMPLED_CACHES; n++) {
+        CACHE *cache = sampled_cache(i, n);
+        for (uint32_t j=0; j<NUM_TYPES; j++) {
+            stats->begin_access[n][j] = cache->sim_access[i][j];
+            stats->begin_hit[n][j] = cache->sim_hit[i][j];
+            stats->begin_miss[n][j] = cache->sim_miss[i][j];
+        }
+    }
+
+    stats->begin_branch = ooo_cpu[i].num_branch;
+    stats->begin_mispredictions = ooo_cpu[i].branch_mispredictions;
+    stats->begin_rob_occupancy = ooo_cpu[i].total_rob_occupancy_at_branch_mispredict;
+    for (uint32_t j=0; j<8; j++)
+        stats->begin_branch_types[j] = ooo_cpu[i].total_branch_types[j];
+}
+
+void end_sampling_unit(SAMPLING_STATS *stats, uint32_t i)
+{
+    uint64_t unit_instr = ooo_cpu[i].num_retired - stats->begin_instr,
+             unit_cycle = current_core_cycle[i] - stats->begin_cycle;
+
+    stats->measuring = 0;
+    stats->num_unit++;
+    stats->total_instr += unit_instr;
+    stats->total_cycle += unit_cycle;
+
+    double cpi = (1.0*unit_cycle) / unit_instr;
+    stats->cpi_sum += cpi;
+    stats->cpi_square_sum += cpi * cpi;
+
+    for (uint32_t n=0; n<NUM_SAMPLED_CACHES; n++) {
+        CACHE *cache = sampled_cache(i, n);
+        uint64_t unit_miss = 0;
+        for (uint32_t j=0; j<NUM_TYPES; j++) {
+            stats->total_access[n][j] += cache->sim_access[i][j] - stats->begin_access[n][j];
+            stats->total_hit[n][j] += cache->sim_hit[i][j] - stats->begin_hit[n][j];
+            stats->total_miss[n][j] += cache->sim_miss[i][j] - stats->begin_miss[n][j];
+            unit_miss += cache->sim_miss[i][j] - stats->begin_miss[n][j];
+        }
+
+        double mpki = (1000.0*unit_miss) / unit_instr;
+        stats->mpki_sum[n] += mpki;
+        stats->mpki_square_sum[n] += mpki * mpki;
+    }
+
+    stats->total_branch += ooo_cpu[i].num_branch - stats->begin_branch;
+    stats->total_mispredictions += ooo_cpu[i].branch_mispredictions - stats->begin_mispredictions;
+    stats->total_rob_occupancy += ooo_cpu[i].total_rob_occupancy_at_branch_mispredict - stats->begin_rob_occupancy;
+    for (uint32_t j=0; j<8; j++)
+        stats->total_branch_types[j] += ooo_cpu[i].total_branch_types[j] - stats->begin_branch_types[j];
+}
+
+// half-width of the confidence interval of the mean of num_unit samples
+double sampling_error(uint64_t num_unit, double sum, double square_sum)
+{
+    if (num_unit < 2)
+        return 0;
+
+    double mean = sum / num_unit,
+           variance = (square_sum - (num_unit * mean * mean)) / (num_unit - 1);
+    if (variance < 0)
+        variance = 0;
+
+    return SAMPLING_CONFIDENCE * sqrt(variance / num_unit);
+}
+
+uint8_t cache_drained(CACHE *cache)
+{
+    return (cache->RQ.occupancy == 0) && (cache->WQ.occupancy == 0) && (cache->PQ.occupancy == 0) 
+           && (cache->MSHR.occupancy == 0) && (cache->PROCESSED.occupancy == 0);
+}
+
+// nothing in flight that could fill a cache behind the functional warming
+uint8_t sampling_drained()
+{
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        if (ooo_cpu[i].IFETCH_BUFFER.occupancy || ooo_cpu[i].DECODE_BUFFER.occupancy || ooo_cpu[i].ROB.occupancy 
+            || ooo_cpu[i].LQ.occupancy || ooo_cpu[i].SQ.occupancy)
+            return 0;
+
+        if (!cache_drained(&ooo_cpu[i].ITLB) || !cache_drained(&ooo_cpu[i].DTLB) || !cache_drained(&ooo_cpu[i].STLB)
+            || !cache_drained(&ooo_cpu[i].L1I) || !cache_drained(&ooo_cpu[i].L1D) || !cache_drained(&ooo_cpu[i].L2C))
+            return 0;
+    }
+
+    if (!cache_drained(&uncore->LLC))
+        return 0;
+
+    // DRAM writes do not return anything, so only the reads have to finish
+    for (uint32_t i=0; i<DRAM_CHANNELS; i++) {
+        if (uncore->DRAM.RQ[i].occupancy)
+            return 0;
+    }
+
+    return 1;
+}
+
+// one cycle of the serial loop
+void operate_sampled_cycle()
+{
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        operate_cpu(i);
+
+        // check for deadlock
+        if (deadlocked(i))
+            print_deadlock(i);
+    }
+
+    uncore->DRAM.operate();
+    uncore->LLC.operate();
+
+    if (knob_cycle_skip)
+        skip_idle_cycles();
+}
+
+// the region of interest is made of the measured units
+void finish_sampled_simulation(uint32_t i)
+{
+    SAMPLING_STATS *stats = &sampling_stats[i];
+
+    simulation_complete[i] = 1;
+    ooo_cpu[i].finish_sim_instr = stats->total_instr;
+    ooo_cpu[i].finish_sim_cycle = stats->total_cycle;
+    for (uint32_t n=0; n<NUM_SAMPLED_CACHES; n++) {
+        CACHE *cache = sampled_cache(i, n);
+        for (uint32_t j=0; j<NUM_TYPES; j++) {
+            cache->roi_access[i][j] = stats->total_access[n][j];
+            cache->roi_hit[i][j] = stats->total_hit[n][j];
+            cache->roi_miss[i][j] = stats->total_miss[n][j];
+        }
+    }
+
+    // the branch statistics are printed from the core's counters
+    ooo_cpu[i].num_branch = stats->total_branch;
+    ooo_cpu[i].branch_mispredictions = stats->total_mispredictions;
+    ooo_cpu[i].total_rob_occupancy_at_branch_mispredict = stats->total_rob_occupancy;
+    for (uint32_t j=0; j<8; j++)
+        ooo_cpu[i].total_branch_types[j] = stats->total_branch_types[j];
+}
+
+void print_sampling_stats()
+{
+    const char *cache_name[NUM_SAMPLED_CACHES] = {"L1D", "L1I", "L2C", "LLC"};
+
+    cout << endl << "Sampling Statistics (period: " << knob_sampling_period << " unit: " << knob_sampling_unit;
+    cout << " detailed warming: " << knob_sampling_warming << " instructions, 95% confidence)" << endl;
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        SAMPLING_STATS *stats = &sampling_stats[i];
+        if (stats->num_unit == 0) {
+            cout << endl << "CPU " << i << " no sampling units were measured" << endl;
+            continue;
+        }
+
+        // IPC is the ratio of the totals; its relative error is the relative error of the mean CPI
+        double mean_cpi = stats->cpi_sum / stats->num_unit,
+               cpi_error = sampling_error(stats->num_unit, stats->cpi_sum, stats->cpi_square_sum) / mean_cpi,
+               cv = (cpi_error * sqrt(stats->num_unit)) / SAMPLING_CONFIDENCE;
+
+        cout << endl << "CPU " << i << " sampled IPC: " << (1.0*stats->total_instr) / stats->total_cycle << " +- " << 100*cpi_error << "%";
+        cout << " units: " << stats->num_unit << " instructions: " << stats->total_instr << " cycles: " << stats->total_cycle << endl;
+        cout << "CPU " << i << " units needed for +- " << 100*SAMPLING_TARGET_ERROR << "%: ";
+        cout << (uint64_t)ceil((SAMPLING_CONFIDENCE * cv / SAMPLING_TARGET_ERROR) * (SAMPLING_CONFIDENCE * cv / SAMPLING_TARGET_ERROR)) << endl;
+
+        for (uint32_t n=0; n<NUM_SAMPLED_CACHES; n++) {
+            cout << "CPU " << i << " " << cache_name[n] << " MPKI: " << stats->mpki_sum[n] / stats->num_unit;
+            cout << " +- " << sampling_error(stats->num_unit, stats->mpki_sum[n], stats->mpki_square_sum[n]) << endl;
+        }
+    }
+}
+
+// functional warming and detailed sampling units until every core reaches simulation_instructions
+void run_sampled_simulation()
+{
+    uint64_t end_instr[NUM_CPUS];
+    for (uint32_t i=0; i<NUM_CPUS; i++)
+        end_instr[i] = ooo_cpu[i].begin_sim_instr + ooo_cpu[i].simulation_instructions;
+
+    for (uint64_t period=0; ; period++) {
+        uint64_t warming_begin[NUM_CPUS];
+        uint8_t  unit_state[NUM_CPUS]; // 0: detailed warming, 1: measuring, 2: done
+        uint32_t num_measured = 0;
+
+        for (uint32_t i=0; i<NUM_CPUS; i++) {
+            warming_begin[i] = ooo_cpu[i].begin_sim_instr + ((period + 1) * knob_sampling_period) - knob_sampling_warming - knob_sampling_unit;
+            if ((warming_begin[i] + knob_sampling_warming + knob_sampling_unit) <= end_instr[i]) {
+                unit_state[i] = 0;
+                num_measured++;
+            }
+            else
+                unit_state[i] = 2;
+        }
+        if (num_measured == 0)
+            break;
+
+        // functional warming
+        uint8_t warming_up = 1;
+        while (warming_up) {
+            warming_up = 0;
+            for (uint32_t i=0; i<NUM_CPUS; i++) {
+                if (ooo_cpu[i].num_retired < warming_begin[i]) {
+                    ooo_cpu[i].functional_warmup();
+                    warming_up = 1;
+                }
+            }
+        }
+
+        // detailed warming and measurement
+        while (num_measured) {
+            operate_sampled_cycle();
+
+            for (uint32_t i=0; i<NUM_CPUS; i++) {
+                if ((unit_state[i] == 0) && (ooo_cpu[i].num_retired >= (warming_begin[i] + knob_sampling_warming))) {
+                    begin_sampling_unit(&sampling_stats[i], i);
+                    unit_state[i] = 1;
+                }
+                if ((unit_state[i] == 1) && (ooo_cpu[i].num_retired >= (sampling_stats[i].begin_instr + knob_sampling_unit))) {
+                    end_sampling_unit(&sampling_stats[i], i);
+                    unit_state[i] = 2;
+                    num_measured--;
+                }
+            }
+        }
+
+        // let the instructions in flight retire before warming functionally again
+        sampling_drain = 1;
+        while (!sampling_drained())
+            operate_sampled_cycle();
+        sampling_drain = 0;
+
+        // page faults while warming up do not stall the core
+        for (uint32_t i=0; i<NUM_CPUS; i++)
+            stall_cycle[i] = 0;
+    }
+
+    uint64_t elapsed_second = (uint64_t)(time(NULL) - start_time),
+             elapsed_minute = elapsed_second / 60,
+             elapsed_hour = elapsed_minute / 60;
+    elapsed_minute -= elapsed_hour*60;
+    elapsed_second -= (elapsed_hour*3600 + elapsed_minute*60);
+
+    for (uint32_t i=0; i<NUM_CPUS; i++) {
+        finish_sampled_simulation(i);
+        print_finished(i, elapsed_hour, elapsed_minute, elapsed_second);
+    }
+    all_simulation_complete = NUM_CPUS;
+
+    print_sampling_stats();
+}
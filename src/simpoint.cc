@@ -0,0 +1,137 @@
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#include "simpoint.h"
+#include "ooo_cpu.h"
+
+char *knob_simpoints = NULL;
+
+bool simpoint_order(const SIMPOINT &a, const SIMPOINT &b)
+{
+    return a.start < b.start;
+}
+
+void read_simpoints(vector<SIMPOINT> &simpoints)
+{
+    ifstream simpoint_file(knob_simpoints);
+    if (!simpoint_file.is_open()) {
+        cerr << "*** CANNOT OPEN SIMPOINTS FILE: " << knob_simpoints << " ***" << endl;
+        assert(0);
+    }
+
+    string line;
+    double total_weight = 0;
+    while (getline(simpoint_file, line)) {
+        if ((line.find_first_not_of(" \t\r") == string::npos) || (line[line.find_first_not_of(" \t\r")] == '#'))
+            continue;
+
+        SIMPOINT simpoint;
+        memset(&simpoint.stats, 0, sizeof(simpoint.stats));
+        istringstream fields(line);
+        if (!(fields >> simpoint.start >> simpoint.weight) || (simpoint.weight < 0)) {
+            cerr << "*** INVALID SIMPOINT: " << line << " ***" << endl;
+            assert(0);
+        }
+        simpoints.push_back(simpoint);
+        total_weight += simpoint.weight;
+    }
+
+    if (simpoints.empty() || (total_weight <= 0)) {
+        cerr << "*** NO SIMPOINTS IN " << knob_simpoints << " ***" << endl;
+        assert(0);
+    }
+
+    // regions are simulated in trace order, and the weights are normalized to add up to 1
+    sort(simpoints.begin(), simpoints.end(), simpoint_order);
+    for (uint32_t k=0; k<simpoints.size(); k++) {
+        simpoints[k].weight /= total_weight;
+        if ((k > 0) && (simpoints[k].start < (simpoints[k-1].start + simulation_instructions))) {
+            cerr << "*** SIMPOINTS AT " << simpoints[k-1].start << " AND " << simpoints[k].start << " OVERLAP ***" << endl;
+            assert(0);
+        }
+    }
+}
+
+void print_simpoint_stats(vector<SIMPOINT> &simpoints)
+{
+    const char *cache_name[NUM_SAMPLED_CACHES] = {"L1D", "L1I", "L2C", "LLC"};
+    double weighted_cpi = 0, weighted_mpki[NUM_SAMPLED_CACHES] = {0},
+           weighted_branch_pki = 0, weighted_branch_mpki = 0;
+
+    cout << endl << "SimPoint Statistics (" << simpoints.size() << " regions of " << simulation_instructions << " instructions)" << endl << endl;
+    for (uint32_t k=0; k<simpoints.size(); k++) {
+        SAMPLING_STATS *stats = &simpoints[k].stats;
+
+        cout << "Region " << k << " start: " << simpoints[k].start << " weight: " << simpoints[k].weight;
+        cout << " IPC: " << (1.0*stats->total_instr) / stats->total_cycle;
+        for (uint32_t n=0; n<NUM_SAMPLED_CACHES; n++)
+            cout << " " << cache_name[n] << " MPKI: " << stats->mpki_sum[n];
+        double branch_pki = (1000.0*stats->total_branch) / stats->total_instr,
+               branch_mpki = (1000.0*stats->total_mispredictions) / stats->total_instr;
+        cout << " Branch MPKI: " << branch_mpki << endl;
+
+        // SimPoint weights apply to CPI, which is additive over instructions
+        weighted_cpi += simpoints[k].weight * stats->cpi_sum;
+        for (uint32_t n=0; n<NUM_SAMPLED_CACHES; n++)
+            weighted_mpki[n] += simpoints[k].weight * stats->mpki_sum[n];
+        weighted_branch_pki += simpoints[k].weight * branch_pki;
+        weighted_branch_mpki += simpoints[k].weight * branch_mpki;
+    }
+
+    cout << endl << "CPU 0 weighted IPC: " << 1.0 / weighted_cpi << endl;
+    for (uint32_t n=0; n<NUM_SAMPLED_CACHES; n++)
+        cout << "CPU 0 " << cache_name[n] << " weighted MPKI: " << weighted_mpki[n] << endl;
+    cout << "CPU 0 Branch weighted MPKI: " << weighted_branch_mpki;
+    cout << " weighted prediction accuracy: " << 100.0*(weighted_branch_pki - weighted_branch_mpki) / weighted_branch_pki << "%" << endl;
+}
+
+// skip to each region in a single pass over the trace, warm it up, and simulate it
+void run_simpoint_simulation()
+{
+    if (NUM_CPUS > 1) {
+        cerr << "*** -simpoints NEEDS A SINGLE-CORE BUILD ***" << endl;
+        assert(0);
+    }
+
+    vector<SIMPOINT> simpoints;
+    read_simpoints(simpoints);
+
+    for (uint32_t k=0; k<simpoints.size(); k++) {
+        uint64_t warmup_begin = (simpoints[k].start > warmup_instructions) ? (simpoints[k].start - warmup_instructions) : 0;
+        if (ooo_cpu[0].num_retired < warmup_begin)
+            ooo_cpu[0].skip_instructions(warmup_begin - ooo_cpu[0].num_retired);
+
+        while (ooo_cpu[0].num_retired < simpoints[k].start)
+            ooo_cpu[0].functional_warmup();
+
+        // stats are reset when the first region is warmed up
+        if (k == 0)
+            skip_detailed_warmup();
+        stall_cycle[0] = 0;
+
+        begin_sampling_unit(&simpoints[k].stats, 0);
+        begin_sampling_unit(&sampling_stats[0], 0);
+        while (ooo_cpu[0].num_retired < (simpoints[k].stats.begin_instr + simulation_instructions))
+            operate_sampled_cycle();
+        end_sampling_unit(&simpoints[k].stats, 0);
+        end_sampling_unit(&sampling_stats[0], 0);
+
+        uint64_t elapsed_second = (uint64_t)(time(NULL) - start_time);
+        cout << "Finished region " << k << " start: " << simpoints[k].start << " instructions: " << simpoints[k].stats.total_instr;
+        cout << " cycles: " << simpoints[k].stats.total_cycle << " IPC: " << (1.0*simpoints[k].stats.total_instr) / simpoints[k].stats.total_cycle;
+        cout << " (Simulation time: " << elapsed_second << " sec) " << endl;
+
+        // let the instructions in flight retire before skipping to the next region
+        sampling_drain = 1;
+        while (!sampling_drained())
+            operate_sampled_cycle();
+        sampling_drain = 0;
+    }
+
+    // the region of interest is made of all regions, unweighted
+    finish_sampled_simulation(0);
+    all_simulation_complete = NUM_CPUS;
+
+    print_simpoint_stats(simpoints);
+}
@@ -0,0 +1,142 @@
+#include <getopt.h>
+#include <sys/wait.h>
+#include <fstream>
+
+#include "sweep.h"
+#include "ooo_cpu.h"
+#include "policy.h"
+
+char *knob_sweep = NULL;
+
+// skips empty lines and lines starting with #
+void read_point_file(const char *file_name, const char *kind, vector<string> &points)
+{
+    ifstream point_file(file_name);
+    if (!point_file.is_open()) {
+        cerr << "*** CANNOT OPEN " << kind << " FILE: " << file_name << " ***" << endl;
+        assert(0);
+    }
+
+    string line;
+    while (getline(point_file, line)) {
+        if ((line.find_first_not_of(" \t\r") == string::npos) || (line[line.find_first_not_of(" \t\r")] == '#'))
+            continue;
+        points.push_back(line);
+    }
+}
+
+// sweep points and lockstep systems share the options that can differ between them
+void apply_point_options(string line)
+{
+    vector<char *> args;
+    args.push_back((char *)"sweep");
+    for (char *token = strtok(&line[0], " \t\r\n"); token != NULL; token = strtok(NULL, " \t\r\n"))
+        args.push_back(token);
+    args.push_back(NULL);
+
+    static struct option point_options[] =
+    {
+        {"simulation_instructions", required_argument, 0, 'i'},
+        {"low_bandwidth",  no_argument, 0, 'b'},
+        {"cycle_skip", no_argument, 0, 'k'},
+        {"branch_predictor", required_argument, 0, 'B'},
+        {"l1i_prefetcher", required_argument, 0, 'I'},
+        {"l1d_prefetcher", required_argument, 0, 'D'},
+        {"l2c_prefetcher", required_argument, 0, 'M'},
+        {"llc_prefetcher", required_argument, 0, 'G'},
+        {"llc_replacement", required_argument, 0, 'Y'},
+        {0, 0, 0, 0}
+    };
+
+    optind = 0;
+    int c, option_index = 0;
+    while ((c = getopt_long_only(args.size()-1, &args[0], "", point_options, &option_index)) != -1) {
+        switch(c) {
+            case 'i':
+                simulation_instructions = atol(optarg);
+                break;
+            case 'b':
+                knob_low_bandwidth = 1;
+                break;
+            case 'k':
+                knob_cycle_skip = 1;
+                break;
+            case 'B':
+                knob_branch_predictor = optarg;
+                break;
+            case 'I':
+                knob_l1i_prefetcher = optarg;
+                break;
+            case 'D':
+                knob_l1d_prefetcher = optarg;
+                break;
+            case 'M':
+                knob_l2c_prefetcher = optarg;
+                break;
+            case 'G':
+                knob_llc_prefetcher = optarg;
+                break;
+            case 'Y':
+                knob_llc_replacement = optarg;
+                break;
+            default:
+                cerr << "*** ONLY -simulation_instructions, -low_bandwidth, -cycle_skip, AND THE POLICY OPTIONS CAN CHANGE BETWEEN SWEEP POINTS OR LOCKSTEP SYSTEMS ***" << endl;
+                exit(1);
+        }
+    }
+
+    set_dram_bandwidth();
+    for (uint32_t i=0; i<NUM_CPUS; i++)
+        ooo_cpu[i].simulation_instructions = simulation_instructions;
+}
+
+void fork_sweep()
+{
+    vector<string> sweep_points;
+    read_point_file(knob_sweep, "SWEEP", sweep_points);
+
+    vector<pid_t> children;
+    for (uint32_t n=0; n<sweep_points.size(); n++) {
+        char result_name[1024];
+        snprintf(result_name, sizeof(result_name), "%s.%u", knob_sweep, n);
+
+        cout << flush;
+        pid_t pid = fork();
+        if (pid < 0) {
+            cerr << "*** CANNOT FORK SWEEP POINT " << n << " ***" << endl;
+            assert(0);
+        }
+
+        if (pid == 0) {
+            if (freopen(result_name, "w", stdout) == NULL) {
+                cerr << "*** CANNOT OPEN RESULT FILE: " << result_name << " ***" << endl;
+                exit(1);
+            }
+            cout << "Sweep point " << n << ": " << sweep_points[n] << endl;
+            apply_point_options(sweep_points[n]);
+            replace_policies();
+
+            // the trace files are shared with the parent, so each child opens its own
+            for (uint32_t i=0; i<NUM_CPUS; i++)
+                ooo_cpu[i].seek_trace(ooo_cpu[i].instr_unique_id);
+
+            return;
+        }
+
+        cout << "Sweep point " << n << " pid: " << pid << " options: " << sweep_points[n] << " results: " << result_name << endl;
+        children.push_back(pid);
+    }
+
+    uint32_t num_failed = 0;
+    for (uint32_t n=0; n<children.size(); n++) {
+        int status;
+        waitpid(children[n], &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+            cout << "Sweep point " << n << " failed" << endl;
+            num_failed++;
+        }
+    }
+
+    cout << endl << "ChampSim completed " << children.size() - num_failed << " of " << children.size() << " sweep points" << endl;
+    exit(num_failed ? 1 : 0);
+}
@@ -0,0 +1,557 @@
+#include <cerrno>
+#include <chrono>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include <lzma.h>
+#ifdef TRACE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "native_trace.h"
+
+class GZ_DECODER : public TRACE_DECODER {
+  public:
+    gzFile file;
+
+    GZ_DECODER(gzFile v1) : file(v1) {
+        gzbuffer(file, TRACE_INPUT_BUFFER);
+    };
+
+    ~GZ_DECODER() {
+        gzclose(file);
+    };
+
+    size_t read(void *buffer, size_t size) {
+        size_t done = 0;
+        while (done < size) {
+            int bytes = gzread(file, (char *)buffer + done, size - done);
+            if (bytes <= 0) {
+                // a corrupt or truncated trace (Z_BUF_ERROR, which gzread() returns as 0) must not be mistaken for its end
+                int error;
+                const char *message = gzerror(file, &error);
+                if (error != Z_OK) {
+                    cerr << "*** GZ DECODER ERROR: " << message << " ***" << endl;
+                    assert(0);
+                }
+                break;
+            }
+            done += bytes;
+        }
+
+        return done;
+    };
+
+    void seek(uint64_t record) {
+        gzrewind(file);
+    };
+};
+
+class XZ_DECODER : public TRACE_DECODER {
+  public:
+    FILE *file;
+    lzma_stream stream;
+    uint8_t *input;
+    uint8_t end_of_input;
+
+    XZ_DECODER(FILE *v1) : file(v1), stream(LZMA_STREAM_INIT) {
+        input = new uint8_t[TRACE_INPUT_BUFFER];
+        start();
+    };
+
+    void start() {
+        end_of_input = 0;
+        stream.avail_in = 0;
+
+        // xz -dc also decodes concatenated .xz files
+        if (lzma_stream_decoder(&stream, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK) {
+            cerr << "*** CANNOT INITIALIZE THE XZ DECODER ***" << endl;
+            assert(0);
+        }
+    };
+
+    ~XZ_DECODER() {
+        lzma_end(&stream);
+        fclose(file);
+        delete[] input;
+    };
+
+    size_t read(void *buffer, size_t size) {
+        stream.next_out = (uint8_t *)buffer;
+        stream.avail_out = size;
+
+        while (stream.avail_out) {
+            if ((stream.avail_in == 0) && !end_of_input) {
+                stream.next_in = input;
+                stream.avail_in = fread(input, 1, TRACE_INPUT_BUFFER, file);
+                if (ferror(file)) {
+                    cerr << "*** CANNOT READ XZ TRACE ***" << endl;
+                    assert(0);
+                }
+                if (stream.avail_in < TRACE_INPUT_BUFFER)
+                    end_of_input = 1;
+            }
+
+            // only the end of the stream ends the trace; a corrupt or truncated trace (LZMA_BUF_ERROR) is fatal
+            lzma_ret ret = lzma_code(&stream, end_of_input ? LZMA_FINISH : LZMA_RUN);
+            if (ret == LZMA_STREAM_END)
+                break;
+            if (ret != LZMA_OK) {
+                cerr << "*** XZ DECODER ERROR: " << ret << " ***" << endl;
+                assert(0);
+            }
+        }
+
+        return size - stream.avail_out;
+    };
+
+    void seek(uint64_t record) {
+        ::rewind(file);
+        start(); // reuses the decoder's memory
+    };
+};
+
+#ifdef TRACE_ZSTD
+class ZSTD_DECODER : public TRACE_DECODER {
+  public:
+    FILE *file;
+    ZSTD_DStream *stream;
+    uint8_t *input;
+    ZSTD_inBuffer in;
+    uint8_t end_of_input;
+    size_t frame_left; // nonzero in the middle of a frame
+
+    ZSTD_DECODER(FILE *v1) : file(v1) {
+        stream = ZSTD_createDStream();
+        ZSTD_initDStream(stream);
+        input = new uint8_t[TRACE_INPUT_BUFFER];
+        in.src = input;
+        in.size = 0;
+        in.pos = 0;
+        end_of_input = 0;
+        frame_left = 0;
+    };
+
+    ~ZSTD_DECODER() {
+        ZSTD_freeDStream(stream);
+        fclose(file);
+        delete[] input;
+    };
+
+    size_t read(void *buffer, size_t size) {
+        ZSTD_outBuffer out = {buffer, size, 0};
+
+        while (out.pos < out.size) {
+            if (in.pos == in.size) {
+                if (end_of_input) {
+                    // a truncated trace must not be mistaken for its end
+                    if (frame_left) {
+                        cerr << "*** ZSTD TRACE IS TRUNCATED ***" << endl;
+                        assert(0);
+                    }
+                    break;
+                }
+                in.size = fread(input, 1, TRACE_INPUT_BUFFER, file);
+                in.pos = 0;
+                if (ferror(file)) {
+                    cerr << "*** CANNOT READ ZSTD TRACE ***" << endl;
+                    assert(0);
+                }
+                if (in.size < TRACE_INPUT_BUFFER)
+                    end_of_input = 1;
+            }
+
+            frame_left = ZSTD_decompressStream(stream, &out, &in);
+            if (ZSTD_isError(frame_left)) {
+                cerr << "*** ZSTD DECODER ERROR: " << ZSTD_getErrorName(frame_left) << " ***" << endl;
+                assert(0);
+            }
+        }
+
+        return out.pos;
+    };
+
+    void seek(uint64_t record) {
+        ::rewind(file);
+        ZSTD_initDStream(stream);
+        in.size = 0;
+        in.pos = 0;
+        end_of_input = 0;
+        frame_left = 0;
+    };
+};
+#endif
+
+class FD_DECODER : public TRACE_DECODER {
+  public:
+    int fd;
+
+    FD_DECODER(int v1) : fd(v1) {};
+
+    ~FD_DECODER() {
+        close(fd);
+    };
+
+    size_t read(void *buffer, size_t size) {
+        size_t done = 0;
+        while (done < size) {
+            ssize_t bytes = ::read(fd, (char *)buffer + done, size - done);
+            if ((bytes < 0) && (errno == EINTR))
+                continue;
+            if (bytes <= 0)
+                break;
+            done += bytes;
+        }
+
+        return done;
+    };
+
+    void seek(uint64_t record) {
+        cerr << "*** A TRACE STREAM CANNOT BE REWOUND ***" << endl;
+        assert(0);
+    };
+};
+
+TRACE_DECODER *open_trace_decoder(const char *file_name)
+{
+    const char *last_dot = strrchr(file_name, '.');
+    if (last_dot == NULL) {
+        cerr << "*** UNKNOWN TRACE COMPRESSION: " << file_name << " ***" << endl;
+        return NULL;
+    }
+
+    if (strcmp(last_dot, ".gz") == 0) {
+        gzFile file = gzopen(file_name, "rb");
+        return file ? new GZ_DECODER(file) : NULL;
+    }
+
+    if ((strcmp(last_dot, ".xz") == 0) || (strcmp(last_dot, ".zst") == 0)) {
+        FILE *file = fopen(file_name, "rb");
+        if (file == NULL)
+            return NULL;
+
+        if (last_dot[1] == 'x')
+            return new XZ_DECODER(file);
+#ifdef TRACE_ZSTD
+        return new ZSTD_DECODER(file);
+#else
+        cerr << "*** .zst TRACES NEED A BUILD WITH -DTRACE_ZSTD: " << file_name << " ***" << endl;
+        fclose(file);
+        return NULL;
+#endif
+    }
+
+    if (strcmp(last_dot, ".cst") == 0)
+        return open_native_decoder(file_name);
+
+    cerr << "*** UNKNOWN TRACE COMPRESSION: " << file_name << " ***" << endl;
+    return NULL;
+}
+
+TRACE_DECODER *open_fd_decoder(int fd)
+{
+    return new FD_DECODER(fd);
+}
+
+string share_trace(const char *name, const char *broker_dir)
+{
+    // foo.champsimtrace.xz is shared as broker_dir/DEVICE-INODE-foo.champsimtrace, since traces in different
+    // directories can have the same name, while the links to one trace share its device and inode
+    struct stat trace_stat, shared_stat;
+    if (stat(name, &trace_stat)) {
+        cerr << "*** CANNOT FIND TRACE: " << name << " ***" << endl;
+        assert(0);
+    }
+
+    const char *base_name = strrchr(name, '/');
+    base_name = base_name ? (base_name + 1) : name;
+    string shared_name = string(broker_dir) + "/" + to_string((uint64_t)trace_stat.st_dev) + "-" + to_string((uint64_t)trace_stat.st_ino) + "-"
+                         + string(base_name, strrchr(base_name, '.') - base_name),
+           lock_name = shared_name + ".lock";
+
+    int lock_fd = ::open(lock_name.c_str(), O_RDWR | O_CREAT, 0666);
+    if ((lock_fd < 0) || flock(lock_fd, LOCK_EX)) {
+        cerr << "*** CANNOT LOCK SHARED TRACE: " << lock_name << " ***" << endl;
+        assert(0);
+    }
+
+    // whoever holds the lock first decompresses the trace; the others wait for it and find it ready
+    if (stat(shared_name.c_str(), &shared_stat) || (shared_stat.st_mtime < trace_stat.st_mtime)) {
+        cout << "Decompressing " << name << " into " << shared_name << endl;
+
+        TRACE_DECODER *decoder = open_trace_decoder(name);
+        string temp_name = shared_name + "." + to_string(getpid());
+        FILE *file = fopen(temp_name.c_str(), "wb");
+        if ((decoder == NULL) || (file == NULL)) {
+            cerr << "*** CANNOT DECOMPRESS " << name << " INTO " << temp_name << " ***" << endl;
+            assert(0);
+        }
+
+        vector<char> buffer(TRACE_INPUT_BUFFER);
+        size_t size;
+        uint8_t written = 1;
+        while (written && ((size = decoder->read(&buffer[0], buffer.size())) > 0))
+            written = (fwrite(&buffer[0], size, 1, file) == 1);
+        delete decoder;
+
+        // renamed into place only when complete, so a crash never leaves a short trace behind
+        if (fclose(file) || !written || rename(temp_name.c_str(), shared_name.c_str())) {
+            cerr << "*** CANNOT WRITE SHARED TRACE: " << shared_name << " ***" << endl;
+            remove(temp_name.c_str());
+            assert(0);
+        }
+    }
+
+    flock(lock_fd, LOCK_UN);
+    close(lock_fd);
+    return shared_name;
+}
+
+uint8_t TRACE_READER::open(const char *name, uint32_t size)
+{
+    snprintf(file_name, sizeof(file_name), "%s", name);
+    record_size = size;
+    rewindable = 1;
+
+    const char *last_dot = strrchr(file_name, '.');
+    if (last_dot && (strcmp(last_dot, ".champsimtrace") == 0))
+        return map(file_name);
+
+    decoder = open_trace_decoder(file_name);
+    if (decoder == NULL)
+        return 0;
+
+    start_worker();
+    return 1;
+}
+
+void TRACE_READER::open_fd(int fd, uint32_t size)
+{
+    unmap();
+
+    // a decoder left behind by the parent's reader thread may be in an inconsistent state
+    uint8_t own_decoder = (worker == NULL) || (worker_pid == getpid());
+    stop_worker();
+    if (own_decoder)
+        delete decoder;
+
+    record_size = size;
+    rewindable = 0;
+    decoder = open_fd_decoder(fd);
+    start_worker();
+}
+
+uint8_t TRACE_READER::map(const char *name)
+{
+    int fd = ::open(name, O_RDONLY);
+    if (fd < 0)
+        return 0;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) || (file_stat.st_size < (off_t)record_size)) {
+        cerr << "*** EMPTY TRACE FILE: " << name << " ***" << endl;
+        close(fd);
+        return 0;
+    }
+
+    mapped_size = file_stat.st_size;
+    void *address = mmap(NULL, mapped_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) {
+        cerr << "*** CANNOT MAP TRACE FILE: " << name << " ***" << endl;
+        return 0;
+    }
+
+    // the trace is read front to back, so the kernel can read ahead far and drop pages behind us;
+    // huge pages are only a hint, since few file systems can back a file mapping with them
+    madvise(address, mapped_size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    madvise(address, mapped_size, MADV_HUGEPAGE);
+#endif
+
+    mapped = (const char *)address;
+    mapped_records = mapped_size / record_size; // a torn last record is ignored
+    mapped_record = 0;
+    position = 0;
+    return 1;
+}
+
+void TRACE_READER::unmap()
+{
+    if (mapped == NULL)
+        return;
+
+    munmap((void *)mapped, mapped_size);
+    mapped = NULL;
+}
+
+void TRACE_READER::seek(uint64_t record)
+{
+    if (mapped) {
+        mapped_record = record % mapped_records;
+        position = record;
+        return;
+    }
+
+    uint8_t own_decoder = (worker == NULL) || (worker_pid == getpid());
+    uint64_t point = decoder->seek_point(record);
+
+    // decoding on is cheaper than jumping back to the same block or to the beginning
+    if (own_decoder && (worker != NULL) && (record >= position) && (point <= position)) {
+        skip(record - position);
+        return;
+    }
+
+    stop_worker();
+    if (!own_decoder) {
+        // a decoder left behind by the parent's reader thread may be in an inconsistent state,
+        // and it shares its file offset with the parent
+        decoder = open_trace_decoder(file_name);
+        if (decoder == NULL) {
+            cerr << endl << "*** CANNOT REOPEN TRACE FILE: " << file_name << " ***" << endl;
+            assert(0);
+        }
+    }
+
+    decoder->seek(record);
+    start_worker();
+    position = point;
+    skip(record - point);
+}
+
+void TRACE_READER::start_worker()
+{
+    ring.head = 0;
+    ring.tail = 0;
+    current_record = 0;
+    position = 0;
+
+    stop = 0;
+    worker_pid = getpid();
+    worker = new thread(&TRACE_READER::fill, this);
+}
+
+void TRACE_READER::stop_worker()
+{
+    if (worker == NULL)
+        return;
+
+    // after a fork, the reader thread belongs to the parent process
+    if (worker_pid == getpid()) {
+        stop = 1;
+        worker->join();
+        delete worker;
+    }
+    worker = NULL;
+}
+
+// reader thread: decompress one chunk at a time into the ring
+void TRACE_READER::fill()
+{
+    size_t chunk_size = TRACE_CHUNK_RECORDS * record_size;
+
+    while (!stop) {
+        TRACE_CHUNK *chunk = ring.back();
+        if (chunk == NULL) { // the simulation is behind
+            this_thread::sleep_for(chrono::microseconds(100));
+            continue;
+        }
+
+        if (chunk->data == NULL)
+            chunk->data = new char[chunk_size];
+
+        size_t size = decoder->read(chunk->data, chunk_size);
+        chunk->num_records = size / record_size;
+        chunk->end_of_trace = (size < chunk_size);
+        ring.push_back();
+
+        if (chunk->end_of_trace) {
+            if (!rewindable)
+                return;
+            decoder->seek(0);
+        }
+    }
+}
+
+const void *TRACE_READER::next()
+{
+    if (mapped) {
+        if (mapped_record == mapped_records) {
+            mapped_record = 0;
+            return NULL;
+        }
+
+        position++;
+        return mapped + (mapped_record++ * record_size);
+    }
+
+    while (1) {
+        TRACE_CHUNK *chunk = ring.front();
+        if (chunk == NULL) { // the reader thread is behind
+            this_thread::yield();
+            continue;
+        }
+
+        if (current_record < chunk->num_records) {
+            position++;
+            return chunk->data + ((size_t)current_record++ * record_size);
+        }
+
+        uint8_t end_of_trace = chunk->end_of_trace;
+        current_record = 0;
+        ring.pop();
+
+        if (end_of_trace) {
+            if (!rewindable) {
+                cerr << endl << "*** TRACE STREAM ENDED ***" << endl;
+                assert(0);
+            }
+            return NULL;
+        }
+    }
+}
+
+uint8_t TRACE_READER::read(void *record)
+{
+    const void *next_record = next();
+    if (next_record == NULL)
+        return 0;
+
+    memcpy(record, next_record, record_size);
+    return 1;
+}
+
+void TRACE_READER::skip(uint64_t num_records)
+{
+    if (mapped) {
+        mapped_record = (mapped_record + num_records) % mapped_records;
+        position += num_records;
+        return;
+    }
+
+    while (num_records) {
+        TRACE_CHUNK *chunk = ring.front();
+        if (chunk == NULL) {
+            this_thread::yield();
+            continue;
+        }
+
+        uint64_t records = min((uint64_t)(chunk->num_records - current_record), num_records);
+        current_record += records;
+        position += records;
+        num_records -= records;
+        if (num_records == 0)
+            break;
+
+        // the end of the trace is passed silently, as if the trace went on from its beginning
+        uint8_t end_of_trace = chunk->end_of_trace;
+        current_record = 0;
+        ring.pop();
+        if (end_of_trace && !rewindable) {
+            cerr << endl << "*** TRACE STREAM ENDED ***" << endl;
+            assert(0);
+        }
+    }
+}
@@ -1,7 +1,7 @@
 #include "uncore.h"
 
 // uncore
-UNCORE uncore;
+UNCORE *uncore;
 
 // constructor
 UNCORE::UNCORE() {
@@ -0,0 +1,590 @@
+// every CONFIG_PARAMETER is defined here with its default value, for the cache capacities below
+#define CONFIG_DEFINE
+
+#include <getopt.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "trace_reader.h"
+#include "decode_cache.h"
+
+// TRACE ANALYZER
+// characterizes a trace without simulating it: the main thread copies the records out of the
+// trace reader into chunks of knob_chunk instructions, and worker threads analyze the chunks in
+// parallel; each chunk starts with the last knob_window instructions of the one before it, which
+// only warm up the reuse distances and strides, so a reuse is seen unless it is longer than the window
+// a data access misses a cache when its reuse distance (the distinct blocks touched since the
+// previous access to the block) is at least the capacity of the cache, as in a fully associative LRU
+// cache of the default L1D, L2C, and LLC sizes of inc/cache.h
+#define REUSE_BUCKETS 32 // log2 buckets, the last one holds the longer distances
+#define DELTA_BUCKETS 24 // log2 buckets of the block deltas of an IP, per direction
+
+uint32_t knob_threads = thread::hardware_concurrency(),
+         knob_top = 20;
+uint64_t knob_chunk = 1 << 20,
+         knob_window = 1 << 18,
+         knob_instructions = 0;
+uint8_t knob_trace_v2 = 0;
+
+const char *branch_type_names[] = {"NOT_BRANCH", "BRANCH_DIRECT_JUMP", "BRANCH_INDIRECT", "BRANCH_CONDITIONAL",
+                                   "BRANCH_DIRECT_CALL", "BRANCH_INDIRECT_CALL", "BRANCH_RETURN", "BRANCH_OTHER"};
+const char *instr_class_names[] = {"UNKNOWN", "INT_ALU", "INT_MUL", "INT_DIV", "FP", "FP_DIV", "SIMD",
+                                   "LOAD", "STORE", "BRANCH", "SYNC"};
+
+class IP_STATS {
+  public:
+    uint64_t accesses,
+             l1d_misses,
+             l2c_misses,
+             llc_misses,
+             strided; // the same non-zero block delta as the previous access of the IP
+
+    IP_STATS() {
+        accesses = 0;
+        l1d_misses = 0;
+        l2c_misses = 0;
+        llc_misses = 0;
+        strided = 0;
+    };
+};
+
+// the previous access of an IP within a chunk
+class IP_HISTORY {
+  public:
+    uint64_t block;
+    int64_t delta;
+};
+
+class TRACE_CHUNK_COPY {
+  public:
+    vector<char> data;
+    uint64_t num_records,
+             num_warm; // the first num_warm records belong to the chunk before
+
+    TRACE_CHUNK_COPY() {
+        num_records = 0;
+        num_warm = 0;
+    };
+};
+
+// what a worker found in the chunks it analyzed; merged into one at the end
+class TRACE_ANALYSIS {
+  public:
+    uint64_t instructions,
+             loads,
+             stores,
+             branch_types[8],
+             branches_taken,
+             instr_classes[NUM_INSTR_CLASSES],
+             reuse[REUSE_BUCKETS],
+             reuse_beyond_window,
+             deltas[2*DELTA_BUCKETS+1];
+
+    unordered_set<uint64_t> instr_blocks, data_blocks, data_pages;
+    unordered_map<uint64_t, IP_STATS> ips;
+    DECODE_CACHE decode_cache;
+
+    TRACE_ANALYSIS() {
+        instructions = 0;
+        loads = 0;
+        stores = 0;
+        branches_taken = 0;
+        reuse_beyond_window = 0;
+        memset(branch_types, 0, sizeof(branch_types));
+        memset(instr_classes, 0, sizeof(instr_classes));
+        memset(reuse, 0, sizeof(reuse));
+        memset(deltas, 0, sizeof(deltas));
+    };
+
+    void analyze(const TRACE_CHUNK_COPY *chunk, uint32_t record_size),
+         merge(TRACE_ANALYSIS *other);
+};
+
+// the reuse distance of an access is the number of blocks whose latest access falls between the
+// previous access to its block and itself, counted with a Fenwick tree over the accesses of a chunk
+class REUSE_COUNTER {
+  public:
+    vector<uint32_t> tree;
+    unordered_map<uint64_t, uint64_t> last_access;
+
+    REUSE_COUNTER(uint64_t num_accesses) : tree(num_accesses + 1, 0) {};
+
+    void add(uint64_t position, int32_t value) {
+        for (position++; position < tree.size(); position += position & (~position + 1))
+            tree[position] += value;
+    };
+
+    // latest accesses at positions below position
+    uint64_t count(uint64_t position) {
+        uint64_t sum = 0;
+        for (; position > 0; position -= position & (~position + 1))
+            sum += tree[position];
+        return sum;
+    };
+
+    // returns UINT64_MAX if the block was not accessed before in the chunk
+    uint64_t access(uint64_t block, uint64_t position) {
+        uint64_t distance = UINT64_MAX;
+        auto last = last_access.find(block);
+        if (last != last_access.end()) {
+            distance = count(position) - count(last->second + 1);
+            add(last->second, -1);
+            last->second = position;
+        }
+        else
+            last_access[block] = position;
+
+        add(position, 1);
+        return distance;
+    };
+};
+
+uint32_t log2_bucket(uint64_t value, uint32_t num_buckets)
+{
+    uint32_t bucket = 0;
+    while (value && (bucket < num_buckets - 1)) {
+        value >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void TRACE_ANALYSIS::analyze(const TRACE_CHUNK_COPY *chunk, uint32_t record_size)
+{
+    const uint32_t l1d_blocks = L1D_SET * L1D_WAY,
+                   l2c_blocks = L2C_SET * L2C_WAY,
+                   llc_blocks = LLC_SET * LLC_WAY;
+
+    uint64_t num_accesses = 0;
+    const char *record = &chunk->data[0];
+    for (uint64_t r=0; r<chunk->num_records; r++, record += record_size) {
+        const input_instr *instr = (const input_instr *)record;
+        for (uint32_t i=0; i<NUM_INSTR_SOURCES; i++)
+            num_accesses += (instr->source_memory[i] != 0);
+        for (uint32_t i=0; i<NUM_INSTR_DESTINATIONS; i++)
+            num_accesses += (instr->destination_memory[i] != 0);
+    }
+
+    REUSE_COUNTER reuse_counter(num_accesses);
+    unordered_map<uint64_t, IP_HISTORY> history;
+    uint64_t position = 0;
+
+    // the fields are read straight out of the fixed-size records, one record after the other
+    record = &chunk->data[0];
+    for (uint64_t r=0; r<chunk->num_records; r++, record += record_size) {
+        const input_instr *instr = (const input_instr *)record;
+        const instr_info *info = knob_trace_v2 ? &((const input_instr_v2 *)record)->info : NULL;
+        bool counted = (r >= chunk->num_warm);
+
+        if (info && (info->instr_class == INSTR_CLASS_SYNC)) { // a marker, not an instruction
+            if (counted)
+                instr_classes[INSTR_CLASS_SYNC]++;
+            continue;
+        }
+
+        if (counted) {
+            instructions++;
+            instr_blocks.insert(instr->ip >> LOG2_BLOCK_SIZE);
+
+            uint8_t branch_type, taken = instr->branch_taken;
+            if (info) {
+                instr_classes[info->instr_class < NUM_INSTR_CLASSES ? info->instr_class : INSTR_CLASS_UNKNOWN]++;
+                branch_type = info->branch_type;
+            }
+            else {
+                DECODED_INSTR *decoded = decode_cache.lookup(instr);
+                branch_type = decoded->branch_type;
+                taken |= decoded->always_taken;
+            }
+            branch_types[branch_type < 8 ? branch_type : BRANCH_OTHER]++;
+            if ((branch_type != NOT_BRANCH) && taken)
+                branches_taken++;
+        }
+
+        for (uint32_t i=0; i<NUM_INSTR_SOURCES+NUM_INSTR_DESTINATIONS; i++) {
+            uint64_t address = (i < NUM_INSTR_SOURCES) ? instr->source_memory[i] : instr->destination_memory[i-NUM_INSTR_SOURCES];
+            if (address == 0)
+                continue;
+
+            uint64_t block = address >> LOG2_BLOCK_SIZE;
+            uint64_t distance = reuse_counter.access(block, position++);
+
+            // the block delta of this IP
+            IP_HISTORY *last = NULL;
+            auto found = history.find(instr->ip);
+            int64_t delta = 0;
+            uint8_t strided = 0;
+            if (found != history.end()) {
+                last = &found->second;
+                delta = block - last->block;
+                strided = (delta != 0) && (delta == last->delta);
+                last->block = block;
+                last->delta = delta;
+            }
+            else
+                history[instr->ip] = {block, 0};
+
+            if (!counted)
+                continue;
+
+            if (i < NUM_INSTR_SOURCES)
+                loads++;
+            else
+                stores++;
+            data_blocks.insert(block);
+            data_pages.insert(address >> LOG2_PAGE_SIZE);
+
+            if (distance == UINT64_MAX)
+                reuse_beyond_window++;
+            else
+                reuse[log2_bucket(distance, REUSE_BUCKETS)]++;
+
+            if (last) {
+                uint32_t bucket = log2_bucket(delta < 0 ? -delta : delta, DELTA_BUCKETS+1);
+                deltas[delta < 0 ? DELTA_BUCKETS - bucket : DELTA_BUCKETS + bucket]++;
+            }
+
+            IP_STATS *stats = &ips[instr->ip];
+            stats->accesses++;
+            stats->strided += strided;
+            if (distance >= l1d_blocks)
+                stats->l1d_misses++;
+            if (distance >= l2c_blocks)
+                stats->l2c_misses++;
+            if (distance >= llc_blocks)
+                stats->llc_misses++;
+        }
+    }
+}
+
+void TRACE_ANALYSIS::merge(TRACE_ANALYSIS *other)
+{
+    instructions += other->instructions;
+    loads += other->loads;
+    stores += other->stores;
+    branches_taken += other->branches_taken;
+    reuse_beyond_window += other->reuse_beyond_window;
+    for (uint32_t i=0; i<8; i++)
+        branch_types[i] += other->branch_types[i];
+    for (uint32_t i=0; i<NUM_INSTR_CLASSES; i++)
+        instr_classes[i] += other->instr_classes[i];
+    for (uint32_t i=0; i<REUSE_BUCKETS; i++)
+        reuse[i] += other->reuse[i];
+    for (uint32_t i=0; i<2*DELTA_BUCKETS+1; i++)
+        deltas[i] += other->deltas[i];
+
+    instr_blocks.insert(other->instr_blocks.begin(), other->instr_blocks.end());
+    data_blocks.insert(other->data_blocks.begin(), other->data_blocks.end());
+    data_pages.insert(other->data_pages.begin(), other->data_pages.end());
+
+    for (auto &ip : other->ips) {
+        IP_STATS *stats = &ips[ip.first];
+        stats->accesses += ip.second.accesses;
+        stats->l1d_misses += ip.second.l1d_misses;
+        stats->l2c_misses += ip.second.l2c_misses;
+        stats->llc_misses += ip.second.llc_misses;
+        stats->strided += ip.second.strided;
+    }
+}
+
+// chunks waiting for a worker, and chunks free to be filled again
+class CHUNK_QUEUE {
+  public:
+    mutex lock;
+    condition_variable ready;
+    queue<TRACE_CHUNK_COPY *> chunks;
+
+    void push(TRACE_CHUNK_COPY *chunk) {
+        {
+            lock_guard<mutex> guard(lock);
+            chunks.push(chunk);
+        }
+        ready.notify_one();
+    };
+
+    // NULL tells a worker to stop
+    TRACE_CHUNK_COPY *pop() {
+        unique_lock<mutex> guard(lock);
+        ready.wait(guard, [this] { return !chunks.empty(); });
+        TRACE_CHUNK_COPY *chunk = chunks.front();
+        chunks.pop();
+        return chunk;
+    };
+};
+
+// "+4..+7" for the deltas from 4 to 7 blocks
+string delta_name(int32_t bucket)
+{
+    if (bucket == 0)
+        return "0";
+
+    uint64_t low = 1ull << (abs(bucket) - 1), high = (low << 1) - 1;
+    if (abs(bucket) == DELTA_BUCKETS)
+        return (bucket < 0) ? ".." + to_string(-(int64_t)low) : "+" + to_string(low) + "..";
+    if (low == high)
+        return (bucket < 0) ? "-" + to_string(low) : "+" + to_string(low);
+    if (bucket < 0)
+        return "-" + to_string(high) + "..-" + to_string(low);
+    return "+" + to_string(low) + "..+" + to_string(high);
+}
+
+// a JSON string holds no unescaped quotes, backslashes, or control characters
+string json_escape(const char *text)
+{
+    string escaped;
+    for (const char *c = text; *c; c++) {
+        if ((*c == '"') || (*c == '\\')) {
+            escaped += '\\';
+            escaped += *c;
+        }
+        else if ((unsigned char)*c < 0x20) {
+            char code[8];
+            snprintf(code, sizeof(code), "\\u%04x", (unsigned char)*c);
+            escaped += code;
+        }
+        else
+            escaped += *c;
+    }
+
+    return escaped;
+}
+
+void print_json(FILE *out, const char *trace_name, TRACE_ANALYSIS *analysis, double seconds)
+{
+    fprintf(out, "  {\n    \"trace\": \"%s\",\n    \"format\": %d,\n", json_escape(trace_name).c_str(), knob_trace_v2 ? 2 : 1);
+    fprintf(out, "    \"instructions\": %lu,\n    \"loads\": %lu,\n    \"stores\": %lu,\n", analysis->instructions, analysis->loads, analysis->stores);
+
+    fprintf(out, "    \"footprint\": {\"instruction_blocks\": %lu, \"data_blocks\": %lu, \"data_pages\": %lu, \"instruction_bytes\": %lu, \"data_bytes\": %lu},\n",
+            analysis->instr_blocks.size(), analysis->data_blocks.size(), analysis->data_pages.size(),
+            analysis->instr_blocks.size() * BLOCK_SIZE, analysis->data_blocks.size() * BLOCK_SIZE);
+
+    fprintf(out, "    \"branch_types\": {");
+    for (uint32_t i=0; i<8; i++)
+        fprintf(out, "%s\"%s\": %lu", i ? ", " : "", branch_type_names[i], analysis->branch_types[i]);
+    fprintf(out, "},\n    \"branches_taken\": %lu,\n", analysis->branches_taken);
+
+    if (knob_trace_v2) {
+        fprintf(out, "    \"instr_classes\": {");
+        for (uint32_t i=0; i<NUM_INSTR_CLASSES; i++)
+            fprintf(out, "%s\"%s\": %lu", i ? ", " : "", instr_class_names[i], analysis->instr_classes[i]);
+        fprintf(out, "},\n");
+    }
+
+    // [min, max] blocks between two accesses to a block
+    fprintf(out, "    \"reuse_distance\": {\"window_instructions\": %lu, \"beyond_window\": %lu, \"buckets\": [", knob_window, analysis->reuse_beyond_window);
+    for (uint32_t i=0; i<REUSE_BUCKETS; i++) {
+        uint64_t low = i ? (1ull << (i-1)) : 0, high = i ? (low << 1) - 1 : 0;
+        if (i == REUSE_BUCKETS-1)
+            fprintf(out, "%s{\"min\": %lu, \"count\": %lu}", i ? ", " : "", low, analysis->reuse[i]);
+        else
+            fprintf(out, "%s{\"min\": %lu, \"max\": %lu, \"count\": %lu}", i ? ", " : "", low, high, analysis->reuse[i]);
+    }
+    fprintf(out, "]},\n");
+
+    fprintf(out, "    \"block_deltas\": {");
+    for (int32_t i=-DELTA_BUCKETS; i<=DELTA_BUCKETS; i++)
+        fprintf(out, "%s\"%s\": %lu", (i == -DELTA_BUCKETS) ? "" : ", ", delta_name(i).c_str(), analysis->deltas[i+DELTA_BUCKETS]);
+    fprintf(out, "},\n");
+
+    // the IPs with the most LLC misses, then L2C and L1D misses
+    vector<pair<uint64_t, IP_STATS *> > ips;
+    for (auto &ip : analysis->ips)
+        ips.push_back(make_pair(ip.first, &ip.second));
+    auto more_misses = [](const pair<uint64_t, IP_STATS *> &a, const pair<uint64_t, IP_STATS *> &b) {
+        if (a.second->llc_misses != b.second->llc_misses)
+            return a.second->llc_misses > b.second->llc_misses;
+        if (a.second->l2c_misses != b.second->l2c_misses)
+            return a.second->l2c_misses > b.second->l2c_misses;
+        if (a.second->l1d_misses != b.second->l1d_misses)
+            return a.second->l1d_misses > b.second->l1d_misses;
+        return a.first < b.first;
+    };
+    uint32_t num_top = min((size_t)knob_top, ips.size());
+    partial_sort(ips.begin(), ips.begin() + num_top, ips.end(), more_misses);
+
+    fprintf(out, "    \"miss_candidates\": {\"l1d_blocks\": %u, \"l2c_blocks\": %u, \"llc_blocks\": %u, \"memory_ips\": %lu, \"ips\": [",
+            L1D_SET * L1D_WAY, L2C_SET * L2C_WAY, LLC_SET * LLC_WAY, ips.size());
+    for (uint32_t i=0; i<num_top; i++) {
+        IP_STATS *stats = ips[i].second;
+        fprintf(out, "%s\n      {\"ip\": \"0x%lx\", \"accesses\": %lu, \"l1d_misses\": %lu, \"l2c_misses\": %lu, \"llc_misses\": %lu, \"strided\": %lu}",
+                i ? "," : "", ips[i].first, stats->accesses, stats->l1d_misses, stats->l2c_misses, stats->llc_misses, stats->strided);
+    }
+    fprintf(out, "%s]},\n", num_top ? "\n    " : "");
+
+    fprintf(out, "    \"seconds\": %.3f\n  }", seconds);
+}
+
+TRACE_ANALYSIS *analyze_trace(const char *trace_name)
+{
+    TRACE_READER trace;
+    uint32_t record_size = knob_trace_v2 ? sizeof(input_instr_v2) : sizeof(input_instr);
+    if (!trace.open(trace_name, record_size)) {
+        fprintf(stderr, "\n*** Trace file not found: %s ***\n\n", trace_name);
+        exit(1);
+    }
+
+    // one chunk per worker, one being filled, and one being handed over
+    CHUNK_QUEUE work, free_chunks;
+    vector<TRACE_CHUNK_COPY> chunks(knob_threads + 2);
+    for (auto &chunk : chunks) {
+        chunk.data.resize((knob_window + knob_chunk) * record_size);
+        free_chunks.push(&chunk);
+    }
+
+    vector<TRACE_ANALYSIS> analyses(knob_threads);
+    vector<thread> workers;
+    for (uint32_t i=0; i<knob_threads; i++)
+        workers.push_back(thread([&, i] {
+            while (TRACE_CHUNK_COPY *chunk = work.pop()) {
+                analyses[i].analyze(chunk, record_size);
+                free_chunks.push(chunk);
+            }
+        }));
+
+    uint64_t num_instructions = 0;
+    TRACE_CHUNK_COPY *chunk = free_chunks.pop();
+    uint8_t end_of_trace = 0;
+    while (!end_of_trace) {
+        // records of the chunk, not counting the window copied from the chunk before
+        uint64_t num_new = 0;
+        while (num_new < knob_chunk) {
+            if (knob_instructions && (num_instructions == knob_instructions)) {
+                end_of_trace = 1;
+                break;
+            }
+
+            const void *record = trace.next();
+            if (record == NULL) {
+                end_of_trace = 1;
+                break;
+            }
+
+            memcpy(&chunk->data[(chunk->num_records++) * record_size], record, record_size);
+            num_new++;
+            if (!knob_trace_v2 || (((const input_instr_v2 *)record)->info.instr_class != INSTR_CLASS_SYNC))
+                num_instructions++;
+        }
+
+        if (num_new == 0)
+            break;
+
+        TRACE_CHUNK_COPY *next = NULL;
+        if (!end_of_trace) {
+            next = free_chunks.pop();
+            next->num_warm = min(knob_window, chunk->num_records);
+            next->num_records = next->num_warm;
+            memcpy(&next->data[0], &chunk->data[(chunk->num_records - next->num_warm) * record_size], next->num_warm * record_size);
+        }
+        work.push(chunk);
+        chunk = next;
+    }
+
+    for (uint32_t i=0; i<knob_threads; i++)
+        work.push(NULL);
+    for (auto &worker : workers)
+        worker.join();
+
+    TRACE_ANALYSIS *analysis = new TRACE_ANALYSIS;
+    for (auto &other : analyses)
+        analysis->merge(&other);
+    return analysis;
+}
+
+void print_usage()
+{
+    fprintf(stderr, "usage: champsim_analyze [-threads N] [-chunk N] [-window N] [-instructions N] [-top N] [-trace_v2] [-o FILE] -traces TRACE...\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *output_name = NULL;
+
+    int c;
+    while (1) {
+        static struct option long_options[] =
+        {
+            {"threads", required_argument, 0, 'p'},
+            {"chunk", required_argument, 0, 'c'},
+            {"window", required_argument, 0, 'w'},
+            {"instructions", required_argument, 0, 'i'},
+            {"top", required_argument, 0, 'n'},
+            {"trace_v2", no_argument, 0, 'V'},
+            {"o", required_argument, 0, 'o'},
+            {"traces", no_argument, 0, 't'},
+            {0, 0, 0, 0}
+        };
+
+        int option_index = 0;
+        c = getopt_long_only(argc, argv, "", long_options, &option_index);
+        if ((c == -1) || (c == 't'))
+            break;
+
+        switch(c) {
+            case 'p':
+                knob_threads = atol(optarg);
+                break;
+            case 'c':
+                knob_chunk = atol(optarg);
+                break;
+            case 'w':
+                knob_window = atol(optarg);
+                break;
+            case 'i':
+                knob_instructions = atol(optarg);
+                break;
+            case 'n':
+                knob_top = atol(optarg);
+                break;
+            case 'V':
+                knob_trace_v2 = 1;
+                break;
+            case 'o':
+                output_name = optarg;
+                break;
+            default:
+                print_usage();
+                return 1;
+        }
+    }
+
+    if ((c != 't') || (optind == argc) || (knob_chunk == 0)) {
+        print_usage();
+        return 1;
+    }
+    if (knob_threads == 0)
+        knob_threads = 1;
+
+    // the native format holds version 1 records only
+    for (int i=optind; i<argc; i++) {
+        const char *last_dot = strrchr(argv[i], '.');
+        if (knob_trace_v2 && last_dot && (strcmp(last_dot, ".cst") == 0)) {
+            fprintf(stderr, "\n*** -trace_v2 cannot read %s ***\n\n", argv[i]);
+            return 1;
+        }
+    }
+
+    FILE *out = stdout;
+    if (output_name && ((out = fopen(output_name, "w")) == NULL)) {
+        fprintf(stderr, "\n*** Cannot write %s ***\n\n", output_name);
+        return 1;
+    }
+
+    fprintf(out, "[\n");
+    for (int i=optind; i<argc; i++) {
+        auto begin = chrono::steady_clock::now();
+        TRACE_ANALYSIS *analysis = analyze_trace(argv[i]);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+        print_json(out, argv[i], analysis, seconds);
+        fprintf(out, "%s\n", (i == argc-1) ? "" : ",");
+        delete analysis;
+    }
+    fprintf(out, "]\n");
+
+    if (out != stdout)
+        fclose(out);
+    return 0;
+}
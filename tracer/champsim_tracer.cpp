@@ -10,6 +10,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <string>
+#include <zlib.h>
+#include <lzma.h>
 
 #define NUM_INSTR_DESTINATIONS 2
 #define NUM_INSTR_SOURCES 4
@@ -27,18 +29,122 @@ typedef struct trace_instr_format {
     unsigned long long int source_memory[NUM_INSTR_SOURCES];           // input memory
 } trace_instr_format_t;
 
+// with -v 2, each record is followed by what the decoder tells about the instruction,
+// see input_instr_v2 in inc/instruction.h
+#define INSTR_CLASS_INT_ALU 1
+#define INSTR_CLASS_INT_MUL 2
+#define INSTR_CLASS_INT_DIV 3
+#define INSTR_CLASS_FP      4
+#define INSTR_CLASS_FP_DIV  5
+#define INSTR_CLASS_SIMD    6
+#define INSTR_CLASS_LOAD    7
+#define INSTR_CLASS_STORE   8
+#define INSTR_CLASS_BRANCH  9
+
+#define NOT_BRANCH           0
+#define BRANCH_DIRECT_JUMP   1
+#define BRANCH_INDIRECT      2
+#define BRANCH_CONDITIONAL   3
+#define BRANCH_DIRECT_CALL   4
+#define BRANCH_INDIRECT_CALL 5
+#define BRANCH_RETURN        6
+
+// with -v 2, the trace of each thread also holds a synchronization marker in front of the instruction
+// where the thread synchronized with the others, see INSTR_CLASS_SYNC in inc/instruction.h
+#define INSTR_CLASS_SYNC    10
+
+#define SYNC_ACQUIRE         1
+#define SYNC_RELEASE         2
+#define SYNC_BARRIER_ARRIVE  3
+#define SYNC_BARRIER_LEAVE   4
+#define SYNC_THREAD_CREATE   5
+#define SYNC_THREAD_START    6
+#define SYNC_THREAD_EXIT     7
+#define SYNC_THREAD_JOIN     8
+
+typedef struct trace_instr_info {
+    unsigned char instr_class;
+    unsigned char branch_type;
+    unsigned char instr_size;   // bytes
+    unsigned char load_size;    // bytes read by each source_memory operand
+    unsigned char store_size;   // bytes written by each destination_memory operand
+    unsigned char reserved[3];
+} trace_instr_info_t;
+
+// each thread of the program is traced into a file of its own: its instructions are collected in
+// NUM_BUFFERS buffers of BUFFER_INSTRS instructions, and a full buffer is handed to an internal writer
+// thread, which compresses it into the thread's output file while the thread goes on filling the next one
+#define NUM_BUFFERS 4
+#define BUFFER_INSTRS (1 << 16)
+#define COMPRESSED_BUFFER_SIZE (1 << 20)
+#define MAX_THREADS 1024
+#define MAX_PENDING_MARKERS 8
+
+typedef struct trace_buffer {
+    unsigned char *records;   // BUFFER_INSTRS records of record_size bytes
+    UINT32 count;
+    bool last;                // the writer stops after this buffer
+    PIN_SEMAPHORE full, empty;
+} trace_buffer_t;
+
+// output compression, picked by the extension of the output file
+enum { COMPRESS_NONE, COMPRESS_GZ, COMPRESS_XZ };
+
+typedef struct trace_output {
+    int compression;
+    FILE *out;
+    gzFile gz_out;
+    lzma_stream xz_stream;
+    unsigned char *xz_out;
+
+    trace_buffer_t buffers[NUM_BUFFERS];
+    UINT32 fill_buffer;       // filled by the traced thread
+    UINT32 write_buffer;      // written next by the writer thread
+    bool closed;              // the last buffer was handed off
+    PIN_SEMAPHORE done;       // the writer closed the file
+} trace_output_t;
+
+// a marker waits for the next instruction of its thread, which gives it an IP
+typedef struct sync_marker {
+    UINT64 sequence;
+    UINT32 kind;
+    ADDRINT object;
+} sync_marker_t;
+
+typedef struct thread_data {
+    UINT64 count;             // instrCount at the instruction being traced
+    trace_instr_format_t curr_instr;
+    trace_instr_info_t curr_info;
+    ADDRINT last_ip;
+
+    ADDRINT sync_object;      // the argument of the synchronization routine being called
+    sync_marker_t pending[MAX_PENDING_MARKERS];
+    UINT32 num_pending;
+
+    PIN_LOCK lock;            // held while adding records to the output or closing it
+    trace_output_t output;
+} thread_data_t;
+
 /* ================================================================== */
 // Global variables 
 /* ================================================================== */
 
-UINT64 instrCount = 0;
-
-FILE* out;
+UINT64 instrCount = 0;      // of all threads
+UINT64 syncCount = 0;       // synchronization markers of all threads
 
-bool output_file_closed = false;
 bool tracing_on = false;
+bool tracing_done = false;
+
+UINT32 record_size = sizeof(trace_instr_format_t);
 
-trace_instr_format_t curr_instr;
+// indexed by the Pin thread id
+thread_data_t *threads[MAX_THREADS];
+UINT32 num_outputs = 0;
+PIN_LOCK threads_lock;
+
+// the writer thread sleeps on work_ready until a buffer is handed off
+PIN_SEMAPHORE work_ready, writer_done;
+bool writer_stop = false;
 
 /* ===================================================================== */
 // Command line switches
@@ -52,6 +158,12 @@ KNOB<UINT64> KnobSkipInstructions(KNOB_MODE_WRITEONCE, "pintool", "s", "0",
 KNOB<UINT64> KnobTraceInstructions(KNOB_MODE_WRITEONCE, "pintool", "t", "1000000", 
         "How many instructions to trace");
 
+KNOB<UINT32> KnobCompressionLevel(KNOB_MODE_WRITEONCE, "pintool", "l", "1", 
+        "Compression level of .xz and .gz output files");
+
+KNOB<UINT32> KnobTraceVersion(KNOB_MODE_WRITEONCE, "pintool", "v", "1", 
+        "Trace format version: 2 adds the instruction class, branch type, and operand sizes (simulate with -trace_v2)");
+
 /* ===================================================================== */
 // Utilities
 /* ===================================================================== */
@@ -64,34 +176,313 @@ INT32 Usage()
     cerr << "This tool creates a register and memory access trace" << endl 
         << "Specify the output trace file with -o" << endl 
         << "Specify the number of instructions to skip before tracing with -s" << endl
-        << "Specify the number of instructions to trace with -t" << endl << endl;
+        << "Specify the number of instructions to trace with -t" << endl
+        << "Specify the compression level of .xz and .gz output files with -l" << endl
+        << "Specify the trace format version (1 or 2) with -v" << endl
+        << "Each thread of the program after the first one is traced into a file of its own, e.g., NAME.t1.champsimtrace.xz" << endl << endl;
 
     cerr << KNOB_BASE::StringKnobSummary() << endl;
 
     return -1;
 }
 
+/* ===================================================================== */
+// Output routines
+/* ===================================================================== */
+
+// the file of the n-th thread: the first one writes to -o, the others insert .tn before .champsimtrace
+// or before the extension, e.g., ls_trace.t1.champsimtrace.xz
+string OutputFileName(UINT32 n)
+{
+    string fileName = KnobOutputFile.Value();
+    if(n == 0)
+        return fileName;
+
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".t%u", n);
+
+    size_t pos = fileName.find(".champsimtrace");
+    if(pos == string::npos)
+    {
+        size_t last_slash = fileName.rfind('/');
+        pos = fileName.rfind('.');
+        if((pos == string::npos) || ((last_slash != string::npos) && (pos < last_slash)))
+            pos = fileName.length();
+    }
+    return fileName.insert(pos, suffix);
+}
+
+void OpenOutput(trace_output_t *output, const char *fileName)
+{
+    output->compression = COMPRESS_NONE;
+    const char *last_dot = strrchr(fileName, '.');
+    if(last_dot && (strcmp(last_dot, ".gz") == 0))
+        output->compression = COMPRESS_GZ;
+    else if(last_dot && (strcmp(last_dot, ".xz") == 0))
+        output->compression = COMPRESS_XZ;
+
+    // appending to an existing .gz or .xz file adds a stream, which gzip -dc and xz -dc decompress as one
+    if(output->compression == COMPRESS_GZ)
+    {
+        char mode[8];
+        snprintf(mode, sizeof(mode), "ab%u", KnobCompressionLevel.Value());
+        output->gz_out = gzopen(fileName, mode);
+        if (!output->gz_out) 
+        {
+            cout << "Couldn't open output trace file. Exiting." << endl;
+            exit(1);
+        }
+        gzbuffer(output->gz_out, COMPRESSED_BUFFER_SIZE);
+        return;
+    }
+
+    output->out = fopen(fileName, "ab");
+    if (!output->out) 
+    {
+        cout << "Couldn't open output trace file. Exiting." << endl;
+        exit(1);
+    }
+
+    if(output->compression == COMPRESS_XZ)
+    {
+        lzma_stream xz_init = LZMA_STREAM_INIT;
+        output->xz_stream = xz_init;
+        if(lzma_easy_encoder(&output->xz_stream, KnobCompressionLevel.Value(), LZMA_CHECK_CRC64) != LZMA_OK)
+        {
+            cout << "Couldn't initialize the xz encoder. Exiting." << endl;
+            exit(1);
+        }
+        output->xz_out = new unsigned char[COMPRESSED_BUFFER_SIZE];
+    }
+}
+
+// runs xz on the input until it is used up, or until the stream ends with LZMA_FINISH
+void WriteXZ(trace_output_t *output, const void *data, size_t size, lzma_action action)
+{
+    lzma_stream *xz_stream = &output->xz_stream;
+    xz_stream->next_in = (const uint8_t *)data;
+    xz_stream->avail_in = size;
+
+    while(1)
+    {
+        xz_stream->next_out = output->xz_out;
+        xz_stream->avail_out = COMPRESSED_BUFFER_SIZE;
+        lzma_ret ret = lzma_code(xz_stream, action);
+        if((ret != LZMA_OK) && (ret != LZMA_STREAM_END))
+        {
+            cout << "xz encoder error " << ret << ". Exiting." << endl;
+            exit(1);
+        }
+
+        fwrite(output->xz_out, COMPRESSED_BUFFER_SIZE - xz_stream->avail_out, 1, output->out);
+        if((action == LZMA_RUN) ? (xz_stream->avail_in == 0) : (ret == LZMA_STREAM_END))
+            break;
+    }
+}
+
+void WriteOutput(trace_output_t *output, const void *data, size_t size)
+{
+    if(output->compression == COMPRESS_GZ)
+        gzwrite(output->gz_out, data, size);
+    else if(output->compression == COMPRESS_XZ)
+        WriteXZ(output, data, size, LZMA_RUN);
+    else
+        fwrite(data, size, 1, output->out);
+}
+
+void CloseOutput(trace_output_t *output)
+{
+    if(output->compression == COMPRESS_GZ)
+    {
+        gzclose(output->gz_out);
+        return;
+    }
+
+    if(output->compression == COMPRESS_XZ)
+    {
+        WriteXZ(output, NULL, 0, LZMA_FINISH);
+        lzma_end(&output->xz_stream);
+        delete[] output->xz_out;
+    }
+    fclose(output->out);
+}
+
+// internal thread: compress and write the buffers of each thread in the order they were filled
+VOID WriterThread(VOID *arg)
+{
+    while(1)
+    {
+        PIN_SemaphoreWait(&work_ready);
+        PIN_SemaphoreClear(&work_ready);
+        bool stop = writer_stop;
+
+        for(UINT32 t=0; t<MAX_THREADS; t++)
+        {
+            if(threads[t] == NULL)
+                continue;
+
+            trace_output_t *output = &threads[t]->output;
+            while(PIN_SemaphoreIsSet(&output->buffers[output->write_buffer].full))
+            {
+                trace_buffer_t *buffer = &output->buffers[output->write_buffer];
+                PIN_SemaphoreClear(&buffer->full);
+
+                WriteOutput(output, buffer->records, buffer->count*record_size);
+                bool last = buffer->last;
+                buffer->count = 0;
+                output->write_buffer = (output->write_buffer+1)%NUM_BUFFERS;
+                PIN_SemaphoreSet(&buffer->empty);
+
+                if(last)
+                {
+                    CloseOutput(output);
+                    PIN_SemaphoreSet(&output->done);
+                    break;
+                }
+            }
+        }
+
+        if(stop)
+            break;
+    }
+
+    PIN_SemaphoreSet(&writer_done);
+}
+
+// hand the buffer being filled to the writer and wait until the next one is free
+void HandOffBuffer(trace_output_t *output, bool last)
+{
+    trace_buffer_t *buffer = &output->buffers[output->fill_buffer];
+    buffer->last = last;
+    PIN_SemaphoreClear(&buffer->empty);
+    PIN_SemaphoreSet(&buffer->full);
+    PIN_SemaphoreSet(&work_ready);
+
+    output->fill_buffer = (output->fill_buffer+1)%NUM_BUFFERS;
+    PIN_SemaphoreWait(&output->buffers[output->fill_buffer].empty);
+}
+
+// add a record to the output of a thread, whose lock is held
+void AppendRecord(thread_data_t *td, const trace_instr_format_t *instr, const trace_instr_info_t *info)
+{
+    trace_output_t *output = &td->output;
+    if(output->closed)
+        return;
+
+    trace_buffer_t *buffer = &output->buffers[output->fill_buffer];
+    unsigned char *record = buffer->records + buffer->count*record_size;
+    memcpy(record, instr, sizeof(*instr));
+    if(record_size > sizeof(*instr))
+        memcpy(record + sizeof(*instr), info, sizeof(*info));
+    buffer->count++;
+    if(buffer->count == BUFFER_INSTRS)
+        HandOffBuffer(output, false);
+}
+
+// put the markers of a thread in front of its instruction at ip; the lock of the thread is held
+void FlushMarkers(thread_data_t *td, ADDRINT ip)
+{
+    for(UINT32 i=0; i<td->num_pending; i++)
+    {
+        trace_instr_format_t marker;
+        memset(&marker, 0, sizeof(marker));
+        marker.ip = ip;
+        marker.source_registers[0] = td->pending[i].kind;
+        marker.destination_memory[0] = td->pending[i].sequence;
+        marker.destination_memory[1] = td->pending[i].object;
+
+        trace_instr_info_t info;
+        memset(&info, 0, sizeof(info));
+        info.instr_class = INSTR_CLASS_SYNC;
+
+        AppendRecord(td, &marker, &info);
+    }
+    td->num_pending = 0;
+}
+
+// write out what is left of the trace of a thread and close its file; the markers still waiting for an instruction
+// are written with the IP of its last one, since they already took their place in the order of all markers
+void FinishOutput(THREADID tid, thread_data_t *td)
+{
+    PIN_GetLock(&td->lock, tid+1);
+    if(!td->output.closed)
+    {
+        FlushMarkers(td, td->last_ip);
+        HandOffBuffer(&td->output, true);
+        td->output.closed = true;
+    }
+    PIN_ReleaseLock(&td->lock);
+
+    PIN_SemaphoreWait(&td->output.done);
+}
+
+// finish the traces of all threads and stop the writer; returns false if another thread already did
+bool FinishAllOutputs(THREADID tid)
+{
+    PIN_GetLock(&threads_lock, tid+1);
+    bool done = tracing_done;
+    tracing_done = true;
+    PIN_ReleaseLock(&threads_lock);
+    if(done)
+        return false;
+
+    for(UINT32 t=0; t<MAX_THREADS; t++)
+        if(threads[t])
+            FinishOutput(tid, threads[t]);
+
+    writer_stop = true;
+    PIN_SemaphoreSet(&work_ready);
+    PIN_SemaphoreWait(&writer_done);
+    return true;
+}
+
+// the order of the marker among the markers of all threads is taken now, when the thread synchronizes
+void AddMarker(THREADID tid, thread_data_t *td, UINT32 kind, ADDRINT object)
+{
+    if(!tracing_on || (KnobTraceVersion.Value() != 2))
+        return;
+
+    PIN_GetLock(&td->lock, tid+1);
+    if(td->num_pending == MAX_PENDING_MARKERS)
+        FlushMarkers(td, td->last_ip);
+
+    sync_marker_t *marker = &td->pending[td->num_pending++];
+    marker->sequence = __sync_add_and_fetch(&syncCount, 1);
+    marker->kind = kind;
+    marker->object = object;
+    PIN_ReleaseLock(&td->lock);
+}
+
 /* ===================================================================== */
 // Analysis routines
 /* ===================================================================== */
 
-void BeginInstruction(VOID *ip, UINT32 op_code, VOID *opstring)
+void BeginInstruction(THREADID tid, VOID *ip, UINT32 op_code, VOID *opstring)
 {
-    instrCount++;
+    thread_data_t *td = threads[tid];
+    td->count = __sync_add_and_fetch(&instrCount, 1);
     //printf("[%p %u %s ", ip, opcode, (char*)opstring);
 
-    if(instrCount > KnobSkipInstructions.Value()) 
+    if(td->count > KnobSkipInstructions.Value()) 
     {
         tracing_on = true;
 
-        if(instrCount > (KnobTraceInstructions.Value()+KnobSkipInstructions.Value()))
+        if(td->count > (KnobTraceInstructions.Value()+KnobSkipInstructions.Value()))
             tracing_on = false;
     }
 
     if(!tracing_on) 
         return;
 
+    if(td->num_pending)
+    {
+        PIN_GetLock(&td->lock, tid+1);
+        FlushMarkers(td, (ADDRINT)ip);
+        PIN_ReleaseLock(&td->lock);
+    }
+
     // reset the current instruction
+    trace_instr_format_t &curr_instr = td->curr_instr;
     curr_instr.ip = (unsigned long long int)ip;
 
     curr_instr.is_branch = 0;
@@ -110,40 +501,53 @@ void BeginInstruction(VOID *ip, UINT32 op_code, VOID *opstring)
     }
 }
 
-void EndInstruction()
+void EndInstruction(THREADID tid)
 {
-    //printf("%d]\n", (int)instrCount);
+    thread_data_t *td = threads[tid];
+    //printf("%d]\n", (int)td->count);
 
     //printf("\n");
 
-    if(instrCount > KnobSkipInstructions.Value())
+    if(td->count > KnobSkipInstructions.Value())
     {
         tracing_on = true;
 
-        if(instrCount <= (KnobTraceInstructions.Value()+KnobSkipInstructions.Value()))
+        if(td->count <= (KnobTraceInstructions.Value()+KnobSkipInstructions.Value()))
         {
             // keep tracing
-            fwrite(&curr_instr, sizeof(trace_instr_format_t), 1, out);
+            PIN_GetLock(&td->lock, tid+1);
+            AppendRecord(td, &td->curr_instr, &td->curr_info);
+            PIN_ReleaseLock(&td->lock);
+            td->last_ip = td->curr_instr.ip;
         }
         else
         {
             tracing_on = false;
-            // close down the file, we're done tracing
-            if(!output_file_closed)
-            {
-                fclose(out);
-                output_file_closed = true;
-            }
-
-            exit(0);
+            // close down the files, we're done tracing
+            if(FinishAllOutputs(tid))
+                exit(0);
         }
     }
 }
 
-void BranchOrNot(UINT32 taken)
+void InstrInfo(THREADID tid, UINT32 instr_class, UINT32 branch_type, UINT32 instr_size, UINT32 load_size, UINT32 store_size)
+{
+    if(!tracing_on) return;
+
+    trace_instr_info_t &curr_info = threads[tid]->curr_info;
+    curr_info.instr_class = instr_class;
+    curr_info.branch_type = branch_type;
+    curr_info.instr_size = instr_size;
+    curr_info.load_size = load_size;
+    curr_info.store_size = store_size;
+}
+
+void BranchOrNot(THREADID tid, UINT32 taken)
 {
     //printf("[%d] ", taken);
 
+    trace_instr_format_t &curr_instr = threads[tid]->curr_instr;
+
     curr_instr.is_branch = 1;
     if(taken != 0)
     {
@@ -151,10 +555,12 @@ void BranchOrNot(UINT32 taken)
     }
 }
 
-void RegRead(UINT32 i, UINT32 index)
+void RegRead(THREADID tid, UINT32 i, UINT32 index)
 {
     if(!tracing_on) return;
 
+    trace_instr_format_t &curr_instr = threads[tid]->curr_instr;
+
     REG r = (REG)i;
 
     /*
@@ -193,10 +599,12 @@ void RegRead(UINT32 i, UINT32 index)
     }
 }
 
-void RegWrite(REG i, UINT32 index)
+void RegWrite(THREADID tid, REG i, UINT32 index)
 {
     if(!tracing_on) return;
 
+    trace_instr_format_t &curr_instr = threads[tid]->curr_instr;
+
     REG r = (REG)i;
 
     /*
@@ -240,10 +648,12 @@ void RegWrite(REG i, UINT32 index)
        */
 }
 
-void MemoryRead(VOID* addr, UINT32 index, UINT32 read_size)
+void MemoryRead(THREADID tid, VOID* addr, UINT32 index, UINT32 read_size)
 {
     if(!tracing_on) return;
 
+    trace_instr_format_t &curr_instr = threads[tid]->curr_instr;
+
     //printf("0x%llx,%u ", (unsigned long long int)addr, read_size);
 
     // check to see if this memory read location is already in the list
@@ -269,10 +679,12 @@ void MemoryRead(VOID* addr, UINT32 index, UINT32 read_size)
     }
 }
 
-void MemoryWrite(VOID* addr, UINT32 index)
+void MemoryWrite(THREADID tid, VOID* addr, UINT32 index)
 {
     if(!tracing_on) return;
 
+    trace_instr_format_t &curr_instr = threads[tid]->curr_instr;
+
     //printf("(0x%llx) ", (unsigned long long int) addr);
 
     // check to see if this memory write location is already in the list
@@ -304,20 +716,143 @@ void MemoryWrite(VOID* addr, UINT32 index)
        */
 }
 
+void SyncBefore(THREADID tid, UINT32 kind, ADDRINT object)
+{
+    thread_data_t *td = threads[tid];
+    td->sync_object = object;
+    if(kind)
+        AddMarker(tid, td, kind, object);
+}
+
+void SyncAfter(THREADID tid, UINT32 kind)
+{
+    thread_data_t *td = threads[tid];
+    AddMarker(tid, td, kind, td->sync_object);
+}
+
 /* ===================================================================== */
 // Instrumentation callbacks
 /* ===================================================================== */
 
+// the routines that synchronize threads, and the markers put in front of their first instruction
+// and after they return
+typedef struct sync_routine {
+    const char *name;
+    UINT32 before_kind, after_kind; // 0 for no marker
+} sync_routine_t;
+
+sync_routine_t sync_routines[] = {
+    {"pthread_mutex_lock", 0, SYNC_ACQUIRE},
+    {"pthread_mutex_unlock", SYNC_RELEASE, 0},
+    {"pthread_cond_wait", SYNC_RELEASE, SYNC_ACQUIRE},
+    {"pthread_cond_timedwait", SYNC_RELEASE, SYNC_ACQUIRE},
+    {"pthread_cond_signal", SYNC_RELEASE, 0},
+    {"pthread_cond_broadcast", SYNC_RELEASE, 0},
+    {"sem_wait", 0, SYNC_ACQUIRE},
+    {"sem_post", SYNC_RELEASE, 0},
+    {"pthread_barrier_wait", SYNC_BARRIER_ARRIVE, SYNC_BARRIER_LEAVE},
+    {"pthread_create", SYNC_THREAD_CREATE, 0},
+    {"pthread_join", 0, SYNC_THREAD_JOIN},
+};
+
+// Is called for every image and instruments the synchronization routines in it
+VOID Image(IMG img, VOID *v)
+{
+    for(UINT32 i=0; i<sizeof(sync_routines)/sizeof(sync_routines[0]); i++)
+    {
+        RTN rtn = RTN_FindByName(img, sync_routines[i].name);
+        if(!RTN_Valid(rtn))
+            continue;
+
+        RTN_Open(rtn);
+        RTN_InsertCall(rtn, IPOINT_BEFORE, (AFUNPTR)SyncBefore, IARG_THREAD_ID,
+                IARG_UINT32, sync_routines[i].before_kind, IARG_FUNCARG_ENTRYPOINT_VALUE, 0,
+                IARG_END);
+        if(sync_routines[i].after_kind)
+            RTN_InsertCall(rtn, IPOINT_AFTER, (AFUNPTR)SyncAfter, IARG_THREAD_ID,
+                    IARG_UINT32, sync_routines[i].after_kind,
+                    IARG_END);
+        RTN_Close(rtn);
+    }
+}
+
+// the instruction class of a version 2 trace, from the XED category and mnemonic
+UINT32 InstrClass(INS ins)
+{
+    if(INS_IsBranch(ins) || INS_IsCall(ins) || INS_IsRet(ins))
+        return INSTR_CLASS_BRANCH;
+
+    string category = CATEGORY_StringShort(INS_Category(ins));
+    string mnemonic = INS_Mnemonic(ins);
+    bool divides = (mnemonic.find("DIV") != string::npos) || (mnemonic.find("SQRT") != string::npos);
+
+    if(category == "DATAXFER")
+    {
+        if(INS_IsMemoryRead(ins))
+            return INSTR_CLASS_LOAD;
+        if(INS_IsMemoryWrite(ins))
+            return INSTR_CLASS_STORE;
+        return INSTR_CLASS_INT_ALU;
+    }
+
+    if(category.compare(0, 3, "X87") == 0)
+        return divides ? INSTR_CLASS_FP_DIV : INSTR_CLASS_FP;
+
+    if((category.compare(0, 3, "SSE") == 0) || (category.compare(0, 3, "AVX") == 0) || (category == "MMX"))
+    {
+        // scalar single and double precision operations end in SS and SD, the rest work on vectors
+        size_t length = mnemonic.length();
+        bool scalar = (length > 2) && ((mnemonic.compare(length-2, 2, "SS") == 0) || (mnemonic.compare(length-2, 2, "SD") == 0));
+        if(divides)
+            return INSTR_CLASS_FP_DIV;
+        return scalar ? INSTR_CLASS_FP : INSTR_CLASS_SIMD;
+    }
+
+    if((mnemonic == "MUL") || (mnemonic == "IMUL") || (mnemonic == "MULX"))
+        return INSTR_CLASS_INT_MUL;
+    if((mnemonic == "DIV") || (mnemonic == "IDIV"))
+        return INSTR_CLASS_INT_DIV;
+
+    return INSTR_CLASS_INT_ALU;
+}
+
+// the branch type of a version 2 trace, as ChampSim would guess it from the registers of a version 1 trace
+UINT32 BranchType(INS ins)
+{
+    if(INS_IsRet(ins))
+        return BRANCH_RETURN;
+    if(INS_IsCall(ins))
+        return INS_IsDirectBranchOrCall(ins) ? BRANCH_DIRECT_CALL : BRANCH_INDIRECT_CALL;
+    if(INS_IsBranch(ins))
+    {
+        if(INS_HasFallThrough(ins))
+            return BRANCH_CONDITIONAL;
+        return INS_IsDirectBranchOrCall(ins) ? BRANCH_DIRECT_JUMP : BRANCH_INDIRECT;
+    }
+    return NOT_BRANCH;
+}
+
 // Is called for every instruction and instruments reads and writes
 VOID Instruction(INS ins, VOID *v)
 {
     // begin each instruction with this function
     UINT32 opcode = INS_Opcode(ins);
-    INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)BeginInstruction, IARG_INST_PTR, IARG_UINT32, opcode, IARG_END);
+    INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)BeginInstruction, IARG_THREAD_ID, IARG_INST_PTR, IARG_UINT32, opcode, IARG_END);
+
+    // what a version 2 trace adds is known at instrumentation time
+    if(KnobTraceVersion.Value() == 2)
+    {
+        UINT32 load_size = INS_IsMemoryRead(ins) ? INS_MemoryReadSize(ins) : 0;
+        UINT32 store_size = INS_IsMemoryWrite(ins) ? INS_MemoryWriteSize(ins) : 0;
+        INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)InstrInfo, IARG_THREAD_ID,
+                IARG_UINT32, InstrClass(ins), IARG_UINT32, BranchType(ins), IARG_UINT32, INS_Size(ins),
+                IARG_UINT32, (load_size < 255) ? load_size : 255, IARG_UINT32, (store_size < 255) ? store_size : 255,
+                IARG_END);
+    }
 
     // instrument branch instructions
     if(INS_IsBranch(ins))
-        INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)BranchOrNot, IARG_BRANCH_TAKEN, IARG_END);
+        INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)BranchOrNot, IARG_THREAD_ID, IARG_BRANCH_TAKEN, IARG_END);
 
     // instrument register reads
     UINT32 readRegCount = INS_MaxNumRRegs(ins);
@@ -325,7 +860,7 @@ VOID Instruction(INS ins, VOID *v)
     {
         UINT32 regNum = INS_RegR(ins, i);
 
-        INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)RegRead,
+        INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)RegRead, IARG_THREAD_ID,
                 IARG_UINT32, regNum, IARG_UINT32, i,
                 IARG_END);
     }
@@ -336,7 +871,7 @@ VOID Instruction(INS ins, VOID *v)
     {
         UINT32 regNum = INS_RegW(ins, i);
 
-        INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)RegWrite,
+        INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)RegWrite, IARG_THREAD_ID,
                 IARG_UINT32, regNum, IARG_UINT32, i,
                 IARG_END);
     }
@@ -351,20 +886,81 @@ VOID Instruction(INS ins, VOID *v)
         {
             UINT32 read_size = INS_MemoryReadSize(ins);
 
-            INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)MemoryRead,
+            INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)MemoryRead, IARG_THREAD_ID,
                     IARG_MEMORYOP_EA, memOp, IARG_UINT32, memOp, IARG_UINT32, read_size,
                     IARG_END);
         }
         if (INS_MemoryOperandIsWritten(ins, memOp)) 
         {
-            INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)MemoryWrite,
+            INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)MemoryWrite, IARG_THREAD_ID,
                     IARG_MEMORYOP_EA, memOp, IARG_UINT32, memOp,
                     IARG_END);
         }
     }
 
     // finalize each instruction with this function
-    INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)EndInstruction, IARG_END);
+    INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)EndInstruction, IARG_THREAD_ID, IARG_END);
+}
+
+/*!
+ * Open the output of a new thread.
+ * This function is called when a thread of the application starts.
+ */
+VOID ThreadStart(THREADID tid, CONTEXT *ctxt, INT32 flags, VOID *v)
+{
+    if(tid >= MAX_THREADS)
+    {
+        cout << "Too many threads to trace. Exiting." << endl;
+        exit(1);
+    }
+
+    thread_data_t *td = new thread_data_t();
+    PIN_InitLock(&td->lock);
+    for(UINT32 b=0; b<NUM_BUFFERS; b++)
+    {
+        td->output.buffers[b].records = new unsigned char[BUFFER_INSTRS*record_size];
+        PIN_SemaphoreInit(&td->output.buffers[b].full);
+        PIN_SemaphoreInit(&td->output.buffers[b].empty);
+        PIN_SemaphoreSet(&td->output.buffers[b].empty);
+    }
+    PIN_SemaphoreInit(&td->output.done);
+
+    // a thread that starts after tracing is done has no trace
+    PIN_GetLock(&threads_lock, tid+1);
+    if(tracing_done)
+    {
+        td->output.closed = true;
+        PIN_SemaphoreSet(&td->output.done);
+    }
+    else
+        OpenOutput(&td->output, OutputFileName(num_outputs++).c_str());
+    threads[tid] = td;
+    PIN_ReleaseLock(&threads_lock);
+
+    if(tid != 0)
+        AddMarker(tid, td, SYNC_THREAD_START, 0);
+}
+
+/*!
+ * Finish the trace of a thread.
+ * This function is called when a thread of the application exits.
+ */
+VOID ThreadFini(THREADID tid, const CONTEXT *ctxt, INT32 code, VOID *v)
+{
+    thread_data_t *td = threads[tid];
+    AddMarker(tid, td, SYNC_THREAD_EXIT, 0);
+    FinishOutput(tid, td);
+}
+
+/*!
+ * Write out the last buffers while the writer thread can still run.
+ * This function is called when the application starts to exit.
+ * @param[in]   v               value specified by the tool in the 
+ *                              PIN_AddPrepareForFiniFunction function call
+ */
+VOID PrepareForFini(VOID *v)
+{
+    FinishAllOutputs(PIN_ThreadId());
 }
 
 /*!
@@ -376,12 +972,7 @@ VOID Instruction(INS ins, VOID *v)
  */
 VOID Fini(INT32 code, VOID *v)
 {
-    // close the file if it hasn't already been closed
-    if(!output_file_closed) 
-    {
-        fclose(out);
-        output_file_closed = true;
-    }
+    // the files were closed by PrepareForFini
 }
 
 /*!
@@ -395,22 +986,39 @@ int main(int argc, char *argv[])
 {
     // Initialize PIN library. Print help message if -h(elp) is specified
     // in the command line or the command line is invalid 
+    PIN_InitSymbols();
     if( PIN_Init(argc,argv) )
         return Usage();
 
-    const char* fileName = KnobOutputFile.Value().c_str();
+    if((KnobTraceVersion.Value() != 1) && (KnobTraceVersion.Value() != 2))
+        return Usage();
+    if(KnobTraceVersion.Value() == 2)
+        record_size = sizeof(trace_instr_format_t) + sizeof(trace_instr_info_t);
+
+    PIN_InitLock(&threads_lock);
+    PIN_SemaphoreInit(&work_ready);
+    PIN_SemaphoreInit(&writer_done);
 
-    out = fopen(fileName, "ab");
-    if (!out) 
+    // Start the thread that compresses and writes the trace
+    if(PIN_SpawnInternalThread(WriterThread, 0, 0, NULL) == INVALID_THREADID)
     {
-        cout << "Couldn't open output trace file. Exiting." << endl;
+        cout << "Couldn't start the trace writer thread. Exiting." << endl;
         exit(1);
     }
 
     // Register function to be called to instrument instructions
     INS_AddInstrumentFunction(Instruction, 0);
 
-    // Register function to be called when the application exits
+    // Register function to be called to instrument the synchronization routines of version 2 traces
+    if(KnobTraceVersion.Value() == 2)
+        IMG_AddInstrumentFunction(Image, 0);
+
+    // Register functions to be called when the threads of the application start and exit
+    PIN_AddThreadStartFunction(ThreadStart, 0);
+    PIN_AddThreadFiniFunction(ThreadFini, 0);
+
+    // Register functions to be called when the application exits
+    PIN_AddPrepareForFiniFunction(PrepareForFini, 0);
     PIN_AddFiniFunction(Fini, 0);
 
     //cerr <<  "===============================================" << endl;